@@ -0,0 +1,394 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "spew.h"
+#include "arena.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* The first slab is small so that small sources use little
+ * memory, and the slabs get twice as large up to the max. */
+#define FIRST_SLAB_SIZE   ((size_t) 256*1024)
+#define MAX_SLAB_SIZE     ((size_t) 32*1024*1024)
+/* we ask for huge pages for slabs this large or larger */
+#define HUGE_SLAB_SIZE    ((size_t) 4*1024*1024)
+
+/* blocks start on this byte boundary */
+#define ALIGN  ((size_t) 64)
+
+#define ROUND_UP(x)  (((x) + ALIGN - 1) & ~(ALIGN - 1))
+
+/* from linux/magic.h */
+#ifndef TMPFS_MAGIC
+#  define TMPFS_MAGIC  0x01021994
+#endif
+
+
+struct slab
+{
+  void *next;
+  size_t size;
+  int is_file; /* mapped from a temporary file */
+};
+
+
+/* see qp_arena_set_max_memory() */
+static size_t max_memory = 0;
+/* bytes of the slabs of all arenas that are not from files,
+ * changed by the threads that load files too */
+static size_t memory_used = 0;
+
+
+void qp_arena_set_max_memory(size_t max)
+{
+  max_memory = max;
+}
+
+size_t qp_arena_parse_size(const char *str)
+{
+  char *end;
+  double x;
+
+  errno = 0;
+  x = strtod(str, &end);
+  if(end == str || errno || !(x >= 0))
+    return (size_t) -1;
+
+  while(isspace(*end)) ++end;
+  switch(*end)
+  {
+    case 'g':
+    case 'G':
+      x *= 1024;
+      /* fall through */
+    case 'm':
+    case 'M':
+      x *= 1024;
+      /* fall through */
+    case 'k':
+    case 'K':
+      x *= 1024;
+      ++end;
+      break;
+    default:
+      break;
+  }
+  if(*end == 'b' || *end == 'B')
+    ++end;
+  if(*end || x >= (double) ((size_t) -1))
+    return (size_t) -1;
+
+  return (size_t) x;
+}
+
+/* Makes an unlinked temporary file in dir.  Returns the file
+ * descriptor, or -1 if we can't, and sets *on_tmpfs if the file is
+ * on tmpfs. */
+static
+int open_temp_file(const char *dir, int *on_tmpfs)
+{
+  char path[256];
+  struct statfs fs;
+  int fd;
+
+  if(!dir || !dir[0])
+    return -1;
+  snprintf(path, sizeof(path), "%s/quickplot-XXXXXX", dir);
+
+  fd = mkstemp(path);
+  if(fd == -1)
+    return -1;
+  unlink(path);
+
+  *on_tmpfs = (fstatfs(fd, &fs) == 0 && fs.f_type == TMPFS_MAGIC);
+  return fd;
+}
+
+/* Maps size bytes from an unlinked temporary file.  The file goes
+ * away when it is unmapped.  Returns MAP_FAILED if we can't.
+ *
+ * tmpfs is kept in memory, so a file there saves no memory.  We
+ * try TMPDIR, the XDG cache directory and /var/tmp, and we use a
+ * file on tmpfs, like in /tmp, only if there is nothing else. */
+static
+void *map_file(size_t size)
+{
+  static int tmpfs_warned = 0;
+  char cache[256];
+  const char *dir[4], *home;
+  void *p;
+  int i, fd = -1, tmpfs_fd = -1;
+
+  dir[0] = getenv("TMPDIR");
+  dir[1] = getenv("XDG_CACHE_HOME");
+  if(!dir[1] || !dir[1][0])
+  {
+    home = getenv("HOME");
+    dir[1] = NULL;
+    if(home && home[0])
+    {
+      snprintf(cache, sizeof(cache), "%s/.cache", home);
+      dir[1] = cache;
+    }
+  }
+  dir[2] = "/var/tmp";
+  dir[3] = "/tmp";
+
+  for(i=0; i<4 && fd == -1; ++i)
+  {
+    int on_tmpfs = 0, f;
+    f = open_temp_file(dir[i], &on_tmpfs);
+    if(f == -1)
+      continue;
+    if(!on_tmpfs)
+      fd = f;
+    else if(tmpfs_fd == -1)
+      tmpfs_fd = f;
+    else
+      close(f);
+  }
+
+  if(fd == -1)
+  {
+    fd = tmpfs_fd;
+    if(fd == -1)
+      return MAP_FAILED;
+    if(!__atomic_exchange_n(&tmpfs_warned, 1, __ATOMIC_RELAXED))
+      QP_WARN("the only place for temporary files is on tmpfs, "
+          "which is in memory, so --max-memory will not save "
+          "much memory.  Set TMPDIR to a directory on a disk.\n");
+  }
+  else if(tmpfs_fd != -1)
+    close(tmpfs_fd);
+
+  if(ftruncate(fd, size))
+  {
+    close(fd);
+    return MAP_FAILED;
+  }
+
+  p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  /* the mapping keeps the file */
+  close(fd);
+  return p;
+}
+
+
+struct qp_arena *qp_arena_create(void)
+{
+  struct qp_arena *arena;
+  int i;
+
+  arena = (struct qp_arena *) qp_malloc(sizeof(*arena));
+  arena->slabs = NULL;
+  arena->slab_size = FIRST_SLAB_SIZE;
+  arena->next = arena->end = NULL;
+  for(i=0; i<QP_ARENA_FREE_SIZES; ++i)
+  {
+    arena->free[i].size = 0;
+    arena->free[i].first = NULL;
+  }
+  arena->maps = NULL;
+  arena->ref_count = 1;
+  return arena;
+}
+
+static
+void add_slab(struct qp_arena *arena, size_t size)
+{
+  struct slab *slab;
+  size_t slab_size;
+
+  slab_size = arena->slab_size;
+  if(slab_size < size + ROUND_UP(sizeof(*slab)))
+    slab_size = size + ROUND_UP(sizeof(*slab));
+
+  if(max_memory && __atomic_load_n(&memory_used, __ATOMIC_RELAXED) +
+      slab_size > max_memory)
+  {
+    slab = (struct slab *) map_file(slab_size);
+    if(slab != MAP_FAILED)
+    {
+      slab->is_file = 1;
+      goto got_slab;
+    }
+    QP_EWARN("failed to map %zu bytes from a temporary file, "
+        "going past --max-memory\n", slab_size);
+  }
+
+  errno = 0;
+  slab = (struct slab *) mmap(NULL, slab_size, PROT_READ|PROT_WRITE,
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  VASSERT(slab != MAP_FAILED, "mmap(,%zu,) failed\n", slab_size);
+  if(slab == MAP_FAILED)
+  {
+    char errstr[128];
+    strerror_r(errno, errstr, 128);
+    printf("%s:%d:%s() mmap(,%zu,) failed: errno=%d: %s\n",
+        __FILE__, __LINE__, __func__, slab_size, errno, errstr);
+    exit(1);
+  }
+
+#ifdef MADV_HUGEPAGE
+  if(slab_size >= HUGE_SLAB_SIZE)
+    /* This is just a hint, so we do not care if it fails */
+    madvise(slab, slab_size, MADV_HUGEPAGE);
+#endif
+
+  slab->is_file = 0;
+  __atomic_add_fetch(&memory_used, slab_size, __ATOMIC_RELAXED);
+
+got_slab:
+
+  slab->next = arena->slabs;
+  slab->size = slab_size;
+  arena->slabs = slab;
+  arena->next = ((char *) slab) + ROUND_UP(sizeof(*slab));
+  arena->end = ((char *) slab) + slab_size;
+
+  if(arena->slab_size < MAX_SLAB_SIZE)
+    arena->slab_size *= 2;
+}
+
+static inline
+struct qp_arena_free *get_free(struct qp_arena *arena, size_t size)
+{
+  int i;
+  for(i=0; i<QP_ARENA_FREE_SIZES; ++i)
+    if(arena->free[i].size == size)
+      return &arena->free[i];
+  return NULL;
+}
+
+void *qp_arena_alloc(struct qp_arena *arena, size_t size)
+{
+  struct qp_arena_free *f;
+  void *block;
+
+  ASSERT(arena);
+  ASSERT(arena->ref_count > 0);
+  ASSERT(size > 0);
+
+  size = ROUND_UP(size);
+
+  f = get_free(arena, size);
+  if(f && f->first)
+  {
+    block = f->first;
+    f->first = *((void **) block);
+    return block;
+  }
+
+  if((size_t) (arena->end - arena->next) < size)
+    /* what is left of the current slab is not used */
+    add_slab(arena, size);
+
+  block = arena->next;
+  arena->next += size;
+  return block;
+}
+
+void qp_arena_free(struct qp_arena *arena, void *block, size_t size)
+{
+  struct qp_arena_free *f;
+
+  ASSERT(arena);
+  ASSERT(block);
+
+  size = ROUND_UP(size);
+
+  f = get_free(arena, size);
+  if(!f)
+  {
+    /* use an unused free list */
+    f = get_free(arena, 0);
+    if(!f)
+      /* We only keep QP_ARENA_FREE_SIZES sizes.  This block will
+       * be released with the arena. */
+      return;
+    f->size = size;
+  }
+
+  *((void **) block) = f->first;
+  f->first = block;
+}
+
+void qp_arena_unref(struct qp_arena *arena)
+{
+  ASSERT(arena);
+  ASSERT(arena->ref_count > 0);
+
+  if(--(arena->ref_count))
+    return;
+
+  while(arena->slabs)
+  {
+    struct slab *slab;
+    slab = (struct slab *) arena->slabs;
+    arena->slabs = slab->next;
+    if(!slab->is_file)
+      __atomic_sub_fetch(&memory_used, slab->size, __ATOMIC_RELAXED);
+    munmap(slab, slab->size);
+  }
+  while(arena->maps)
+  {
+    struct qp_arena_map *m;
+    m = arena->maps;
+    arena->maps = m->next;
+    munmap(m->map, m->size);
+    free(m);
+  }
+  free(arena);
+}
+
+void qp_arena_add_map(struct qp_arena *arena, void *map, size_t size)
+{
+  struct qp_arena_map *m;
+
+  ASSERT(arena);
+  ASSERT(arena->ref_count > 0);
+  ASSERT(map && map != MAP_FAILED);
+
+  m = (struct qp_arena_map *) qp_malloc(sizeof(*m));
+  m->map = map;
+  m->size = size;
+  m->next = arena->maps;
+  arena->maps = m;
+}
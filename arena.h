@@ -0,0 +1,117 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* An arena is memory for many blocks that are all released at once
+ * when the arena is destroyed.  The memory comes from large mmap()ed
+ * slabs, so a source with many thousands of channel arrays does
+ * not fragment the heap and gives all its memory back to the
+ * system when it is closed.  Blocks that are freed go on a free
+ * list for their size and are used again by the next block of
+ * that size. */
+
+#ifndef _QP_DEBUG_H_
+#error "You must include qp_debug.h before this file."
+#endif
+
+
+struct qp_arena_free
+{
+  size_t size;
+  void *first; /* each free block has the next in its first bytes */
+};
+
+/* a mapping, like a mmap()ed file, that is released with the arena */
+struct qp_arena_map
+{
+  struct qp_arena_map *next;
+  void *map;
+  size_t size;
+};
+
+/* number of free block sizes we keep */
+#define QP_ARENA_FREE_SIZES  (8)
+
+struct qp_arena
+{
+  /* the slabs are in a list with the next slab pointer
+   * in the start of each slab */
+  void *slabs;
+  size_t slab_size; /* size of the next slab we make */
+
+  char *next, *end; /* unused memory in the current slab */
+
+  struct qp_arena_free free[QP_ARENA_FREE_SIZES];
+
+  /* see qp_arena_add_map() */
+  struct qp_arena_map *maps;
+
+  /* The arena is destroyed when this gets to zero */
+  int ref_count;
+};
+
+
+extern
+struct qp_arena *qp_arena_create(void);
+
+/* returns a block of at least size bytes */
+extern
+void *qp_arena_alloc(struct qp_arena *arena, size_t size);
+
+/* size must be the size that the block was allocated with */
+extern
+void qp_arena_free(struct qp_arena *arena, void *block, size_t size);
+
+static inline
+void qp_arena_ref(struct qp_arena *arena)
+{
+  ASSERT(arena);
+  ASSERT(arena->ref_count > 0);
+  ++(arena->ref_count);
+}
+
+/* releases all the slabs, in one munmap() each, when the last
+ * user of the arena calls this */
+extern
+void qp_arena_unref(struct qp_arena *arena);
+
+/* Gives the arena map, size bytes from mmap(), so that it is
+ * unmapped with the slabs.  This is for channel arrays that are
+ * in a mapped file, see qp_channel_series_map(). */
+extern
+void qp_arena_add_map(struct qp_arena *arena, void *map, size_t size);
+
+/* Sets the most memory in bytes that all the arenas together map
+ * from RAM, or 0 for no limit.  Slabs past that are mapped from
+ * unlinked temporary files, so the kernel can write their pages out
+ * and drop the ones that have not been used lately in place of
+ * swapping or running out of memory, and read them back in when
+ * they are touched.  This is for slabs made after the call. */
+extern
+void qp_arena_set_max_memory(size_t max_memory);
+
+/* returns the number of bytes in str like "512M" or "16G" with
+ * an optional K, M or G suffix, or (size_t) -1 if str is not
+ * a size. */
+extern
+size_t qp_arena_parse_size(const char *str);
+
@@ -43,6 +43,8 @@
 #include "callbacks.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "qp.h"
 #include "plot.h"
 #include "zoom.h"
@@ -951,7 +953,7 @@ void set_value_pick_entries(struct qp_graph *gr, int x, int y)
     {
       ssize_t j;
 
-      ASSERT(p->x->form == QP_CHANNEL_FORM_SERIES);
+      ASSERT(qp_channel_is_indexed(p->x));
       p->x_picker = qp_channel_series_create(p->x, 0);
       p->y_picker = qp_channel_series_create(p->y, 0);
       i = -1;
@@ -1494,11 +1496,28 @@ gboolean ecb_graph_pointer_motion(GtkWidget *w, GdkEvent *event, gpointer data)
   return TRUE; /* TRUE means the event is handled. */
 }
 
+/* called by qp_source_load() after the file that was opened
+ * with cb_open_file() is loaded */
+static
+void open_file_loaded(qp_source_t s, void *data)
+{
+  struct qp_win *qp;
+  qp = data;
+
+  if(!s || !app->op_default_graph)
+    return;
+
+  /* The window may be gone by now. */
+  if(!qp_sllist_find(app->qps, qp))
+    qp = NULL;
+
+  qp_win_graph_default_source(qp, s, NULL);
+}
+
 void cb_open_file(GtkWidget *w, gpointer data)
 {
   GtkWidget *dialog;
   struct qp_win *qp;
-  struct qp_source *s = NULL;
   ASSERT(data);
   qp = data;
 
@@ -1515,14 +1534,8 @@ void cb_open_file(GtkWidget *w, gpointer data)
     ASSERT(filename && filename[0]);
     gtk_widget_destroy(dialog);
 
-    s = qp_source_create(filename, QP_TYPE_UNKNOWN);
-
-#if 0
-#ifdef QP_DEBUG
-    if(s)
-      qp_source_debug_print(s);
-#endif
-#endif
+    /* The window keeps working while the file loads. */
+    qp_source_load(filename, QP_TYPE_UNKNOWN, qp, open_file_loaded, qp);
 
     g_free(filename);
   }
@@ -1531,10 +1544,6 @@ void cb_open_file(GtkWidget *w, gpointer data)
 
   /* TODO: make defaults plots or open the plot builder gui */
 
-  if(s && app->op_default_graph)
-    qp_win_graph_default_source(qp, s, NULL);
-    
-
 #if 0
   if(s)
     qp_win_make_default_plots(qp, s);
@@ -1542,6 +1551,12 @@ void cb_open_file(GtkWidget *w, gpointer data)
 
 }
 
+void cb_cancel_loading(GtkWidget *w, gpointer data)
+{
+  ASSERT(data);
+  qp_source_load_cancel((struct qp_win *) data);
+}
+
 void cb_remove_source(GtkWidget *w, gpointer data)
 {
   ASSERT(data);
@@ -72,6 +72,7 @@ ECB(graph_button_press);
 ECB(graph_button_release);
 ECB(graph_pointer_motion);
 CB(open_file);
+CB(cancel_loading);
 CB(remove_source);
 CB(new_window);
 CB(copy_window);
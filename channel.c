@@ -30,30 +30,40 @@
 #include "channel.h"
 #include "spew.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pyramid.h"
+#include "channel_pack.h"
+#include "arena.h"
 
 #ifdef DMALLOC
 #  include "dmalloc.h"
 #endif
 
 
+/* Channels are made by the threads that load files too. */
 static
 uint64_t channel_create_count = 0;
 
 
-qp_channel_t qp_channel_func_double_create(double (*func)(double),
-    double xmin, double xmax, double ymin, double ymax)
+static
+double linear_func(const struct qp_channel_func *f, size_t i)
+{
+  return f->param[0] + i*f->param[1];
+}
+
+qp_channel_t qp_channel_func_create(
+    double (*func)(const struct qp_channel_func *f, size_t i),
+    const double *param, size_t length)
 {
   struct qp_channel *c;
+  ASSERT(func);
 
-  c = (struct qp_channel *) qp_malloc(sizeof(*c));
-  c->form = QP_CHANNEL_FORM_FUNC;
-  c->value_type = QP_TYPE_DOUBLE;
-  c->id = (++channel_create_count);
-  c->func_double.func = func;
-  c->func_double.xmin = xmin;
-  c->func_double.xmax = xmax;
-  c->func_double.ymin = ymin;
-  c->func_double.ymax = ymax;
+  c = qp_channel_create(QP_CHANNEL_FORM_FUNC, QP_TYPE_DOUBLE);
+  c->func.func = func;
+  if(param)
+    memcpy(c->func.param, param, sizeof(c->func.param));
+  qp_channel_func_set_length(c, length);
   return c;
 }
 
@@ -61,17 +71,56 @@ qp_channel_t qp_channel_linear_create(double start, double step)
 {
   struct qp_channel *c;
 
-  /* TODO: rewrite this making this a function and not a
-   * big memory pig like it is now. */
-
-  c = qp_channel_create(QP_CHANNEL_FORM_SERIES, QP_TYPE_DOUBLE);
-  c->data = qp_malloc(2*sizeof(double));
-  ((double *) c->data)[0] = start;
-  ((double *) c->data)[1] = step;
+  c = qp_channel_create(QP_CHANNEL_FORM_FUNC, QP_TYPE_DOUBLE);
+  c->func.func = linear_func;
+  c->func.param[0] = start;
+  c->func.param[1] = step;
+  c->func.is_linear = 1;
+  return c;
+}
 
-  /* TODO: We setup the values in source.c */
+void qp_channel_func_set_length(qp_channel_t c, size_t length)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_func *f;
 
-  return c;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->func.func);
+  /* We disallow changing the channel when there is
+   * more than one copy of the channel, unless it is growing. */
+  ASSERT(c->series.arrays->ref_count == 1 ||
+      c->series.arrays->is_growing);
+
+  cs = &c->series;
+  f = &c->func;
+
+  cs->arrays->length = length;
+  cs->current_array = NULL;
+  cs->max = -INFINITY;
+  cs->min = INFINITY;
+  cs->has_nan = 0;
+  cs->is_increasing = 1;
+  cs->is_decreasing = 1;
+
+  if(!length)
+    return;
+
+  qp_channel_series_check_min_max(cs, f->func(f, 0));
+
+  if(f->is_linear)
+  {
+    /* We know the min and max are at the ends */
+    if(length > 1)
+      qp_channel_series_check_min_max(cs, f->func(f, length - 1));
+  }
+  else
+  {
+    size_t i;
+    /* We must look at all the values, but we keep none. */
+    for(i=1; i<length; ++i)
+      qp_channel_series_check_min_max(cs, f->func(f, i));
+  }
 }
 
 
@@ -101,30 +150,62 @@ qp_channel_t qp_channel_create(int form, int value_type)
   memset(channel, 0, sizeof(*channel));
   channel->form = form;
   channel->value_type = value_type;
-  channel->id = (++channel_create_count);
+  channel->id = __atomic_add_fetch(&channel_create_count, 1,
+      __ATOMIC_RELAXED);
   channel->data = 0;
 
 
   switch(form)
   {
+    case QP_CHANNEL_FORM_FUNC:
+      /* A function channel has a table with no arrays, so
+       * that the length and ref_count are shared with the
+       * copies like with series channels. */
+      ASSERT(value_type == QP_TYPE_DOUBLE ||
+          value_type == QP_TYPE_UNKNOWN);
+      channel->value_type = QP_TYPE_DOUBLE;
+      /* and the rest is like a series channel */
     case QP_CHANNEL_FORM_SERIES:
       {
-        channel->series.array_current_index = (size_t) -1;
-        channel->series.array_last_index = ARRAY_LENGTH -1;
-        channel->series.last_array = NULL;
-        channel->series.arrays = qp_dllist_create(NULL);
-        channel->series.ref_count = (int *)qp_malloc(sizeof(int));
-        *(channel->series.ref_count) = 1;
+        struct qp_channel_arrays *a;
+        a = (struct qp_channel_arrays *) qp_malloc(sizeof(*a));
+        a->arrays = NULL;
+        a->num_arrays = 0;
+        a->alloc_arrays = 0;
+        a->chunks = NULL;
+        a->arena = NULL;
+        a->length = 0;
+        a->pyramid = NULL;
+        a->packed = NULL;
+        a->pack = 0;
+        a->lazy = NULL;
+        a->lazy_column = 0;
+        a->lazy_ends = NULL;
+        a->ref_count = 1;
+        a->is_growing = 0;
+        channel->series.current_index = 0;
+        channel->series.current_array = NULL;
+        channel->series.cache[QP_CACHE_CURSOR] = NULL;
+        channel->series.cache[QP_CACHE_PEEK] = NULL;
+        channel->series.cache_array[QP_CACHE_CURSOR] = (size_t) -1;
+        channel->series.cache_array[QP_CACHE_PEEK] = (size_t) -1;
+        channel->series.arrays = a;
+        channel->series.scale = 1;
+        if(channel->value_type == QP_TYPE_UNKNOWN)
+        {
+          /* We start with the smallest type and let
+           * qp_channel_series_append() change it as
+           * needed. */
+          channel->value_type = QP_TYPE_SHORT;
+          channel->series.auto_type = 1;
+        }
+        ASSERT(channel->value_type == QP_TYPE_SHORT ||
+            channel->value_type == QP_TYPE_INT ||
+            channel->value_type == QP_TYPE_FLOAT ||
+            channel->value_type == QP_TYPE_DOUBLE);
       }
       break;
 
-    /* TODO: add other value_type cases */
-
-    case QP_CHANNEL_FORM_FUNC:
-      /* TODO: this code */
-      VASSERT(0, "Need more code here\n");
-      break;
-
 #ifdef QP_DEBUG
     default:
       VASSERT(0, "Bad form arg\n");
@@ -136,13 +217,290 @@ qp_channel_t qp_channel_create(int form, int value_type)
 }
 
 
+/* Adds array to the end of the channel array table */
+static
+void add_array(struct qp_channel_series *cs, void *array)
+{
+  struct qp_channel_arrays *a;
+  ASSERT(cs);
+  ASSERT(cs->arrays);
+  ASSERT(array);
+  /* We disallow having the channel written to when there
+   * is more than one copy of the channel, unless it is growing. */
+  ASSERT(cs->arrays->ref_count == 1 || cs->arrays->is_growing);
+
+  a = cs->arrays;
+
+  if(a->num_arrays == a->alloc_arrays)
+  {
+    /* grow the table by doubling it so that appending
+     * arrays costs a constant amortized time */
+    a->alloc_arrays = (a->alloc_arrays)?(2*a->alloc_arrays):16;
+    a->arrays = (void **) qp_realloc(a->arrays,
+        sizeof(void *)*a->alloc_arrays);
+    a->chunks = (struct qp_channel_chunk *) qp_realloc(a->chunks,
+        sizeof(struct qp_channel_chunk)*a->alloc_arrays);
+    if(a->pack)
+    {
+      a->packed = (struct qp_channel_packed **) qp_realloc(a->packed,
+          sizeof(*a->packed)*a->alloc_arrays);
+      memset(a->packed + a->num_arrays, 0,
+          sizeof(*a->packed)*(a->alloc_arrays - a->num_arrays));
+    }
+  }
+
+  qp_channel_chunk_init(&a->chunks[a->num_arrays]);
+  a->arrays[(a->num_arrays)++] = array;
+}
+
+/* Adds an array of ARRAY_LENGTH values of size elem_size
+ * to the end of the channel array table and returns it. */
+void *qp_channel_series_add_array(struct qp_channel_series *cs,
+    size_t elem_size)
+{
+  void *array;
+  ASSERT(cs);
+  ASSERT(elem_size > 0);
+
+  array = qp_channel_series_alloc_array(cs->arrays, elem_size);
+  add_array(cs, array);
+  return array;
+}
+
+/* The full arrays of series channels that are all NAN are these,
+ * so a channel that starts far down a file, or has no values for a
+ * long stretch of it, does not keep the NANs.  They are read only,
+ * and only full arrays are these, so nothing is appended to them. */
+static const short nan_shorts[ARRAY_LENGTH] =
+  { [0 ... ARRAY_MASK] = QP_SHORT_NAN };
+static const int nan_ints[ARRAY_LENGTH] =
+  { [0 ... ARRAY_MASK] = QP_INT_NAN };
+static const float nan_floats[ARRAY_LENGTH] =
+  { [0 ... ARRAY_MASK] = NAN };
+static const double nan_doubles[ARRAY_LENGTH] =
+  { [0 ... ARRAY_MASK] = NAN };
+
+void *qp_channel_series_nan_array(int value_type)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_SHORT:
+      return (void *) nan_shorts;
+    case QP_TYPE_INT:
+      return (void *) nan_ints;
+    case QP_TYPE_FLOAT:
+      return (void *) nan_floats;
+    case QP_TYPE_DOUBLE:
+      return (void *) nan_doubles;
+    default:
+      VASSERT(0, "bad value_type=%d\n", value_type);
+      break;
+  }
+  return NULL;
+}
+
+void qp_channel_series_add_nan_array(struct qp_channel_series *cs,
+    int value_type)
+{
+  struct qp_channel_arrays *a;
+  ASSERT(cs);
+  a = cs->arrays;
+  ASSERT(!(a->length & ARRAY_MASK));
+
+  add_array(cs, qp_channel_series_nan_array(value_type));
+  a->chunks[a->num_arrays-1].num_nan = ARRAY_LENGTH;
+  a->length += ARRAY_LENGTH;
+}
+
+void qp_channel_series_share_nan(struct qp_channel_series *cs,
+    size_t k, int value_type)
+{
+  struct qp_channel_arrays *a;
+  void *array, *nan;
+  size_t elem_size;
+
+  ASSERT(cs);
+  a = cs->arrays;
+  ASSERT(a->length >= (k + 1) << ARRAY_SHIFT);
+
+  array = a->arrays[k];
+  nan = qp_channel_series_nan_array(value_type);
+  elem_size = qp_channel_series_value_size(value_type);
+
+  if(!array || array == nan || a->chunks[k].num_nan != ARRAY_LENGTH ||
+      /* The copies may be reading it. */
+      a->is_growing ||
+      /* it may have INF too, or NANs with other bits */
+      memcmp(array, nan, elem_size*ARRAY_LENGTH))
+    return;
+
+  a->arrays[k] = nan;
+  if(cs->current_array == array)
+    cs->current_array = nan;
+  qp_channel_series_free_array(a, array, elem_size);
+}
+
+void qp_channel_series_map(qp_channel_t c, const void *values, size_t n)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  size_t elem_size, k;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  cs = &c->series;
+  a = cs->arrays;
+  ASSERT(a->ref_count == 1);
+  ASSERT(a->length == 0);
+  /* The arena keeps the values that are not in its slabs. */
+  ASSERT(a->arena);
+  ASSERT(!a->pack);
+
+  /* The arrays are read as this value_type. */
+  cs->auto_type = 0;
+  elem_size = qp_channel_series_value_size(c->value_type);
+
+  for(k=0; (k << ARRAY_SHIFT) < n; ++k)
+  {
+    size_t m;
+    m = n - (k << ARRAY_SHIFT);
+    if(values && m >= ARRAY_LENGTH)
+      /* the values stay put so this array is them */
+      add_array(cs, ((char *) values) + (k << ARRAY_SHIFT)*elem_size);
+    else
+    {
+      void *array;
+      array = qp_channel_series_add_array(cs, elem_size);
+      if(values)
+        /* The last values may end where the mapping does, and
+         * readers may look at a whole array, so we copy them. */
+        memcpy(array, ((char *) values) + (k << ARRAY_SHIFT)*elem_size,
+            m*elem_size);
+    }
+  }
+
+  a->length = n;
+  cs->current_index = 0;
+  cs->current_array = (n)?a->arrays[0]:NULL;
+}
+
+void qp_channel_series_lazy(qp_channel_t c, struct qp_channel_lazy *lazy,
+    size_t column, size_t n, struct qp_channel_chunk *chunks,
+    double *ends)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_TYPE_DOUBLE);
+  ASSERT(lazy);
+  ASSERT(lazy->ref_count > 0);
+  cs = &c->series;
+  a = cs->arrays;
+  ASSERT(a->ref_count == 1);
+  ASSERT(a->length == 0);
+  ASSERT(!a->pack);
+
+  /* The arrays are read as doubles. */
+  cs->auto_type = 0;
+
+  a->num_arrays = a->alloc_arrays = (n + ARRAY_MASK) >> ARRAY_SHIFT;
+  /* none of the arrays are in memory */
+  a->arrays = (void **) qp_malloc(sizeof(void *)*a->alloc_arrays);
+  memset(a->arrays, 0, sizeof(void *)*a->alloc_arrays);
+  a->chunks = chunks;
+  a->length = n;
+
+  ++(lazy->ref_count);
+  a->lazy = lazy;
+  a->lazy_column = column;
+  a->lazy_ends = ends;
+
+  cs->current_index = 0;
+  cs->current_array = NULL;
+
+  qp_channel_series_merge_chunks(c);
+}
+
+void qp_channel_series_merge_chunks(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  size_t k;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  cs = &c->series;
+  a = cs->arrays;
+
+  cs->max = -INFINITY;
+  cs->min = INFINITY;
+  cs->is_increasing = 1;
+  cs->is_decreasing = 1;
+  cs->has_nan = 0;
+
+  for(k=0; k<a->num_arrays; ++k)
+    qp_channel_series_check_chunk(cs, &a->chunks[k]);
+}
+
+void *qp_channel_series_alloc_array(struct qp_channel_arrays *a,
+    size_t elem_size)
+{
+  ASSERT(a);
+  if(a->arena)
+    return qp_arena_alloc(a->arena, elem_size*ARRAY_LENGTH);
+  return qp_malloc(elem_size*ARRAY_LENGTH);
+}
+
+void qp_channel_series_free_array(struct qp_channel_arrays *a,
+    void *array, size_t elem_size)
+{
+  ASSERT(a);
+  ASSERT(array);
+  if(a->arena)
+    qp_arena_free(a->arena, array, elem_size*ARRAY_LENGTH);
+  else
+    free(array);
+}
+
+void qp_channel_series_set_arena(qp_channel_t c, struct qp_arena *arena)
+{
+  struct qp_channel_arrays *a;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(arena);
+  a = c->series.arrays;
+  ASSERT(a->num_arrays == 0);
+  ASSERT(!a->arena);
+
+  qp_arena_ref(arena);
+  a->arena = arena;
+}
+
+void qp_channel_series_set_growing(qp_channel_t c)
+{
+  struct qp_channel_arrays *a;
+  ASSERT(c);
+  ASSERT(qp_channel_is_indexed(c));
+  a = c->series.arrays;
+
+  /* The copies read the arrays as this value_type. */
+  c->series.auto_type = 0;
+  /* The arrays that are compressed now stay so, but compressing
+   * more would free arrays that the copies may be reading. */
+  a->pack = 0;
+  a->is_growing = 1;
+}
+
 void qp_channel_destroy(qp_channel_t channel)
 {
   ASSERT(channel);
   if(!channel) return;
   
-  /* TODO: add other value types */
-  ASSERT(channel->value_type == QP_TYPE_UNKNOWN ||
+  ASSERT(channel->value_type == QP_TYPE_SHORT ||
+      channel->value_type == QP_TYPE_INT ||
+      channel->value_type == QP_TYPE_FLOAT ||
       channel->value_type == QP_TYPE_DOUBLE);
 
   ASSERT(channel->form == QP_CHANNEL_FORM_SERIES ||
@@ -151,25 +509,58 @@ void qp_channel_destroy(qp_channel_t channel)
   switch(channel->form)
   {
     case QP_CHANNEL_FORM_SERIES:
-      ASSERT(*(channel->series.ref_count) > 0);
-      if(*(channel->series.ref_count) == 1)
-      {
-        /* This will free the arrays too */
-        qp_dllist_destroy(channel->series.arrays, 1);
-        free(channel->series.ref_count);
-      }
-      else
+    case QP_CHANNEL_FORM_FUNC:
       {
-        /* This will not free the arrays, just the list reader */
-        qp_dllist_destroy(channel->series.arrays, 0);
-        --(*(channel->series.ref_count));
+        struct qp_channel_arrays *a;
+        a = channel->series.arrays;
+        ASSERT(a->ref_count > 0);
+        if(a->ref_count == 1)
+        {
+          /* This is the last user of the arrays so
+           * we free the arrays too */
+          if(a->packed)
+          {
+            size_t i;
+            for(i=0; i<a->num_arrays; ++i)
+              if(a->packed[i])
+                qp_channel_series_free_packed(a, i);
+            free(a->packed);
+          }
+          if(a->arena)
+            /* the arrays go with the arena */
+            qp_arena_unref(a->arena);
+          else
+          {
+            void *nan;
+            size_t i;
+            nan = qp_channel_series_nan_array(channel->value_type);
+            for(i=0; i<a->num_arrays; ++i)
+              if(a->arrays[i] != nan)
+                free(a->arrays[i]);
+          }
+          if(a->arrays)
+            free(a->arrays);
+          if(a->chunks)
+            free(a->chunks);
+          if(a->pyramid)
+            qp_channel_pyramid_destroy(a->pyramid);
+          if(a->lazy && --(a->lazy->ref_count) == 0)
+            a->lazy->destroy(a->lazy);
+          if(a->lazy_ends)
+            free(a->lazy_ends);
+          free(a);
+        }
+        else
+          /* This will not free the arrays, just the reader */
+          --(a->ref_count);
+
+        if(channel->series.cache[QP_CACHE_CURSOR])
+          free(channel->series.cache[QP_CACHE_CURSOR]);
+        if(channel->series.cache[QP_CACHE_PEEK])
+          free(channel->series.cache[QP_CACHE_PEEK]);
       }
       break;
 
-    case QP_CHANNEL_FORM_FUNC:
-      /* nothing needed here for QP_CHANNEL_FORM_FUNC */
-      break;
-
 #ifdef QP_DEBUG
     default:
       ASSERT(0);
@@ -186,66 +577,50 @@ void qp_channel_debug_append(struct qp_channel *c)
   ASSERT(c);
   switch(c->form)
   {
+    case QP_CHANNEL_FORM_FUNC:
+      APPEND(" [function is_linear=%d param=%g %g]",
+          c->func.is_linear, c->func.param[0], c->func.param[1]);
     case QP_CHANNEL_FORM_SERIES:
      
-      ASSERT(*(c->series.ref_count) > 0);
+      ASSERT(c->series.arrays->ref_count > 0);
 
-      switch(c->value_type)
       {
-        case QP_TYPE_DOUBLE:
-          {
 #if 1
-            double val;
-            APPEND(" [%zu values, min=%G, max=%g "
-                "is_increasing=%d is_decreasing=%d]",
-                qp_channel_series_length(c),
-                c->series.min,
-                c->series.max,
-                c->series.is_increasing,
-                c->series.is_decreasing);
-            for(val = qp_channel_series_double_begin(c);
-                qp_channel_series_is_reading(c);
-                val = qp_channel_series_double_next(c))
-              APPEND(" %G", val);
+        double val;
+        APPEND(" [%zu values, value_type=%d scale=%g min=%G, max=%g "
+            "is_increasing=%d is_decreasing=%d]",
+            qp_channel_series_length(c),
+            c->value_type,
+            c->series.scale,
+            c->series.min,
+            c->series.max,
+            c->series.is_increasing,
+            c->series.is_decreasing);
+        for(val = qp_channel_series_begin(c);
+            qp_channel_series_is_reading(c);
+            val = qp_channel_series_next(c))
+          APPEND(" %G", val);
 #if 1
-            APPEND("\nreverse [%zu]",
-                qp_channel_series_length(c));
-            for(val = qp_channel_series_double_end(c);
-                qp_channel_series_is_reading(c);
-                val = qp_channel_series_double_prev(c))
-              APPEND(" %G", val);
+        APPEND("\nreverse [%zu]",
+            qp_channel_series_length(c));
+        for(val = qp_channel_series_end(c);
+            qp_channel_series_is_reading(c);
+            val = qp_channel_series_prev(c))
+          APPEND(" %G", val);
 #endif
 
 #else
-            double *array;
-            struct qp_channel_series *cs;
-            cs = &c->series;
-            for(array = (double *) qp_dllist_begin(cs->arrays);
-                array;
-                array = (double *) qp_dllist_next(cs->arrays))
-            {
-              size_t i;
-              size_t len;
-              len = (array != cs->last_array)?
-                ARRAY_LENGTH:
-                cs->array_last_index+1;
-              ASSERT(len > 0);
-              for(i=0; i<len; ++i)
-                APPEND(" %G", array[i]);
-            }
+        struct qp_channel_arrays *a;
+        size_t i;
+        ASSERT(c->value_type == QP_TYPE_DOUBLE);
+        a = c->series.arrays;
+        for(i=0; i<a->length; ++i)
+          APPEND(" %G", ((double *)
+                a->arrays[i >> ARRAY_SHIFT])[i & ARRAY_MASK]);
 #endif
-          }
-          break;
-
-          /* TODO: add other cases */
-        default:
-          ASSERT(0);
-          break;
       }
     break;
 
-    /* TODO: Write function case */
-
     default:
     ASSERT(0);
     break;
@@ -50,6 +50,9 @@
 
 
 #define ARRAY_LENGTH  (4*1024)
+/* ARRAY_LENGTH = 1 << ARRAY_SHIFT */
+#define ARRAY_SHIFT   (12)
+#define ARRAY_MASK    (ARRAY_LENGTH - 1)
 
 /* a small positive double used to avoid dividing
  * by zero when scaling plot values. */
@@ -57,23 +60,120 @@
 #define LARGE_DOUBLE  (DBL_MAX/10.0)
 
 
+/* A summary of the values in one array of a series channel, or
+ * of any range of values, so we can ask about a range of values
+ * without reading all of them. */
+struct qp_channel_chunk
+{
+  /* min and max of the values that are not like NAN or INF,
+   * or INFINITY and -INFINITY if there are none. */
+  double min, max;
+  size_t num_nan; /* number of values like +/-NAN or +/-INF */
+  /* each value is larger (smaller) than all the values before
+   * it, not counting the NAN like values */
+  int is_increasing, is_decreasing;
+};
+
+
+/* Where a series channel gets the values of its arrays when they
+ * are not kept in memory, like the values in a text file that are
+ * parsed again when they are read.  One of these is shared by all
+ * the channels of a source, and each channel reads its own column.
+ * See qp_channel_series_lazy() and source_lazy.c */
+struct qp_channel_lazy
+{
+  /* Writes the values of array k of column into values, as
+   * doubles, ARRAY_LENGTH of them or less for the last array. */
+  void (*read)(struct qp_channel_lazy *lazy, size_t column, size_t k,
+      double *values);
+  /* frees the lazy when the last channel that uses it is
+   * destroyed */
+  void (*destroy)(struct qp_channel_lazy *lazy);
+  int ref_count;
+};
+
+
+/* This is the table of arrays that holds the values of a
+ * series channel.  The table is shared by the channel and
+ * all the copies of the channel, so the larger memory
+ * usage is not replicated, and making a copy is cheap.
+ * Value i is in arrays[i >> ARRAY_SHIFT] at
+ * index (i & ARRAY_MASK), so we get any value without
+ * walking a list. */
+struct qp_channel_arrays
+{
+  /* each element is an array of ARRAY_LENGTH values
+   * of the channel value_type that was made with
+   * malloc(), or the array from qp_channel_series_nan_array()
+   * if they are all NAN. */
+  void **arrays;
+  size_t num_arrays; /* number of arrays in use */
+  size_t alloc_arrays; /* number of pointers allocated in arrays */
+
+  /* chunks[k] is the summary of the values in arrays[k] */
+  struct qp_channel_chunk *chunks;
+
+  /* The arrays are from this arena, or from malloc() if it
+   * is NULL.  See arena.h */
+  struct qp_arena *arena;
+
+  size_t length; /* total number of values */
+
+  /* The min/max summary of the values that is used to draw
+   * zoomed out plots, or NULL if it is not made yet.  See
+   * channel_pyramid.h */
+  struct qp_channel_pyramid *pyramid;
+
+  /* If pack is set the arrays are compressed as they fill and
+   * packed[k] is the compressed array k, in place of arrays[k]
+   * which is then NULL.  packed is NULL if pack is not set.
+   * See channel_pack.h */
+  struct qp_channel_packed **packed;
+  int pack;
+
+  /* If lazy is set the values are not in memory.  arrays[k] is
+   * NULL and array k is read with lazy->read() of lazy_column into
+   * the cache of the reader.  lazy_ends[2*k] and lazy_ends[2*k+1]
+   * are the first and last values of array k, so drawing zoomed
+   * out plots with the pyramid does not read the arrays. */
+  struct qp_channel_lazy *lazy;
+  size_t lazy_column;
+  double *lazy_ends;
+
+  /* number of channels (the original and copies)
+   * that use this table. */
+  int ref_count;
+
+  /* If set values are still appended to this table while
+   * copies read it.  See qp_channel_series_set_growing(). */
+  int is_growing;
+};
+
+
+/* The caches that compressed arrays are read from.  The cursor
+ * readers use one and the functions that look at values without
+ * moving the cursor, like the searches, use the other, so they
+ * do not undo each other. */
+#define QP_CACHE_CURSOR  (0)
+#define QP_CACHE_PEEK    (1)
+#define QP_NUM_CACHES    (2)
+
 struct qp_channel_series
 {
   /* TYPE_SHORT or TYPE_INT ... etc type in the arrays */
 
-  /* each element in the qp_dllist is an array of values */
-  size_t array_current_index; /* index of the current value
-                                 read in the current array */
-  size_t array_last_index; /* the index of the last value
-                              in the last array */
-  void *last_array; /* points to last array */
+  /* The reading cursor.  Every copy of the channel has
+   * its own cursor, so plots, pickers and the draw loop
+   * can all read the same values at the same time. */
+  size_t current_index; /* index of the current value read */
+  void *current_array;  /* array with the current value,
+                         * or NULL if we are not reading */
 
-  /* The copies of this channel will share these arrays.
-   * So the larger memory usage is not replicated. */
-  struct qp_dllist *arrays; /* list of arrays.  The value
-                             * in each list element is just
-                             * the array of value_types that
-                             * was made with malloc(). */
+  /* The copies of this channel will share this.
+   * The qp_channel_series is just a writer/reader of the
+   * arrays.  Once you start making copies you can no
+   * longer write. */
+  struct qp_channel_arrays *arrays;
 
   int is_increasing;
   int is_decreasing;
@@ -81,20 +181,43 @@ struct qp_channel_series
    
   double min, max; /* for zoom/scale calculations */
 
-  /* We can make copies of qp_channel_series.
-   * The qp_channel_series is just a writer/reader of the
-   * arrays.  Once you start making copies you can no
-   * longer write. */
-  int *ref_count;
+  /* For the integer value types the stored value is
+   * rint(value*scale), so scale = 10^N lets us store
+   * numbers with N decimal digits in a short or int.
+   * scale is 1 for all other value types. */
+  double scale;
+
+  /* If set the value_type is picked as values are
+   * appended, starting with the smallest type and
+   * changing to a larger type when a value will not
+   * fit without loss. */
+  int auto_type;
+
+  /* cache[n] has the values of the compressed array
+   * cache_array[n] uncompressed, or cache_array[n] is
+   * (size_t) -1.  Every copy of the channel has its own. */
+  void *cache[QP_NUM_CACHES];
+  size_t cache_array[QP_NUM_CACHES];
 };
 
 
 
-struct qp_channel_func_double
+#define QP_CHANNEL_FUNC_PARAMS  (4)
+
+/* A QP_CHANNEL_FORM_FUNC channel computes the value at index i
+ * when it is read, so it uses no memory for the values. */
+struct qp_channel_func
 {
-  double (*func)(double x);
-  double xmax, xmin;
-  double ymax, ymin;
+  /* returns the value at index i */
+  double (*func)(const struct qp_channel_func *f, size_t i);
+
+  /* for linear channels param[0] is the start and param[1]
+   * is the step */
+  double param[QP_CHANNEL_FUNC_PARAMS];
+
+  /* if set the value is param[0] + i*param[1] and we can
+   * get the index of a value without searching. */
+  int is_linear;
 };
 
 
@@ -105,11 +228,15 @@ struct qp_channel
   /* A pointer to put extra stuff at */
   void *data;
   uint64_t id;  /* unique id for this channel and all copies */
-  union
-  {
-    struct qp_channel_series series;
-    struct qp_channel_func_double func_double;
-  };
+
+  /* Both forms have the reading cursor, length, min, max,
+   * and so on in series.  QP_CHANNEL_FORM_FUNC channels have
+   * no arrays in series.arrays, just the length and
+   * ref_count. */
+  struct qp_channel_series series;
+
+  /* only for QP_CHANNEL_FORM_FUNC */
+  struct qp_channel_func func;
 };
 
 static
@@ -123,29 +250,339 @@ int is_good_double(double x)
 }
 
 
+/* keeps the min, max, is_increasing, is_decreasing and
+ * has_nan of a series up to date as val is appended */
+static inline
+void qp_channel_series_check_min_max(struct qp_channel_series *cs,
+    double val)
+{
+  if(!is_good_double(val))
+  {
+    cs->has_nan = 1;
+    return;
+  }
+
+  if(val > cs->max)
+    cs->max = val;
+  else
+    cs->is_increasing = 0;
+
+  if(val < cs->min)
+    cs->min = val;
+  else
+    cs->is_decreasing = 0;
+}
+
+static inline
+void qp_channel_chunk_init(struct qp_channel_chunk *k)
+{
+  k->min = INFINITY;
+  k->max = -INFINITY;
+  k->num_nan = 0;
+  k->is_increasing = 1;
+  k->is_decreasing = 1;
+}
+
+/* like qp_channel_series_check_min_max() but for the summary
+ * of a chunk of values */
+static inline
+void qp_channel_chunk_check(struct qp_channel_chunk *k, double val)
+{
+  if(!is_good_double(val))
+  {
+    ++(k->num_nan);
+    return;
+  }
+
+  if(val > k->max)
+    k->max = val;
+  else
+    k->is_increasing = 0;
+
+  if(val < k->min)
+    k->min = val;
+  else
+    k->is_decreasing = 0;
+}
+
+/* adds the summary of the values in k, which come after the
+ * values in r, to r */
+static inline
+void qp_channel_chunk_merge(struct qp_channel_chunk *r,
+    const struct qp_channel_chunk *k)
+{
+  r->is_increasing = (r->is_increasing && k->is_increasing &&
+      k->min > r->max)?1:0;
+  r->is_decreasing = (r->is_decreasing && k->is_decreasing &&
+      k->max < r->min)?1:0;
+  if(k->min < r->min)
+    r->min = k->min;
+  if(k->max > r->max)
+    r->max = k->max;
+  r->num_nan += k->num_nan;
+}
+
+/* what the series channel search functions pass to the
+ * qp_channel_gallop() past() callback */
+struct qp_channel_search
+{
+  qp_channel_t c;
+  double val;
+  int or_equal;
+  size_t array; /* which array we are searching in */
+  size_t n;     /* number of values in that array */
+};
+
+/* returns 1 if x is past val in a search, that is x > val or
+ * x >= val if or_equal is set */
+static inline
+int qp_channel_search_is_past(double x, double val, int or_equal)
+{
+  return (or_equal)?((x >= val)?1:0):((x > val)?1:0);
+}
+
+/* Returns the first i in [0, n) with past(data, i) set, or n if
+ * there is none, where past() is 0 up to some i and 1 from there
+ * on.  We start at the guess and gallop away from it with steps
+ * that double until we pass the answer, and then bisect.  That
+ * calls past() about 2*log2(d) times where d is how far the guess
+ * is from the answer, so a good guess costs little and a bad one
+ * is never worse than O(log n). */
+static inline
+size_t qp_channel_gallop(size_t n, size_t guess,
+    int (*past)(void *data, size_t i), void *data)
+{
+  size_t lo = 0, hi = n, step = 1;
+
+  if(n == 0)
+    return 0;
+  if(guess >= n)
+    guess = n - 1;
+
+  if(past(data, guess))
+  {
+    hi = guess;
+    while(hi > 0)
+    {
+      size_t i;
+      i = (hi > step)?(hi - step):0;
+      if(!past(data, i))
+      {
+        lo = i + 1;
+        break;
+      }
+      hi = i;
+      step *= 2;
+    }
+  }
+  else
+  {
+    lo = guess + 1;
+    while(lo < n)
+    {
+      size_t i;
+      i = lo - 1 + step;
+      if(i >= n)
+        break;
+      if(past(data, i))
+      {
+        hi = i;
+        break;
+      }
+      lo = i + 1;
+      step *= 2;
+    }
+  }
+
+  while(lo < hi)
+  {
+    size_t mid;
+    mid = lo + (hi - lo)/2;
+    if(past(data, mid))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+/* Gets the summary of n values in k, the same as
+ * qp_channel_chunk_init() and then qp_channel_chunk_check() with
+ * each value.  When there are no NAN like values we use loops
+ * with no branches that the compiler can vectorize. */
+static inline
+void qp_channel_chunk_summary(struct qp_channel_chunk *k,
+    const double *v, size_t n)
+{
+  size_t i, num_bad = 0;
+  double min = INFINITY, max = -INFINITY;
+  int is_increasing = 1, is_decreasing = 1;
+
+  qp_channel_chunk_init(k);
+
+  for(i=0; i<n; ++i)
+    num_bad += (v[i] > -LARGE_DOUBLE && v[i] < LARGE_DOUBLE)?0:1;
+
+  if(num_bad)
+  {
+    for(i=0; i<n; ++i)
+      qp_channel_chunk_check(k, v[i]);
+    return;
+  }
+
+  for(i=0; i<n; ++i)
+  {
+    min = (v[i] < min)?v[i]:min;
+    max = (v[i] > max)?v[i]:max;
+  }
+  for(i=1; i<n; ++i)
+  {
+    is_increasing &= (v[i] > v[i-1]);
+    is_decreasing &= (v[i] < v[i-1]);
+  }
+
+  k->min = min;
+  k->max = max;
+  k->is_increasing = is_increasing;
+  k->is_decreasing = is_decreasing;
+}
+
+/* like qp_channel_series_check_min_max() but for the summary of
+ * many values that are appended at once */
+static inline
+void qp_channel_series_check_chunk(struct qp_channel_series *cs,
+    const struct qp_channel_chunk *k)
+{
+  if(k->num_nan)
+    cs->has_nan = 1;
+  if(!(k->min <= k->max))
+    /* there are no good values */
+    return;
+
+  cs->is_increasing = (cs->is_increasing && k->is_increasing &&
+      k->min > cs->max)?1:0;
+  cs->is_decreasing = (cs->is_decreasing && k->is_decreasing &&
+      k->max < cs->min)?1:0;
+  if(k->min < cs->min)
+    cs->min = k->min;
+  if(k->max > cs->max)
+    cs->max = k->max;
+}
+
+/* returns the size in bytes of a value of value_type as
+ * it is stored in the arrays of a series channel */
+static inline
+size_t qp_channel_series_value_size(int value_type)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_SHORT:
+      return sizeof(short);
+    case QP_TYPE_INT:
+      return sizeof(int);
+    case QP_TYPE_FLOAT:
+      return sizeof(float);
+    case QP_TYPE_DOUBLE:
+      return sizeof(double);
+    default:
+      VASSERT(0, "value_type=%d is not stored in series channels\n",
+          value_type);
+      break;
+  }
+  return 0;
+}
+
+
+/* returns the value_type for a series value type name or -1
+ * if name is not one.  "auto" is QP_TYPE_UNKNOWN which lets
+ * the loader pick the smallest type that holds the values. */
+static inline
+int qp_channel_value_type_from_name(const char *name)
+{
+  if(!strcasecmp(name, "auto"))
+    return QP_TYPE_UNKNOWN;
+  if(!strcasecmp(name, "short"))
+    return QP_TYPE_SHORT;
+  if(!strcasecmp(name, "int"))
+    return QP_TYPE_INT;
+  if(!strcasecmp(name, "float"))
+    return QP_TYPE_FLOAT;
+  if(!strcasecmp(name, "double"))
+    return QP_TYPE_DOUBLE;
+  return -1;
+}
+
+static inline
+const char *qp_channel_value_type_name(int value_type)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_UNKNOWN:
+      return "auto";
+    case QP_TYPE_SHORT:
+      return "short";
+    case QP_TYPE_INT:
+      return "int";
+    case QP_TYPE_FLOAT:
+      return "float";
+    case QP_TYPE_DOUBLE:
+      return "double";
+    case QP_TYPE_MULTIPLE:
+      return "multiple";
+    default:
+      break;
+  }
+  return "unknown";
+}
+
+
+/* returns 1 if the channel has values at indexes 0 to length-1
+ * with the length, min, max, and so on in c->series.
+ * QP_CHANNEL_FORM_SERIES channels store the values and
+ * QP_CHANNEL_FORM_FUNC channels compute them. */
+static inline
+int qp_channel_is_indexed(const struct qp_channel *c)
+{
+  return (c->form == QP_CHANNEL_FORM_SERIES ||
+      c->form == QP_CHANNEL_FORM_FUNC)?1:0;
+}
+
 /* return 1 if the value last read is valid and not past
  * a leading or trailing edge. */
 static inline
 int qp_channel_series_is_reading(qp_channel_t channel)
 {
-  ASSERT(channel->form == QP_CHANNEL_FORM_SERIES);
-  return (qp_dllist_val(channel->series.arrays))?1:0;
+  ASSERT(qp_channel_is_indexed(channel));
+  return (channel->series.current_array)?1:0;
 }
 
 extern
 qp_channel_t qp_channel_create(int channel_form, int value_type);
 
+/* Makes a QP_CHANNEL_FORM_FUNC channel with values
+ * start + i*step and a length of zero.  Set the length
+ * with qp_channel_func_set_length(). */
 extern
 qp_channel_t qp_channel_linear_create(double start, double step);
 
+/* Makes a QP_CHANNEL_FORM_FUNC channel with values func(f, i)
+ * for i = [ 0, length-1 ], where f->param is a copy of param. */
+extern
+qp_channel_t qp_channel_func_create(
+    double (*func)(const struct qp_channel_func *f, size_t i),
+    const double *param, size_t length);
+
+/* Sets the number of values in a QP_CHANNEL_FORM_FUNC channel
+ * and the min, max, and so on that go with them.  Like writing
+ * to a series channel, you may not do this after a copy of the
+ * channel is made. */
+extern
+void qp_channel_func_set_length(qp_channel_t c, size_t length);
+
 /* if orig != NULL this returns a channel that points to the
  * same data as orig.  After a copy is made you may not write
  * to the channel any more. */
 
-extern
-qp_channel_t qp_channel_func_double_create(double (*func)(double),
-    double xmin, double xmax, double ymin, double ymax);
-
 
 static inline
 qp_channel_t qp_channel_series_create(qp_channel_t orig, int value_type)
@@ -156,25 +593,34 @@ qp_channel_t qp_channel_series_create(qp_channel_t orig, int value_type)
     struct qp_channel *c;
 
     ASSERT(orig->value_type > 0 && orig->value_type <= QP_TYPE_MAX);
-    ASSERT(orig->form == QP_CHANNEL_FORM_SERIES);
+    ASSERT(qp_channel_is_indexed(orig));
     ASSERT(orig->series.arrays);
 
     c = (struct qp_channel *) qp_malloc(sizeof(*c));
-    c->form = QP_CHANNEL_FORM_SERIES;
+    c->form = orig->form;
+    c->func = orig->func;
     c->id = orig->id;
     c->value_type = orig->value_type;
-    c->series.array_current_index = (size_t) -1;
-    c->series.array_last_index = orig->series.array_last_index;
-    c->series.last_array = orig->series.last_array;
-    c->series.arrays = qp_dllist_create(orig->series.arrays);
-    c->series.ref_count = orig->series.ref_count;
+    c->data = NULL;
+    c->series.current_index = 0;
+    c->series.current_array = NULL;
+    c->series.arrays = orig->series.arrays;
     c->series.is_increasing = orig->series.is_increasing;
     c->series.is_decreasing = orig->series.is_decreasing;
     c->series.min = orig->series.min;
     c->series.max = orig->series.max;
     c->series.has_nan = orig->series.has_nan;
-
-    ++(*(c->series.ref_count));
+    c->series.scale = orig->series.scale;
+    c->series.auto_type = 0;
+    c->series.cache[QP_CACHE_CURSOR] = NULL;
+    c->series.cache[QP_CACHE_PEEK] = NULL;
+    c->series.cache_array[QP_CACHE_CURSOR] = (size_t) -1;
+    c->series.cache_array[QP_CACHE_PEEK] = (size_t) -1;
+    /* The copies read the arrays as this value_type so it
+     * may not change any more. */
+    orig->series.auto_type = 0;
+
+    ++(c->series.arrays->ref_count);
     return c;
   }
   else
@@ -186,19 +632,134 @@ qp_channel_t qp_channel_series_create(qp_channel_t orig, int value_type)
 extern
 void qp_channel_destroy(qp_channel_t channel);
 
+/* Adds an array for ARRAY_LENGTH more values to the
+ * end of the channel and returns the new array. */
+extern
+void *qp_channel_series_add_array(struct qp_channel_series *cs,
+    size_t elem_size);
+
+/* Get and free arrays of ARRAY_LENGTH values of elem_size bytes
+ * from the arena of the array table or with malloc(). */
+extern
+void *qp_channel_series_alloc_array(struct qp_channel_arrays *a,
+    size_t elem_size);
+
+extern
+void qp_channel_series_free_array(struct qp_channel_arrays *a,
+    void *array, size_t elem_size);
+
+/* Returns the read only array of ARRAY_LENGTH NANs of value_type
+ * that all the full arrays of NAN in series channels share.  Check
+ * for it before freeing, compressing or writing an array. */
+extern
+void *qp_channel_series_nan_array(int value_type);
+
+/* Adds the shared array of NAN to the end of the channel, which
+ * must end with a full array, making it ARRAY_LENGTH longer.  Use
+ * qp_channel_series_append_nan(). */
+extern
+void qp_channel_series_add_nan_array(struct qp_channel_series *cs,
+    int value_type);
+
+/* If the full array k of cs is all NAN, frees it and uses the
+ * shared array of NAN in its place. */
+extern
+void qp_channel_series_share_nan(struct qp_channel_series *cs,
+    size_t k, int value_type);
+
+/* Makes the arrays of a series channel come from arena.  Call
+ * this before any values are appended.  The arrays are released
+ * with the arena, after the last channel that uses them is
+ * destroyed. */
+extern
+void qp_channel_series_set_arena(qp_channel_t c, struct qp_arena *arena);
+
+/* Lets the channel c, or one copy of it, be appended to after
+ * there are copies of it that read it, like when we read a pipe
+ * as the data comes in.  The value_type may not change after this
+ * and the arrays that fill are no longer compressed, so that the
+ * arrays that the copies are reading stay put.  Use
+ * qp_channel_series_sync() to let the copies see the new values. */
+extern
+void qp_channel_series_set_growing(qp_channel_t c);
+
+/* Gives the empty series channel c, that has an arena, n values
+ * in arrays that are not filled by appending.  If values is not
+ * NULL they are n values of the channel value_type that stay put
+ * until the arena is released, like a file that is mmap()ed and
+ * given to qp_arena_add_map(), and the full arrays are the values
+ * in place with no copy.  If values is NULL the arrays are made
+ * and the caller writes the values to c->series.arrays->arrays[k].
+ * The channel may not be compressed.  Then call
+ * qp_channel_series_summarize() for each array, and then
+ * qp_channel_series_merge_chunks(). */
+extern
+void qp_channel_series_map(qp_channel_t c, const void *values, size_t n);
+
+/* Makes the empty double series channel c get its n values from
+ * column of lazy, in place of keeping them in arrays.  The channel
+ * takes chunks, the summaries of the arrays, and ends, see struct
+ * qp_channel_arrays lazy_ends, which are from malloc(), and sets its
+ * min, max and so on from the chunks. */
+extern
+void qp_channel_series_lazy(qp_channel_t c, struct qp_channel_lazy *lazy,
+    size_t column, size_t n, struct qp_channel_chunk *chunks,
+    double *ends);
+
+/* Sets the min, max and so on of the series channel c from
+ * the summaries of its arrays. */
+extern
+void qp_channel_series_merge_chunks(qp_channel_t c);
+
+/* Uncompresses array k, or reads it if the channel is lazy, into
+ * cache slot of the channel series cs and returns the cache.  Use
+ * qp_channel_series_array(). */
+extern
+void *qp_channel_series_unpack(struct qp_channel_series *cs,
+    size_t k, int slot);
+
+/* returns array k of the channel series cs, uncompressing or
+ * reading it into cache slot if it is compressed or lazy. */
+static inline
+void *qp_channel_series_array(struct qp_channel_series *cs,
+    size_t k, int slot)
+{
+  ASSERT(k < cs->arrays->num_arrays);
+  if(cs->arrays->arrays[k])
+    return cs->arrays->arrays[k];
+  return qp_channel_series_unpack(cs, k, slot);
+}
+
 
 static inline
 size_t qp_channel_series_length(struct qp_channel *c)
 {
   ASSERT(c);
-  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(qp_channel_is_indexed(c));
   ASSERT(c->series.arrays);
 
-  return (qp_dllist_length(c->series.arrays)-1)*ARRAY_LENGTH +
-    c->series.array_last_index + 1;
+  return c->series.arrays->length;
 }
 
 
+/* Gets the min, max and the other things that the channel copy
+ * keeps about the values from orig, after values where appended
+ * to orig.  The length is shared already. */
+static inline
+void qp_channel_series_sync(struct qp_channel *copy,
+    const struct qp_channel *orig)
+{
+  ASSERT(copy);
+  ASSERT(orig);
+  ASSERT(copy->series.arrays == orig->series.arrays);
+
+  copy->series.min = orig->series.min;
+  copy->series.max = orig->series.max;
+  copy->series.is_increasing = orig->series.is_increasing;
+  copy->series.is_decreasing = orig->series.is_decreasing;
+  copy->series.has_nan = orig->series.has_nan;
+}
+
 static inline
 int qp_channel_equals(struct qp_channel *c1, struct qp_channel *c2)
 {
@@ -0,0 +1,150 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sys/types.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "list.h"
+#include "channel.h"
+#include "spew.h"
+#include "channel_double.h"
+#include "channel_func.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+
+double qp_channel_func_begin(qp_channel_t c)
+{
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  if(c->series.arrays->length)
+    return qp_channel_func_index(c, 0);
+
+  c->series.current_array = NULL;
+  return END_DOUBLE;
+}
+
+double qp_channel_func_end(qp_channel_t c)
+{
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  if(c->series.arrays->length)
+    return qp_channel_func_index(c, c->series.arrays->length - 1);
+
+  c->series.current_array = NULL;
+  return END_DOUBLE;
+}
+
+static
+int func_is_past(void *data, size_t i)
+{
+  struct qp_channel_search *d;
+  d = (struct qp_channel_search *) data;
+  return qp_channel_search_is_past(d->c->func.func(&d->c->func, i),
+      d->val, d->or_equal);
+}
+
+size_t qp_channel_func_search(qp_channel_t c, double val, int or_equal)
+{
+  struct qp_channel_search d;
+  struct qp_channel_func *f;
+  size_t len, guess = 0;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->series.is_increasing);
+
+  f = &c->func;
+  len = qp_channel_series_length(c);
+  if(!len)
+    return 0;
+
+  if(f->is_linear)
+  {
+    double x;
+    /* step is > 0 given it's increasing, so this is the
+     * answer or next to it */
+    x = (val - f->param[0])/f->param[1];
+    if(x >= len - 1)
+      guess = len - 1;
+    else if(x > 0)
+      guess = (size_t) x;
+  }
+  else if(c->series.max > c->series.min && val > c->series.min)
+  {
+    /* guess that the values increase linearly */
+    guess = (size_t) ((len - 1)*((val - c->series.min)/
+          (c->series.max - c->series.min)));
+    if(guess > len - 1)
+      guess = len - 1;
+  }
+
+  d.c = c;
+  d.val = val;
+  d.or_equal = or_equal;
+  return qp_channel_gallop(len, guess, func_is_past, &d);
+}
+
+size_t qp_channel_func_find_lt(qp_channel_t c, double *v)
+{
+  size_t i;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->series.is_increasing);
+  ASSERT(c->series.min != c->series.max);
+
+  /* the value before the first value >= *v */
+  i = qp_channel_func_search(c, *v, 1);
+  if(i)
+    --i;
+
+  *v = qp_channel_func_index(c, i);
+  return i;
+}
+
+size_t qp_channel_func_find_gt(qp_channel_t c, double *v)
+{
+  size_t i, len;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(c->series.is_increasing);
+  ASSERT(c->series.min != c->series.max);
+
+  len = qp_channel_series_length(c);
+  i = qp_channel_func_search(c, *v, 0);
+  if(i == len)
+    i = len - 1;
+
+  *v = qp_channel_func_index(c, i);
+  return i;
+}
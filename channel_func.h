@@ -0,0 +1,122 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Readers for QP_CHANNEL_FORM_FUNC channels.  They are like the
+ * series channel readers but the values are computed when they
+ * are read.  The channel has no arrays so current_array is just
+ * set to something that is not NULL while we are reading. */
+
+#ifndef END_DOUBLE
+#error "You must include channel_double.h before this file."
+#endif
+
+
+extern
+double qp_channel_func_begin(qp_channel_t c);
+
+extern
+double qp_channel_func_end(qp_channel_t c);
+
+/* Like qp_channel_series_double_search() but for an increasing
+ * function channel.  Linear channels compute the answer in place
+ * of searching. */
+extern
+size_t qp_channel_func_search(qp_channel_t c, double val, int or_equal);
+
+/* Like qp_channel_series_double_find_lt() but for an
+ * increasing function channel. */
+extern
+size_t qp_channel_func_find_lt(qp_channel_t c, double *v);
+
+/* Like qp_channel_series_double_find_gt() but for an
+ * increasing function channel. */
+extern
+size_t qp_channel_func_find_gt(qp_channel_t c, double *v);
+
+
+/* Check that i is in bounds before this call */
+static inline
+double qp_channel_func_index(qp_channel_t c, size_t i)
+{
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(i < qp_channel_series_length(c));
+
+  c->series.current_index = i;
+  c->series.current_array = &c->func;
+  return c->func.func(&c->func, i);
+}
+
+/* This returns the current index or (size_t) -1 if their is none. */
+static inline
+size_t qp_channel_func_get_index(qp_channel_t c)
+{
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+  ASSERT(qp_channel_series_is_reading(c));
+
+  if(!qp_channel_series_is_reading(c))
+    return (size_t) -1;
+
+  return c->series.current_index;
+}
+
+static inline
+double qp_channel_func_next(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+
+  cs = &c->series;
+
+  if(!cs->current_array) return END_DOUBLE;
+
+  if(++(cs->current_index) >= cs->arrays->length)
+  {
+    /* push it past the end */
+    cs->current_array = NULL;
+    return END_DOUBLE;
+  }
+
+  return c->func.func(&c->func, cs->current_index);
+}
+
+static inline
+double qp_channel_func_prev(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_FUNC);
+
+  cs = &c->series;
+
+  if(!cs->current_array) return END_DOUBLE;
+
+  if(cs->current_index == 0)
+  {
+    /* push it past the begining */
+    cs->current_array = NULL;
+    return END_DOUBLE;
+  }
+
+  return c->func.func(&c->func, --(cs->current_index));
+}
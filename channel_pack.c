@@ -0,0 +1,563 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "list.h"
+#include "channel.h"
+#include "spew.h"
+#include "channel_double.h"
+#include "channel_pack.h"
+#include "arena.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* Bits are written and read most significant first.  The
+ * buffer must be zeroed before it is written to. */
+struct qp_bits
+{
+  unsigned char *buf;
+  size_t size; /* number of bytes in buf */
+  size_t pos;  /* number of bits written or read */
+};
+
+
+/* writes the low n bits of x, n <= 64.  Returns 0 if there is
+ * no room. */
+static inline
+int put_bits(struct qp_bits *b, uint64_t x, int n)
+{
+  if(b->pos + n > 8*b->size)
+    return 0;
+
+  while(n)
+  {
+    int room, m;
+    room = 8 - (b->pos & 7);
+    m = (n < room)?n:room;
+    b->buf[b->pos >> 3] |=
+      (unsigned char) (((x >> (n - m)) & ((1U << m) - 1)) << (room - m));
+    b->pos += m;
+    n -= m;
+  }
+  return 1;
+}
+
+/* reads n bits, n <= 64 */
+static inline
+uint64_t get_bits(struct qp_bits *b, int n)
+{
+  uint64_t x = 0;
+  ASSERT(b->pos + n <= 8*b->size);
+
+  while(n)
+  {
+    int room, m;
+    room = 8 - (b->pos & 7);
+    m = (n < room)?n:room;
+    x = (x << m) |
+      ((b->buf[b->pos >> 3] >> (room - m)) & ((1U << m) - 1));
+    b->pos += m;
+    n -= m;
+  }
+  return x;
+}
+
+/* the bits of value j in array */
+static inline
+uint64_t load_bits(const void *array, size_t j, size_t elem_size)
+{
+  switch(elem_size)
+  {
+    case 2:
+      return ((const uint16_t *) array)[j];
+    case 4:
+      return ((const uint32_t *) array)[j];
+    case 8:
+      return ((const uint64_t *) array)[j];
+    default:
+      VASSERT(0, "bad elem_size=%zu\n", elem_size);
+      break;
+  }
+  return 0;
+}
+
+static inline
+void store_bits(void *array, size_t j, size_t elem_size, uint64_t x)
+{
+  switch(elem_size)
+  {
+    case 2:
+      ((uint16_t *) array)[j] = (uint16_t) x;
+      break;
+    case 4:
+      ((uint32_t *) array)[j] = (uint32_t) x;
+      break;
+    case 8:
+      ((uint64_t *) array)[j] = x;
+      break;
+    default:
+      VASSERT(0, "bad elem_size=%zu\n", elem_size);
+      break;
+  }
+}
+
+/* the value of integer j in array with the sign */
+static inline
+int64_t load_int(const void *array, size_t j, size_t elem_size)
+{
+  if(elem_size == sizeof(short))
+    return ((const short *) array)[j];
+  return ((const int *) array)[j];
+}
+
+/* So that small negative numbers are small too:
+ * 0, -1, 1, -2, 2 ... are 0, 1, 2, 3, 4 ... */
+static inline
+uint64_t zigzag(int64_t x)
+{
+  return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+static inline
+int64_t unzigzag(uint64_t z)
+{
+  return (int64_t) (z >> 1) ^ -((int64_t) (z & 1));
+}
+
+
+/* Each run is a 16 bit count and the value.  Returns 0 if it does
+ * not fit in b. */
+static
+int rle_pack(struct qp_bits *b, const void *array, size_t elem_size)
+{
+  size_t j = 0;
+  while(j < ARRAY_LENGTH)
+  {
+    uint64_t x;
+    size_t n = 1;
+    x = load_bits(array, j, elem_size);
+    while(j + n < ARRAY_LENGTH && load_bits(array, j + n, elem_size) == x)
+      ++n;
+    if(!put_bits(b, n - 1, 16) || !put_bits(b, x, 8*elem_size))
+      return 0;
+    j += n;
+  }
+  return 1;
+}
+
+static
+void rle_unpack(struct qp_bits *b, void *array, size_t elem_size)
+{
+  size_t j = 0;
+  while(j < ARRAY_LENGTH)
+  {
+    uint64_t x;
+    size_t n;
+    n = get_bits(b, 16) + 1;
+    x = get_bits(b, 8*elem_size);
+    ASSERT(j + n <= ARRAY_LENGTH);
+    for(n += j; j < n; ++j)
+      store_bits(array, j, elem_size, x);
+  }
+}
+
+/* The first value and then the delta of the delta from one value
+ * to the next, zigzag coded, with a prefix that tells the number of
+ * bits that follow:
+ *
+ *    0           zero
+ *    10    + 7   bits
+ *    110   + 12  bits
+ *    1110  + 20  bits
+ *    1111  + 40  bits
+ */
+static
+int delta_pack(struct qp_bits *b, const void *array, size_t elem_size)
+{
+  int64_t prev, delta = 0;
+  size_t j;
+
+  prev = load_int(array, 0, elem_size);
+  if(!put_bits(b, zigzag(prev), 8*elem_size))
+    return 0;
+
+  for(j=1; j<ARRAY_LENGTH; ++j)
+  {
+    int64_t x;
+    uint64_t z;
+    int ret;
+    x = load_int(array, j, elem_size);
+    z = zigzag((x - prev) - delta);
+    delta = x - prev;
+    prev = x;
+
+    if(z == 0)
+      ret = put_bits(b, 0, 1);
+    else if(z < (1 << 7))
+      ret = put_bits(b, (2 << 7) | z, 2 + 7);
+    else if(z < (1 << 12))
+      ret = put_bits(b, (6 << 12) | z, 3 + 12);
+    else if(z < (1 << 20))
+      ret = put_bits(b, (14 << 20) | z, 4 + 20);
+    else
+      ret = put_bits(b, 15, 4) && put_bits(b, z, 40);
+    if(!ret)
+      return 0;
+  }
+  return 1;
+}
+
+static
+void delta_unpack(struct qp_bits *b, void *array, size_t elem_size)
+{
+  int64_t prev, delta = 0;
+  size_t j;
+
+  prev = unzigzag(get_bits(b, 8*elem_size));
+  store_bits(array, 0, elem_size, (uint64_t) prev);
+
+  for(j=1; j<ARRAY_LENGTH; ++j)
+  {
+    int n;
+    if(!get_bits(b, 1))
+      n = 0;
+    else if(!get_bits(b, 1))
+      n = 7;
+    else if(!get_bits(b, 1))
+      n = 12;
+    else if(!get_bits(b, 1))
+      n = 20;
+    else
+      n = 40;
+    if(n)
+      delta += unzigzag(get_bits(b, n));
+    prev += delta;
+    store_bits(array, j, elem_size, (uint64_t) prev);
+  }
+}
+
+/* The first value and then the XOR of each value with the one
+ * before it.  Slowly changing floating point values have the same
+ * sign, exponent and high mantissa bits so the XOR has long runs
+ * of leading zeros, and round numbers have trailing zeros:
+ *
+ *    0                          same value
+ *    10  + bits                 the bits that differ fit in the
+ *                               last window of bits
+ *    11  + 6 leading zeros + 6 length-1 + length bits
+ */
+static
+int xor_pack(struct qp_bits *b, const void *array, size_t elem_size)
+{
+  uint64_t prev;
+  int width, lead = -1, trail = 0;
+  size_t j;
+
+  width = 8*elem_size;
+  prev = load_bits(array, 0, elem_size);
+  if(!put_bits(b, prev, width))
+    return 0;
+
+  for(j=1; j<ARRAY_LENGTH; ++j)
+  {
+    uint64_t x, v;
+    int l, t;
+    v = load_bits(array, j, elem_size);
+    x = v ^ prev;
+    prev = v;
+
+    if(!x)
+    {
+      if(!put_bits(b, 0, 1))
+        return 0;
+      continue;
+    }
+
+    l = __builtin_clzll(x) - (64 - width);
+    t = __builtin_ctzll(x);
+    if(lead >= 0 && l >= lead && t >= trail)
+    {
+      if(!put_bits(b, 2, 2) ||
+          !put_bits(b, x >> trail, width - lead - trail))
+        return 0;
+      continue;
+    }
+
+    lead = l;
+    trail = t;
+    if(!put_bits(b, 3, 2) || !put_bits(b, lead, 6) ||
+        !put_bits(b, width - lead - trail - 1, 6) ||
+        !put_bits(b, x >> trail, width - lead - trail))
+      return 0;
+  }
+  return 1;
+}
+
+static
+void xor_unpack(struct qp_bits *b, void *array, size_t elem_size)
+{
+  uint64_t prev;
+  int width, lead = 0, trail = 0;
+  size_t j;
+
+  width = 8*elem_size;
+  prev = get_bits(b, width);
+  store_bits(array, 0, elem_size, prev);
+
+  for(j=1; j<ARRAY_LENGTH; ++j)
+  {
+    if(get_bits(b, 1))
+    {
+      if(get_bits(b, 1))
+      {
+        lead = get_bits(b, 6);
+        trail = width - lead - (int) get_bits(b, 6) - 1;
+      }
+      prev ^= get_bits(b, width - lead - trail) << trail;
+    }
+    store_bits(array, j, elem_size, prev);
+  }
+}
+
+/* returns 1 if codec made a smaller array in b */
+static
+int pack_with(int codec, struct qp_bits *b, const void *array,
+    size_t elem_size)
+{
+  memset(b->buf, 0, b->size);
+  b->pos = 0;
+
+  switch(codec)
+  {
+    case QP_PACK_RLE:
+      return rle_pack(b, array, elem_size);
+    case QP_PACK_DELTA:
+      return delta_pack(b, array, elem_size);
+    case QP_PACK_XOR:
+      return xor_pack(b, array, elem_size);
+    default:
+      VASSERT(0, "bad codec=%d\n", codec);
+      break;
+  }
+  return 0;
+}
+
+/* returns the compressed array or NULL if no codec makes it
+ * smaller */
+static
+struct qp_channel_packed *pack(const void *array, int value_type)
+{
+  struct qp_channel_packed *p = NULL;
+  struct qp_bits b;
+  size_t elem_size;
+  int codec[2], i;
+
+  elem_size = qp_channel_series_value_size(value_type);
+  codec[0] = QP_PACK_RLE;
+  if(value_type == QP_TYPE_SHORT || value_type == QP_TYPE_INT)
+    codec[1] = QP_PACK_DELTA;
+  else
+    codec[1] = QP_PACK_XOR;
+
+  /* It must be smaller than the array as it is. */
+  b.size = elem_size*ARRAY_LENGTH - 1;
+  b.buf = (unsigned char *) qp_malloc(b.size);
+
+  for(i=0; i<2; ++i)
+  {
+    size_t size;
+    if(!pack_with(codec[i], &b, array, elem_size))
+      continue;
+    size = (b.pos + 7) >> 3;
+    if(p && size >= p->size)
+      continue;
+    p = (struct qp_channel_packed *) qp_realloc(p, sizeof(*p) + size);
+    p->codec = codec[i];
+    p->elem_size = elem_size;
+    p->size = size;
+    memcpy(qp_channel_packed_data(p), b.buf, size);
+  }
+
+  free(b.buf);
+  return p;
+}
+
+static
+void unpack(struct qp_channel_packed *p, void *array)
+{
+  struct qp_bits b;
+  b.buf = qp_channel_packed_data(p);
+  b.size = p->size;
+  b.pos = 0;
+
+  switch(p->codec)
+  {
+    case QP_PACK_RLE:
+      rle_unpack(&b, array, p->elem_size);
+      break;
+    case QP_PACK_DELTA:
+      delta_unpack(&b, array, p->elem_size);
+      break;
+    case QP_PACK_XOR:
+      xor_unpack(&b, array, p->elem_size);
+      break;
+    default:
+      VASSERT(0, "bad codec=%d\n", p->codec);
+      break;
+  }
+}
+
+void *qp_channel_series_unpack(struct qp_channel_series *cs,
+    size_t k, int slot)
+{
+  struct qp_channel_arrays *a;
+  ASSERT(cs);
+  ASSERT(slot >= 0 && slot < QP_NUM_CACHES);
+  a = cs->arrays;
+  ASSERT(a->lazy || (a->packed && a->packed[k]));
+
+  if(cs->cache_array[slot] == k)
+    return cs->cache[slot];
+
+  if(!cs->cache[slot])
+    /* big enough for any value type */
+    cs->cache[slot] = qp_malloc(ARRAY_LENGTH*sizeof(double));
+  if(a->lazy)
+    a->lazy->read(a->lazy, a->lazy_column, k, (double *) cs->cache[slot]);
+  else
+    unpack(a->packed[k], cs->cache[slot]);
+  cs->cache_array[slot] = k;
+  return cs->cache[slot];
+}
+
+void qp_channel_series_pack_array(struct qp_channel_series *cs,
+    size_t k, int value_type)
+{
+  struct qp_channel_arrays *a;
+  struct qp_channel_packed *p;
+  void *array;
+  ASSERT(cs);
+  a = cs->arrays;
+  ASSERT(a->pack);
+  ASSERT(a->ref_count == 1);
+  ASSERT(k < a->num_arrays);
+  ASSERT(a->length >= (k + 1) << ARRAY_SHIFT);
+
+  array = a->arrays[k];
+  if(!array)
+    /* it is packed already */
+    return;
+  if(array == qp_channel_series_nan_array(value_type))
+    /* it is shared and uses no memory */
+    return;
+
+  p = pack(array, value_type);
+  if(!p)
+    return;
+
+  if(a->arena)
+  {
+    /* so that it is in the memory budget of the arena */
+    struct qp_channel_packed *q;
+    q = (struct qp_channel_packed *)
+      qp_arena_alloc(a->arena, sizeof(*p) + p->size);
+    memcpy(q, p, sizeof(*p) + p->size);
+    free(p);
+    p = q;
+  }
+
+  ASSERT(a->packed);
+  a->packed[k] = p;
+  a->arrays[k] = NULL;
+  qp_channel_series_free_array(a, array,
+      qp_channel_series_value_size(value_type));
+
+  if(cs->current_array == array)
+    /* the writer was reading it */
+    cs->current_array = qp_channel_series_unpack(cs, k, QP_CACHE_CURSOR);
+}
+
+void qp_channel_series_free_packed(struct qp_channel_arrays *a, size_t k)
+{
+  ASSERT(a);
+  ASSERT(a->packed && a->packed[k]);
+  if(!a->arena)
+    free(a->packed[k]);
+  /* else it is released with the arena.  The arena only keeps free
+   * lists for a few sizes, and these sizes are all different. */
+  a->packed[k] = NULL;
+}
+
+void qp_channel_series_pack(qp_channel_t c)
+{
+  struct qp_channel_arrays *a;
+  size_t k;
+  ASSERT(c);
+
+  if(c->form != QP_CHANNEL_FORM_SERIES)
+    return;
+
+  a = c->series.arrays;
+  ASSERT(a->ref_count == 1);
+
+  if(!a->pack && a->alloc_arrays)
+  {
+    a->packed = (struct qp_channel_packed **)
+      qp_malloc(sizeof(*a->packed)*a->alloc_arrays);
+    memset(a->packed, 0, sizeof(*a->packed)*a->alloc_arrays);
+  }
+  a->pack = 1;
+
+  /* The last array is packed when the array after it is added. */
+  for(k=0; k + 1 < a->num_arrays; ++k)
+    qp_channel_series_pack_array(&c->series, k, c->value_type);
+}
+
+size_t qp_channel_series_bytes(qp_channel_t c)
+{
+  struct qp_channel_arrays *a;
+  size_t k, bytes = 0;
+  ASSERT(c);
+
+  if(c->form != QP_CHANNEL_FORM_SERIES)
+    return 0;
+
+  a = c->series.arrays;
+  for(k=0; k<a->num_arrays; ++k)
+    if(a->arrays[k] == qp_channel_series_nan_array(c->value_type))
+      continue;
+    else if(a->arrays[k])
+      bytes += qp_channel_series_value_size(c->value_type)*ARRAY_LENGTH;
+    else if(!a->lazy)
+      bytes += sizeof(struct qp_channel_packed) + a->packed[k]->size;
+  return bytes;
+}
@@ -0,0 +1,86 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Compressed arrays for series channels.  When a channel is set
+ * to pack, each array is compressed when it is full, with the
+ * codec that makes it smallest:
+ *
+ *   QP_PACK_RLE    runs of the same value, for any value type
+ *   QP_PACK_DELTA  the change in the change from one value to the
+ *                  next, for short and int, which is mostly zero
+ *                  for time stamps and other evenly spaced values
+ *   QP_PACK_XOR    the bits that differ from the last value, for
+ *                  float and double values that change slowly
+ *
+ * An array is left as it is if no codec makes it smaller.  The
+ * readers uncompress an array into a cache in the channel when
+ * they get to it, see qp_channel_series_array(), so the plots
+ * do not care. */
+
+#ifndef END_DOUBLE
+#error "You must include channel_double.h before this file."
+#endif
+
+
+#define QP_PACK_RLE    (1)
+#define QP_PACK_DELTA  (2)
+#define QP_PACK_XOR    (3)
+
+
+/* A compressed array of ARRAY_LENGTH values.  The compressed
+ * data follows this struct in the same malloc() memory. */
+struct qp_channel_packed
+{
+  int codec;        /* QP_PACK_* */
+  size_t elem_size; /* size of the values uncompressed */
+  size_t size;      /* number of bytes of compressed data */
+};
+
+
+static inline
+unsigned char *qp_channel_packed_data(struct qp_channel_packed *p)
+{
+  return (unsigned char *) (p + 1);
+}
+
+/* Compresses array k of the channel series cs, if a codec makes
+ * it smaller, where the values are value_type.  The array must
+ * be full. */
+extern
+void qp_channel_series_pack_array(struct qp_channel_series *cs,
+    size_t k, int value_type);
+
+/* Frees compressed array k and sets a->packed[k] to NULL */
+extern
+void qp_channel_series_free_packed(struct qp_channel_arrays *a, size_t k);
+
+/* Compresses all the full arrays of the channel and sets the
+ * channel to compress the arrays that fill after this. */
+extern
+void qp_channel_series_pack(qp_channel_t c);
+
+/* returns the number of bytes that the values of the series
+ * channel use, compressed or not. */
+extern
+size_t qp_channel_series_bytes(qp_channel_t c);
+
@@ -0,0 +1,283 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sys/types.h>
+#include <stdlib.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "list.h"
+#include "channel.h"
+#include "spew.h"
+#include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pyramid.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+void qp_channel_pyramid_destroy(struct qp_channel_pyramid *py)
+{
+  int l;
+  ASSERT(py);
+
+  for(l=py->first_level; l<py->num_levels; ++l)
+  {
+    free(py->min[l]);
+    free(py->max[l]);
+  }
+  free(py->min);
+  free(py->max);
+  free(py->num_buckets);
+  free(py->alloc_buckets);
+  free(py);
+}
+
+/* Level 0 buckets from bucket b on are made from the values.  We
+ * read with a copy of the channel so we do not move the reading
+ * cursor of c.  The arrays with no good values, like the NANs at
+ * the top of a channel that starts lower in the file, are not
+ * read. */
+static
+void level0_from_values(struct qp_channel_pyramid *py, qp_channel_t c,
+    size_t b)
+{
+  struct qp_channel_arrays *a;
+  struct qp_channel *r;
+  size_t at = (size_t) -1; /* at is the index of val */
+  double val = 0;
+
+  a = c->series.arrays;
+  r = qp_channel_series_create(c, 0);
+  for(; b<py->num_buckets[0]; ++b)
+  {
+    double min = INFINITY, max = -INFINITY;
+    size_t i, k;
+    i = b << QP_PYRAMID_SHIFT;
+    k = i >> ARRAY_SHIFT;
+    /* function channels have no arrays */
+    if(c->form != QP_CHANNEL_FORM_SERIES ||
+        a->chunks[k].min <= a->chunks[k].max)
+    {
+      if(at != i)
+      {
+        val = qp_channel_series_index(r, i);
+        at = i;
+      }
+      for(; at<i+QP_PYRAMID_LENGTH && qp_channel_series_is_reading(r);
+          ++at)
+      {
+        if(is_good_double(val))
+        {
+          if(val < min)
+            min = val;
+          if(val > max)
+            max = val;
+        }
+        val = qp_channel_series_next(r);
+      }
+    }
+    py->min[0][b] = min;
+    py->max[0][b] = max;
+  }
+  qp_channel_destroy(r);
+}
+
+/* The buckets of QP_PYRAMID_ARRAY_LEVEL are the arrays, so that
+ * level is made from the summaries of the arrays, from array b
+ * on. */
+static
+void first_level_from_arrays(struct qp_channel_pyramid *py,
+    qp_channel_t c, size_t b)
+{
+  struct qp_channel_arrays *a;
+  a = c->series.arrays;
+  ASSERT(py->first_level == QP_PYRAMID_ARRAY_LEVEL);
+  ASSERT(py->num_buckets[py->first_level] == a->num_arrays);
+
+  for(; b<a->num_arrays; ++b)
+  {
+    py->min[py->first_level][b] = a->chunks[b].min;
+    py->max[py->first_level][b] = a->chunks[b].max;
+  }
+}
+
+/* Sets the number of levels and buckets of the pyramid for len
+ * values, keeping the buckets that are made.  The buckets grow by
+ * doubling so a channel that is appended to, like from a pipe,
+ * does not copy them every time. */
+static
+void pyramid_resize(struct qp_channel_pyramid *py, size_t len)
+{
+  size_t n;
+  int l, num_levels;
+
+  /* count the levels.  The top level has one bucket. */
+  num_levels = 1;
+  for(n = (len + QP_PYRAMID_LENGTH - 1) >> QP_PYRAMID_SHIFT; n > 1;
+      n = (n + QP_PYRAMID_FACTOR - 1) >> QP_PYRAMID_LEVEL_SHIFT)
+    ++num_levels;
+  if(num_levels <= py->first_level)
+    num_levels = py->first_level + 1;
+
+  if(num_levels > py->num_levels)
+  {
+    py->num_buckets = (size_t *) qp_realloc(py->num_buckets,
+        sizeof(size_t)*num_levels);
+    py->alloc_buckets = (size_t *) qp_realloc(py->alloc_buckets,
+        sizeof(size_t)*num_levels);
+    py->min = (double **) qp_realloc(py->min, sizeof(double *)*num_levels);
+    py->max = (double **) qp_realloc(py->max, sizeof(double *)*num_levels);
+    for(l=py->num_levels; l<num_levels; ++l)
+    {
+      py->num_buckets[l] = py->alloc_buckets[l] = 0;
+      py->min[l] = py->max[l] = NULL;
+    }
+    py->num_levels = num_levels;
+  }
+
+  n = (len + QP_PYRAMID_LENGTH - 1) >> QP_PYRAMID_SHIFT;
+  for(l=0; l<py->num_levels; ++l)
+  {
+    if(l >= py->first_level)
+    {
+      if(n > py->alloc_buckets[l])
+      {
+        if(py->alloc_buckets[l] && n < 2*py->alloc_buckets[l])
+          py->alloc_buckets[l] *= 2;
+        else
+          py->alloc_buckets[l] = n;
+        py->min[l] = (double *) qp_realloc(py->min[l],
+            sizeof(double)*py->alloc_buckets[l]);
+        py->max[l] = (double *) qp_realloc(py->max[l],
+            sizeof(double)*py->alloc_buckets[l]);
+      }
+      py->num_buckets[l] = n;
+    }
+    n = (n + QP_PYRAMID_FACTOR - 1) >> QP_PYRAMID_LEVEL_SHIFT;
+  }
+}
+
+/* Makes the pyramid have the channel length len, which is not less
+ * than py->length.  Only the buckets with the values after
+ * py->length, and the last bucket before them, are made, so a
+ * channel that is appended to does not read all its values again
+ * every time it is drawn. */
+static
+void pyramid_update(struct qp_channel_pyramid *py, qp_channel_t c,
+    size_t len)
+{
+  size_t b, start;
+  int l;
+
+  ASSERT(len >= py->length);
+
+  /* the first bucket with values that are new, at the first level */
+  start = py->length/qp_channel_pyramid_bucket_length(py->first_level);
+
+  pyramid_resize(py, len);
+
+  if(py->first_level)
+    first_level_from_arrays(py, c, start);
+  else
+    level0_from_values(py, c, start);
+
+  /* and the other levels are made from the level below */
+  for(l=py->first_level+1; l<py->num_levels; ++l)
+  {
+    start >>= QP_PYRAMID_LEVEL_SHIFT;
+    for(b=start; b<py->num_buckets[l]; ++b)
+    {
+      double min = INFINITY, max = -INFINITY;
+      size_t i, end;
+      i = b << QP_PYRAMID_LEVEL_SHIFT;
+      end = i + QP_PYRAMID_FACTOR;
+      if(end > py->num_buckets[l-1])
+        end = py->num_buckets[l-1];
+      for(; i<end; ++i)
+      {
+        if(py->min[l-1][i] < min)
+          min = py->min[l-1][i];
+        if(py->max[l-1][i] > max)
+          max = py->max[l-1][i];
+      }
+      py->min[l][b] = min;
+      py->max[l][b] = max;
+    }
+  }
+
+  DEBUG("%s %d level pyramid for channel with %zu values\n",
+      (py->length)?"extended":"made", py->num_levels, len);
+
+  py->length = len;
+}
+
+static
+struct qp_channel_pyramid *pyramid_create(qp_channel_t c)
+{
+  struct qp_channel_pyramid *py;
+
+  py = (struct qp_channel_pyramid *) qp_malloc(sizeof(*py));
+  memset(py, 0, sizeof(*py));
+  /* Reading all the values of a lazy channel is reading the whole
+   * file again, so we start with the summaries of the arrays. */
+  py->first_level = (c->series.arrays->lazy)?QP_PYRAMID_ARRAY_LEVEL:0;
+  return py;
+}
+
+struct qp_channel_pyramid *qp_channel_pyramid_get(qp_channel_t c)
+{
+  struct qp_channel_arrays *a;
+  size_t len;
+
+  ASSERT(c);
+  ASSERT(qp_channel_is_indexed(c));
+  a = c->series.arrays;
+  ASSERT(a);
+
+  len = a->length;
+  if(len <= QP_PYRAMID_LENGTH)
+    /* It would not save us any reading. */
+    return NULL;
+
+  if(a->pyramid && a->pyramid->length > len)
+  {
+    /* a function channel was made shorter */
+    qp_channel_pyramid_destroy(a->pyramid);
+    a->pyramid = NULL;
+  }
+
+  if(!a->pyramid)
+    a->pyramid = pyramid_create(c);
+
+  if(a->pyramid->length != len)
+    /* it is new, or values were appended after it was made */
+    pyramid_update(a->pyramid, c, len);
+
+  return a->pyramid;
+}
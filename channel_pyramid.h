@@ -0,0 +1,93 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A summary pyramid of a channel.  Level 0 has the min and max
+ * of each bucket of QP_PYRAMID_LENGTH values and each level up
+ * has buckets that are QP_PYRAMID_FACTOR times longer, so we can
+ * get the range of the values over many values without reading
+ * them.  Drawing a plot with many more values than pixel
+ * columns reads a few buckets per pixel column in place of all
+ * the values.  The pyramid is shared by all the copies of the
+ * channel like the arrays of the values. */
+
+#ifndef END_DOUBLE
+#error "You must include channel_double.h before this file."
+#endif
+
+
+/* QP_PYRAMID_LENGTH = 1 << QP_PYRAMID_SHIFT */
+#define QP_PYRAMID_SHIFT        (6)
+#define QP_PYRAMID_LENGTH       (1 << QP_PYRAMID_SHIFT)
+/* QP_PYRAMID_FACTOR = 1 << QP_PYRAMID_LEVEL_SHIFT */
+#define QP_PYRAMID_LEVEL_SHIFT  (2)
+#define QP_PYRAMID_FACTOR       (1 << QP_PYRAMID_LEVEL_SHIFT)
+
+/* the level with buckets of ARRAY_LENGTH values, one array each */
+#define QP_PYRAMID_ARRAY_LEVEL  \
+  ((ARRAY_SHIFT - QP_PYRAMID_SHIFT)/QP_PYRAMID_LEVEL_SHIFT)
+
+#if (ARRAY_SHIFT - QP_PYRAMID_SHIFT) % QP_PYRAMID_LEVEL_SHIFT
+#error "ARRAY_LENGTH must be the bucket length of a pyramid level"
+#endif
+
+
+struct qp_channel_pyramid
+{
+  /* the channel length when the pyramid was made */
+  size_t length;
+
+  int num_levels;
+  size_t *num_buckets; /* number of buckets in each level */
+  size_t *alloc_buckets; /* number of buckets allocated */
+
+  /* The levels below this are not made, they have no buckets.
+   * This is 0 but for lazy channels, that make the pyramid from
+   * the summaries of the arrays, see QP_PYRAMID_ARRAY_LEVEL. */
+  int first_level;
+
+  /* min[level][bucket] and max[level][bucket] of the values
+   * that are not NAN or INF.  If a bucket has no such values
+   * min is INFINITY and max is -INFINITY. */
+  double **min, **max;
+};
+
+
+/* returns the number of values in a bucket at level */
+static inline
+size_t qp_channel_pyramid_bucket_length(int level)
+{
+  return ((size_t) 1) << (QP_PYRAMID_SHIFT + level*QP_PYRAMID_LEVEL_SHIFT);
+}
+
+/* returns the pyramid of the channel, making it if it is not made
+ * yet, or NULL if the channel is too short to need one.  This
+ * reads all the values the first time it is called, and after
+ * values are appended it reads just the new ones.  For lazy channels
+ * it reads none of the values and makes the levels from
+ * QP_PYRAMID_ARRAY_LEVEL up. */
+extern
+struct qp_channel_pyramid *qp_channel_pyramid_get(qp_channel_t c);
+
+extern
+void qp_channel_pyramid_destroy(struct qp_channel_pyramid *py);
+
@@ -0,0 +1,216 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* This file is a template that makes the series channel
+ * readers for one value type.  It is included once for
+ * each value type that we store in series channels, so there
+ * is no include guard.  Before including it define:
+ *
+ *   QP_SERIES_TYPE           the C type stored in the arrays
+ *   QP_SERIES_VALUE_TYPE     the QP_TYPE_* of that C type
+ *   QP_SERIES_FUNC(name)     makes the function names, like
+ *                            qp_channel_series_double_##name
+ *   QP_SERIES_TO_DOUBLE(cs,x) the double value that the stored
+ *                            value x stands for
+ *
+ * All the readers return doubles no matter what type the
+ * values are stored as, so the plots do not care.
+ *
+ * The macros are undefined at the end of this file. */
+
+
+#ifndef _QP_DEBUG_H_
+#error "You must include qp_debug.h before this file."
+#endif
+
+#ifndef QP_SERIES_TYPE
+#error "You must define QP_SERIES_TYPE before including this file."
+#endif
+
+
+extern
+void QP_SERIES_FUNC(append)(qp_channel_t channel, double val);
+
+/* Appends n values.  This is faster than calling append() n
+ * times, see qp_channel_chunk_summary(). */
+extern
+void QP_SERIES_FUNC(append_n)(qp_channel_t channel, const double *vals,
+    size_t n);
+
+extern
+double QP_SERIES_FUNC(begin)(qp_channel_t channel);
+
+extern
+double QP_SERIES_FUNC(end)(qp_channel_t channel);
+
+
+/* Find the value that is less than and next to or as close as possible
+ * For series that is increasing
+ * *v in is the value to search on
+ * *v out is the value found from the channel
+ * sets the current read to that value in the channel
+ * returns the index to the value in the channel
+ * returns 0 if a value was not found and the value
+ * is set to the first value
+ * */
+extern
+size_t QP_SERIES_FUNC(find_lt)(qp_channel_t channel, double *v);
+
+
+/* Find the value that is greater than and next to or as close as possible
+ * For series that is increasing
+ * *v in is the value to search on
+ * *v out is the value found from the channel
+ * sets the current read to that value in the channel
+ * returns the index to the value in the channel
+ * returns length - 1 if the value was not found
+ * and the value is set to the last value
+ * */
+extern
+size_t QP_SERIES_FUNC(find_gt)(qp_channel_t channel, double *v);
+
+
+
+/* For a series that is increasing, not counting NAN like values.
+ * Returns the index of the first value that is greater than val,
+ * or greater than or equal to val if or_equal is set, or the
+ * length if there is none.  NAN like values are skipped.  The
+ * summaries of the arrays are searched first and then the values
+ * in one array, both with qp_channel_gallop() from an interpolated
+ * guess, so this is O(log n) plus reading past runs of NAN values.
+ * This does not move the reading cursor. */
+extern
+size_t QP_SERIES_FUNC(search)(qp_channel_t channel, double val,
+    int or_equal);
+
+
+/* Check that i is in bounds before this call */
+/* This is fast, the arrays are in a table so we do not
+ * iterate to get to the i-th value.  You can use it to
+ * start an iteration at a point not necessarily at the
+ * first or last value and then iterate with the _next()
+ * and _prev() readers.
+ *
+ *  Returns the i-th value where i = [ 0, length-1 ] and
+ *  sets the current value to that value */
+static inline
+double QP_SERIES_FUNC(index)(qp_channel_t c, size_t i)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(i < qp_channel_series_length(c));
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  cs = &c->series;
+  cs->current_index = i;
+  cs->current_array = qp_channel_series_array(cs, i >> ARRAY_SHIFT,
+      QP_CACHE_CURSOR);
+
+  return QP_SERIES_TO_DOUBLE(cs,
+      ((QP_SERIES_TYPE *) cs->current_array)[i & ARRAY_MASK]);
+}
+
+/* This returns the current index or (size_t) -1 if their is none. */
+static inline
+size_t QP_SERIES_FUNC(get_index)(qp_channel_t c)
+{
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(qp_channel_series_is_reading(c));
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  if(!qp_channel_series_is_reading(c))
+    return (size_t) -1;
+
+  return c->series.current_index;
+}
+
+static inline
+double QP_SERIES_FUNC(next)(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  cs = &c->series;
+
+  /* there are no values left or there are no values */
+  if(!cs->current_array) return END_DOUBLE;
+
+  if(++(cs->current_index) >= cs->arrays->length)
+  {
+    /* push it past the end */
+    cs->current_array = NULL;
+    return END_DOUBLE;
+  }
+
+  if(!(cs->current_index & ARRAY_MASK))
+    /* go to the next array */
+    cs->current_array = qp_channel_series_array(cs,
+        cs->current_index >> ARRAY_SHIFT, QP_CACHE_CURSOR);
+
+  return QP_SERIES_TO_DOUBLE(cs, ((QP_SERIES_TYPE *)
+        cs->current_array)[cs->current_index & ARRAY_MASK]);
+}
+
+static inline
+double QP_SERIES_FUNC(prev)(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  cs = &c->series;
+
+  if(!cs->current_array) return END_DOUBLE;
+
+  if(cs->current_index == 0)
+  {
+    /* push it past the begining */
+    cs->current_array = NULL;
+    return END_DOUBLE;
+  }
+
+  --(cs->current_index);
+
+  if((cs->current_index & ARRAY_MASK) == ARRAY_MASK)
+    /* go to the previous array */
+    cs->current_array = qp_channel_series_array(cs,
+        cs->current_index >> ARRAY_SHIFT, QP_CACHE_CURSOR);
+
+  return QP_SERIES_TO_DOUBLE(cs, ((QP_SERIES_TYPE *)
+        cs->current_array)[cs->current_index & ARRAY_MASK]);
+}
+
+
+#undef QP_SERIES_TYPE
+#undef QP_SERIES_VALUE_TYPE
+#undef QP_SERIES_FUNC
+#undef QP_SERIES_TO_DOUBLE
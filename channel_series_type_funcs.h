@@ -0,0 +1,418 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* This file is a template that makes the series channel
+ * functions that are not inline for one value type.  It is
+ * included in a .c file once for each value type after the
+ * readers from channel_series_type.h are declared.  Before
+ * including it define the same macros as for
+ * channel_series_type.h and also:
+ *
+ *   QP_SERIES_FROM_DOUBLE(cs,val) the value that is stored
+ *                                 for the double val
+ *
+ * The macros are undefined at the end of this file. */
+
+#ifndef QP_SERIES_FROM_DOUBLE
+#error "You must define QP_SERIES_FROM_DOUBLE before including this file."
+#endif
+
+
+/* An array with no good values is past val if the next array
+ * with good values is, so past() keeps going 0 then 1. */
+static
+int QP_SERIES_FUNC(array_is_past)(void *data, size_t k)
+{
+  struct qp_channel_search *d;
+  struct qp_channel_arrays *a;
+  d = (struct qp_channel_search *) data;
+  a = d->c->series.arrays;
+
+  for(; k < a->num_arrays; ++k)
+    if(a->chunks[k].min <= a->chunks[k].max)
+      return qp_channel_search_is_past(a->chunks[k].max,
+          d->val, d->or_equal);
+  return 1;
+}
+
+/* Like above, a NAN like value is past val if the next good
+ * value is. */
+static
+int QP_SERIES_FUNC(value_is_past)(void *data, size_t j)
+{
+  struct qp_channel_search *d;
+  struct qp_channel_series *cs;
+  QP_SERIES_TYPE *array;
+  d = (struct qp_channel_search *) data;
+  cs = &d->c->series;
+  array = (QP_SERIES_TYPE *)
+    qp_channel_series_array(cs, d->array, QP_CACHE_PEEK);
+
+  for(; j < d->n; ++j)
+  {
+    double x;
+    x = QP_SERIES_TO_DOUBLE(cs, array[j]);
+    if(is_good_double(x))
+      return qp_channel_search_is_past(x, d->val, d->or_equal);
+  }
+  return 1;
+}
+
+/* returns the index of the last good value before index i or
+ * (size_t) -1 if there is none */
+static
+size_t QP_SERIES_FUNC(prev_good)(qp_channel_t c, size_t i)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  cs = &c->series;
+  a = cs->arrays;
+
+  while(i)
+  {
+    size_t k;
+    --i;
+    k = i >> ARRAY_SHIFT;
+    if(a->chunks[k].min > a->chunks[k].max)
+    {
+      /* there are no good values in this array */
+      i = k << ARRAY_SHIFT;
+      continue;
+    }
+    if(is_good_double(QP_SERIES_TO_DOUBLE(cs, ((QP_SERIES_TYPE *)
+            qp_channel_series_array(cs, k, QP_CACHE_PEEK))[i & ARRAY_MASK])))
+      return i;
+  }
+  return (size_t) -1;
+}
+
+/* returns (val - min)/(max - min) in [0, 1] or 0 if we
+ * can't say */
+static inline
+double QP_SERIES_FUNC(fraction)(double val, double min, double max)
+{
+  double f;
+  if(!(max > min))
+    return 0;
+  f = (val - min)/(max - min);
+  if(!(f > 0))
+    return 0;
+  if(f > 1)
+    return 1;
+  return f;
+}
+
+size_t QP_SERIES_FUNC(search)(qp_channel_t c, double val, int or_equal)
+{
+  struct qp_channel_search d;
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  struct qp_channel_chunk *k;
+  QP_SERIES_TYPE *array;
+  size_t len, j;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.is_increasing);
+
+  cs = &c->series;
+  a = cs->arrays;
+  len = a->length;
+  if(!len)
+    return 0;
+
+  d.c = c;
+  d.val = val;
+  d.or_equal = or_equal;
+
+  /* guess that the values increase linearly with the index */
+  j = (size_t) (QP_SERIES_FUNC(fraction)(val, cs->min, cs->max)*(len - 1));
+  d.array = qp_channel_gallop(a->num_arrays, j >> ARRAY_SHIFT,
+      QP_SERIES_FUNC(array_is_past), &d);
+
+  /* skip arrays with no good values */
+  while(d.array < a->num_arrays &&
+      a->chunks[d.array].min > a->chunks[d.array].max)
+    ++d.array;
+  if(d.array == a->num_arrays)
+    return len;
+
+  d.n = len - (d.array << ARRAY_SHIFT);
+  if(d.n > ARRAY_LENGTH)
+    d.n = ARRAY_LENGTH;
+
+  /* the value is in this array, guess again */
+  k = &a->chunks[d.array];
+  j = (size_t) (QP_SERIES_FUNC(fraction)(val, k->min, k->max)*(d.n - 1));
+  j = qp_channel_gallop(d.n, j, QP_SERIES_FUNC(value_is_past), &d);
+  ASSERT(j < d.n);
+
+  /* we may be at NAN values before the good value */
+  array = (QP_SERIES_TYPE *)
+    qp_channel_series_array(cs, d.array, QP_CACHE_PEEK);
+  while(!is_good_double(QP_SERIES_TO_DOUBLE(cs, array[j])))
+    ++j;
+  ASSERT(j < d.n);
+
+  return (d.array << ARRAY_SHIFT) + j;
+}
+
+size_t QP_SERIES_FUNC(find_lt)(qp_channel_t c, double *v)
+{
+  size_t i;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.is_increasing);
+  ASSERT(c->series.min != c->series.max);
+
+  /* the last good value before the first value >= *v */
+  i = QP_SERIES_FUNC(prev_good)(c, QP_SERIES_FUNC(search)(c, *v, 1));
+  if(i == (size_t) -1)
+    /* there is none, so we use the first good value */
+    i = QP_SERIES_FUNC(search)(c, -INFINITY, 0);
+
+  *v = QP_SERIES_FUNC(index)(c, i);
+  return i;
+}
+
+size_t QP_SERIES_FUNC(find_gt)(qp_channel_t c, double *v)
+{
+  size_t i;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.is_increasing);
+  ASSERT(c->series.min != c->series.max);
+
+  i = QP_SERIES_FUNC(search)(c, *v, 0);
+  if(i == qp_channel_series_length(c))
+    /* there is none, so we use the last good value */
+    i = QP_SERIES_FUNC(prev_good)(c, i);
+
+  *v = QP_SERIES_FUNC(index)(c, i);
+  return i;
+}
+
+double QP_SERIES_FUNC(begin)(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  cs = &c->series;
+
+  if(cs->arrays->length)
+  {
+    cs->current_index = 0;
+    cs->current_array = qp_channel_series_array(cs, 0, QP_CACHE_CURSOR);
+    return QP_SERIES_TO_DOUBLE(cs,
+        ((QP_SERIES_TYPE *) cs->current_array)[0]);
+  }
+  ASSERT(cs->arrays->num_arrays == 0);
+  cs->current_array = NULL;
+  return END_DOUBLE;
+}
+
+double QP_SERIES_FUNC(end)(qp_channel_t c)
+{
+  struct qp_channel_series *cs;
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  ASSERT(c->series.arrays->ref_count > 0);
+
+  cs = &c->series;
+
+  if(cs->arrays->length)
+  {
+    cs->current_index = cs->arrays->length - 1;
+    cs->current_array = qp_channel_series_array(cs,
+        cs->current_index >> ARRAY_SHIFT, QP_CACHE_CURSOR);
+    return QP_SERIES_TO_DOUBLE(cs, ((QP_SERIES_TYPE *)
+          cs->current_array)[cs->current_index & ARRAY_MASK]);
+  }
+  ASSERT(cs->arrays->num_arrays == 0);
+  cs->current_array = NULL;
+  return END_DOUBLE;
+}
+
+void QP_SERIES_FUNC(append)(qp_channel_t c, double val)
+{
+  QP_SERIES_TYPE *array, x;
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  size_t i;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  /* We disallow having the channel written to when there
+   * is more than one copy of the channel, unless it is growing. */
+  ASSERT(c->series.arrays->ref_count == 1 ||
+      c->series.arrays->is_growing);
+
+  cs = &c->series;
+  a = cs->arrays;
+  i = a->length;
+
+  /* The min and max are of the values that we can read
+   * back, not the values we were given. */
+  x = QP_SERIES_FROM_DOUBLE(cs, val);
+  val = QP_SERIES_TO_DOUBLE(cs, x);
+
+  if(i)
+  {
+    if(i & ARRAY_MASK)
+      array = (QP_SERIES_TYPE *) a->arrays[i >> ARRAY_SHIFT];
+    else
+    {
+      /* add an array */
+      array = (QP_SERIES_TYPE *)
+        qp_channel_series_add_array(cs, sizeof(QP_SERIES_TYPE));
+      if(a->pack)
+        /* the array before it is full */
+        qp_channel_series_pack_array(cs, (i >> ARRAY_SHIFT) - 1,
+            QP_SERIES_VALUE_TYPE);
+    }
+
+    array[i & ARRAY_MASK] = x;
+    ++(a->length);
+    qp_channel_series_check_min_max(cs, val);
+    qp_channel_chunk_check(&a->chunks[i >> ARRAY_SHIFT], val);
+    return;
+  }
+
+  ASSERT(a->num_arrays == 0);
+
+  /* We must make the first array */
+  array = (QP_SERIES_TYPE *)
+    qp_channel_series_add_array(cs, sizeof(QP_SERIES_TYPE));
+  cs->current_index = 0;
+  cs->current_array = array;
+  cs->max = -INFINITY;
+  cs->min = INFINITY;
+  qp_channel_series_check_min_max(cs, val);
+  cs->is_increasing = 1;
+  cs->is_decreasing = 1;
+  qp_channel_chunk_check(&a->chunks[0], val);
+  /* and add the value */
+  array[0] = x;
+  a->length = 1;
+}
+
+void QP_SERIES_FUNC(append_n)(qp_channel_t c, const double *vals, size_t n)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->value_type == QP_SERIES_VALUE_TYPE);
+  ASSERT(c->series.arrays);
+  ASSERT(c->series.arrays->ref_count == 1 ||
+      c->series.arrays->is_growing);
+  ASSERT(vals || !n);
+
+  cs = &c->series;
+  a = cs->arrays;
+
+  if(!n)
+    return;
+
+  if(!a->length)
+  {
+    ASSERT(a->num_arrays == 0);
+    cs->max = -INFINITY;
+    cs->min = INFINITY;
+    cs->is_increasing = 1;
+    cs->is_decreasing = 1;
+  }
+
+  while(n)
+  {
+    /* the values as they read back, for the min and max */
+    double val[ARRAY_LENGTH];
+    struct qp_channel_chunk k;
+    QP_SERIES_TYPE *array;
+    size_t i, j, m;
+
+    i = a->length;
+    if(i & ARRAY_MASK)
+      array = (QP_SERIES_TYPE *) a->arrays[i >> ARRAY_SHIFT];
+    else
+    {
+      array = (QP_SERIES_TYPE *)
+        qp_channel_series_add_array(cs, sizeof(QP_SERIES_TYPE));
+      if(i && a->pack)
+        qp_channel_series_pack_array(cs, (i >> ARRAY_SHIFT) - 1,
+            QP_SERIES_VALUE_TYPE);
+    }
+
+    if(!i)
+    {
+      cs->current_index = 0;
+      cs->current_array = array;
+    }
+
+    /* fill to the end of this array */
+    m = ARRAY_LENGTH - (i & ARRAY_MASK);
+    if(m > n)
+      m = n;
+    array += (i & ARRAY_MASK);
+
+    for(j=0; j<m; ++j)
+    {
+      array[j] = QP_SERIES_FROM_DOUBLE(cs, vals[j]);
+      val[j] = QP_SERIES_TO_DOUBLE(cs, array[j]);
+    }
+
+    qp_channel_chunk_summary(&k, val, m);
+    qp_channel_chunk_merge(&a->chunks[i >> ARRAY_SHIFT], &k);
+    qp_channel_series_check_chunk(cs, &k);
+
+    a->length += m;
+    vals += m;
+    n -= m;
+
+    if(!(a->length & ARRAY_MASK) &&
+        a->chunks[(a->length - 1) >> ARRAY_SHIFT].num_nan == ARRAY_LENGTH)
+      /* a full array of NAN, like at the bottom of a column that
+       * has no more values */
+      qp_channel_series_share_nan(cs, (a->length - 1) >> ARRAY_SHIFT,
+          QP_SERIES_VALUE_TYPE);
+  }
+}
+
+
+#undef QP_SERIES_TYPE
+#undef QP_SERIES_VALUE_TYPE
+#undef QP_SERIES_FUNC
+#undef QP_SERIES_TO_DOUBLE
+#undef QP_SERIES_FROM_DOUBLE
@@ -0,0 +1,523 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sys/types.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "list.h"
+#include "channel.h"
+#include "spew.h"
+#include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pack.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+#define QP_SERIES_TYPE              float
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_FLOAT
+#define QP_SERIES_FUNC(name)        qp_channel_series_float_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   ((double) (x))
+#define QP_SERIES_FROM_DOUBLE(cs,x) ((float) (x))
+#include "channel_series_type_funcs.h"
+
+#define QP_SERIES_TYPE              int
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_INT
+#define QP_SERIES_FUNC(name)        qp_channel_series_int_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   qp_series_int_to_double(cs, x)
+#define QP_SERIES_FROM_DOUBLE(cs,x) qp_series_double_to_int(cs, x)
+#include "channel_series_type_funcs.h"
+
+#define QP_SERIES_TYPE              short
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_SHORT
+#define QP_SERIES_FUNC(name)        qp_channel_series_short_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   qp_series_short_to_double(cs, x)
+#define QP_SERIES_FROM_DOUBLE(cs,x) qp_series_double_to_short(cs, x)
+#include "channel_series_type_funcs.h"
+
+
+/* float has a 24 bit mantissa so all integers with an absolute
+ * value up to this are exact in a float */
+#define FLOAT_EXACT_INT  (16777216.0)
+
+
+/* returns 1 if val can be stored as rint(val*scale) with an
+ * absolute value less than max and be read back without loss. */
+static inline
+int fits_integer(double val, double scale, double max)
+{
+  double x;
+
+  if(isnan(val))
+    return 1; /* we have a NAN marker */
+
+  x = val*scale;
+  /* this also fails for +/-INFINITY, and -max - 1 is the NAN
+   * marker */
+  if(!(x <= max && x >= -max))
+    return 0;
+
+  return (rint(x)/scale == val)?1:0;
+}
+
+static inline
+int fits(int value_type, double scale, double val)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_SHORT:
+      return fits_integer(val, scale, SHRT_MAX);
+    case QP_TYPE_INT:
+      return fits_integer(val, scale, INT_MAX);
+    case QP_TYPE_FLOAT:
+      return (isnan(val) || (double) ((float) val) == val)?1:0;
+    default:
+      break;
+  }
+  return 1;
+}
+
+static inline
+double get_value(const struct qp_channel_series *cs, int value_type,
+    void *array, size_t i)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_SHORT:
+      return qp_series_short_to_double(cs, ((short *) array)[i]);
+    case QP_TYPE_INT:
+      return qp_series_int_to_double(cs, ((int *) array)[i]);
+    case QP_TYPE_FLOAT:
+      return ((float *) array)[i];
+    case QP_TYPE_DOUBLE:
+      return ((double *) array)[i];
+    default:
+      ASSERT(0);
+      break;
+  }
+  return NAN;
+}
+
+/* returns 1 if all the values in the channel are exact
+ * as floats */
+static
+int all_fit_float(qp_channel_t c, double mag)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  size_t i;
+
+  cs = &c->series;
+  a = cs->arrays;
+
+  if(c->value_type == QP_TYPE_FLOAT ||
+      (cs->scale == 1 && mag <= FLOAT_EXACT_INT))
+    return 1;
+
+  for(i=0; i<a->length; ++i)
+  {
+    if(!(i & ARRAY_MASK) &&
+        !(a->chunks[i >> ARRAY_SHIFT].min <= a->chunks[i >> ARRAY_SHIFT].max))
+    {
+      /* NAN and INF are floats too */
+      i += ARRAY_MASK;
+      continue;
+    }
+    if(!fits(QP_TYPE_FLOAT, 1, get_value(cs, c->value_type,
+            qp_channel_series_array(cs, i >> ARRAY_SHIFT, QP_CACHE_PEEK),
+            i & ARRAY_MASK)))
+      return 0;
+  }
+
+  return 1;
+}
+
+/* Get the smallest value type and scale that will hold val and
+ * all the values that are in the channel already.  We only go
+ * in the order short, int, float, double, and the scale never
+ * gets smaller, so the values we have can be converted without
+ * loss. */
+static
+void pick_type(qp_channel_t c, double val, int *value_type, double *scale)
+{
+  struct qp_channel_series *cs;
+  double mag = 0;
+
+  cs = &c->series;
+
+  /* the largest absolute value in the channel */
+  if(cs->arrays->length && cs->min <= cs->max)
+    mag = (fabs(cs->min) > fabs(cs->max))?fabs(cs->min):fabs(cs->max);
+
+  if(c->value_type == QP_TYPE_SHORT || c->value_type == QP_TYPE_INT)
+  {
+    int type;
+    double max_scale;
+    max_scale = pow(10, QP_MAX_SCALE_DECIMALS);
+
+    for(type = c->value_type; type <= QP_TYPE_INT; ++type)
+    {
+      double s, max;
+      max = (type == QP_TYPE_SHORT)?SHRT_MAX:INT_MAX;
+
+      for(s = cs->scale; s <= max_scale; s *= 10)
+        if(mag*s <= max && fits_integer(val, s, max))
+        {
+          *value_type = type;
+          *scale = s;
+          return;
+        }
+    }
+  }
+
+  if(c->value_type != QP_TYPE_DOUBLE &&
+      fits(QP_TYPE_FLOAT, 1, val) && all_fit_float(c, mag))
+  {
+    *value_type = QP_TYPE_FLOAT;
+    *scale = 1;
+    return;
+  }
+
+  *value_type = QP_TYPE_DOUBLE;
+  *scale = 1;
+}
+
+static inline
+void set_value(const struct qp_channel_series *cs, int value_type,
+    void *array, size_t i, double val)
+{
+  switch(value_type)
+  {
+    case QP_TYPE_SHORT:
+      ((short *) array)[i] = qp_series_double_to_short(cs, val);
+      break;
+    case QP_TYPE_INT:
+      ((int *) array)[i] = qp_series_double_to_int(cs, val);
+      break;
+    case QP_TYPE_FLOAT:
+      ((float *) array)[i] = val;
+      break;
+    case QP_TYPE_DOUBLE:
+      ((double *) array)[i] = val;
+      break;
+    default:
+      ASSERT(0);
+      break;
+  }
+}
+
+/* Rewrite all the values in the channel as value_type with scale
+ * one array at a time, so we never have two copies of all the
+ * values at once.  Compressed arrays are uncompressed, converted
+ * and compressed again. */
+static
+void convert(qp_channel_t c, int value_type, double scale)
+{
+  struct qp_channel_series *cs, to;
+  struct qp_channel_arrays *a;
+  size_t i, len, elem_size;
+
+  cs = &c->series;
+  a = cs->arrays;
+  ASSERT(a->ref_count == 1);
+  len = a->length;
+  elem_size = qp_channel_series_value_size(value_type);
+  to = *cs;
+  to.scale = scale;
+
+  DEBUG("converting channel with %zu values from value_type=%d "
+      "scale=%g to value_type=%d scale=%g\n",
+      len, c->value_type, cs->scale, value_type, scale);
+
+  for(i=0; i<a->num_arrays; ++i)
+  {
+    void *old, *array;
+    size_t j, n;
+    if(a->arrays[i] == qp_channel_series_nan_array(c->value_type))
+    {
+      a->arrays[i] = qp_channel_series_nan_array(value_type);
+      continue;
+    }
+    old = qp_channel_series_array(cs, i, QP_CACHE_PEEK);
+    n = len - (i << ARRAY_SHIFT);
+    if(n > ARRAY_LENGTH)
+      n = ARRAY_LENGTH;
+    array = qp_channel_series_alloc_array(a, elem_size);
+    for(j=0; j<n; ++j)
+      set_value(&to, value_type, array, j,
+          get_value(cs, c->value_type, old, j));
+    if(a->arrays[i])
+      qp_channel_series_free_array(a, old,
+          qp_channel_series_value_size(c->value_type));
+    else
+      qp_channel_series_free_packed(a, i);
+    a->arrays[i] = array;
+    if(a->pack && i + 1 < a->num_arrays)
+      qp_channel_series_pack_array(cs, i, value_type);
+  }
+
+  /* the caches have values of the old type */
+  cs->cache_array[QP_CACHE_CURSOR] = (size_t) -1;
+  cs->cache_array[QP_CACHE_PEEK] = (size_t) -1;
+
+  c->value_type = value_type;
+  cs->scale = scale;
+  if(cs->current_array)
+    cs->current_array = qp_channel_series_array(cs,
+        cs->current_index >> ARRAY_SHIFT, QP_CACHE_CURSOR);
+}
+
+void qp_channel_series_append(qp_channel_t c, double val)
+{
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+
+  if(c->series.auto_type && !fits(c->value_type, c->series.scale, val))
+  {
+    int value_type;
+    double scale;
+    pick_type(c, val, &value_type, &scale);
+    convert(c, value_type, scale);
+    if(value_type == QP_TYPE_DOUBLE)
+      /* there is no larger type */
+      c->series.auto_type = 0;
+  }
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      qp_channel_series_double_append(c, val);
+      break;
+    case QP_TYPE_FLOAT:
+      qp_channel_series_float_append(c, val);
+      break;
+    case QP_TYPE_INT:
+      qp_channel_series_int_append(c, val);
+      break;
+    case QP_TYPE_SHORT:
+      qp_channel_series_short_append(c, val);
+      break;
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+}
+
+static inline
+void append_n(qp_channel_t c, const double *vals, size_t n)
+{
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      qp_channel_series_double_append_n(c, vals, n);
+      break;
+    case QP_TYPE_FLOAT:
+      qp_channel_series_float_append_n(c, vals, n);
+      break;
+    case QP_TYPE_INT:
+      qp_channel_series_int_append_n(c, vals, n);
+      break;
+    case QP_TYPE_SHORT:
+      qp_channel_series_short_append_n(c, vals, n);
+      break;
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+}
+
+void qp_channel_series_append_n(qp_channel_t c, const double *vals,
+    size_t n)
+{
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+
+  while(c->series.auto_type && n)
+  {
+    size_t m;
+    int value_type;
+    double scale;
+
+    /* append the values that fit the value type we have */
+    for(m=0; m<n && fits(c->value_type, c->series.scale, vals[m]); ++m);
+    append_n(c, vals, m);
+    vals += m;
+    n -= m;
+    if(!n)
+      return;
+
+    /* and change the value type for the one that does not */
+    pick_type(c, vals[0], &value_type, &scale);
+    convert(c, value_type, scale);
+    if(value_type == QP_TYPE_DOUBLE)
+      c->series.auto_type = 0;
+  }
+
+  append_n(c, vals, n);
+}
+
+void qp_channel_series_append_nan(qp_channel_t c, size_t n)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  struct qp_channel_chunk k;
+  double nan[ARRAY_LENGTH];
+  size_t i, m;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(c->series.arrays->ref_count == 1 ||
+      c->series.arrays->is_growing);
+
+  cs = &c->series;
+  a = cs->arrays;
+
+  for(i=0; i<ARRAY_LENGTH; ++i)
+    nan[i] = NAN;
+
+  /* fill the array that we are appending to */
+  m = (ARRAY_LENGTH - (a->length & ARRAY_MASK)) & ARRAY_MASK;
+  if(m > n)
+    m = n;
+  qp_channel_series_append_n(c, nan, m);
+  n -= m;
+
+  if(n >= ARRAY_LENGTH)
+  {
+    int first;
+    first = (a->length)?0:1;
+
+    if(first)
+    {
+      cs->max = -INFINITY;
+      cs->min = INFINITY;
+      cs->is_increasing = 1;
+      cs->is_decreasing = 1;
+    }
+    else if(a->pack)
+      /* the array before them is full */
+      qp_channel_series_pack_array(cs, (a->length >> ARRAY_SHIFT) - 1,
+          c->value_type);
+
+    /* the whole arrays are not stored */
+    for(; n >= ARRAY_LENGTH; n -= ARRAY_LENGTH)
+      qp_channel_series_add_nan_array(cs, c->value_type);
+
+    if(first)
+    {
+      cs->current_index = 0;
+      cs->current_array = a->arrays[0];
+    }
+    qp_channel_chunk_init(&k);
+    k.num_nan = ARRAY_LENGTH;
+    qp_channel_series_check_chunk(cs, &k);
+  }
+
+  qp_channel_series_append_n(c, nan, n);
+}
+
+void qp_channel_series_summarize(qp_channel_t c, size_t k)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+  double val[ARRAY_LENGTH];
+  size_t j, n;
+
+  ASSERT(c);
+  ASSERT(c->form == QP_CHANNEL_FORM_SERIES);
+  cs = &c->series;
+  a = cs->arrays;
+  ASSERT(k < a->num_arrays);
+  ASSERT(a->arrays[k]);
+
+  n = a->length - (k << ARRAY_SHIFT);
+  if(n > ARRAY_LENGTH)
+    n = ARRAY_LENGTH;
+
+  for(j=0; j<n; ++j)
+    val[j] = get_value(cs, c->value_type, a->arrays[k], j);
+
+  qp_channel_chunk_summary(&a->chunks[k], val, n);
+}
+
+void qp_channel_series_range(qp_channel_t c, size_t i, size_t j,
+    struct qp_channel_chunk *r)
+{
+  struct qp_channel_series *cs;
+  struct qp_channel_arrays *a;
+
+  ASSERT(c);
+  ASSERT(qp_channel_is_indexed(c));
+  ASSERT(i <= j);
+  ASSERT(j < qp_channel_series_length(c));
+
+  qp_channel_chunk_init(r);
+  cs = &c->series;
+  a = cs->arrays;
+
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+  {
+    if(c->func.is_linear)
+    {
+      /* the values are not stored, but we know them */
+      qp_channel_chunk_check(r, c->func.func(&c->func, i));
+      if(j > i)
+        qp_channel_chunk_check(r, c->func.func(&c->func, j));
+      return;
+    }
+    for(; i<=j; ++i)
+      qp_channel_chunk_check(r, c->func.func(&c->func, i));
+    return;
+  }
+
+  while(i <= j)
+  {
+    size_t k;
+    k = i >> ARRAY_SHIFT;
+
+    if(!(i & ARRAY_MASK) && j - i >= ARRAY_MASK)
+    {
+      /* the whole array is in the range */
+      qp_channel_chunk_merge(r, &a->chunks[k]);
+      i += ARRAY_LENGTH;
+    }
+    else
+    {
+      /* read the values up to the end of this array */
+      size_t end;
+      end = (k << ARRAY_SHIFT) + ARRAY_MASK;
+      if(end > j)
+        end = j;
+      for(; i<=end; ++i)
+        qp_channel_chunk_check(r, get_value(cs, c->value_type,
+              qp_channel_series_array(cs, k, QP_CACHE_PEEK),
+              i & ARRAY_MASK));
+    }
+  }
+}
@@ -0,0 +1,340 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Series channels that store float, int, or short values.
+ * A short or int channel stores rint(value*scale) so that
+ * numbers with a few decimal digits, like 12.25, can be
+ * stored in 2 or 4 bytes in place of 8 bytes.  The readers
+ * all return doubles. */
+
+#include <limits.h>
+
+
+#ifndef END_DOUBLE
+#error "You must include channel_double.h before this file."
+#endif
+
+
+/* The smallest short and int mark a value that is not a
+ * number, so we can keep NAN in integer channels. */
+#define QP_SHORT_NAN  SHRT_MIN
+#define QP_INT_NAN    INT_MIN
+
+/* The largest number of decimal digits after the point that
+ * we will try to keep in an integer channel, scale = 10^N */
+#define QP_MAX_SCALE_DECIMALS  (9)
+
+
+static inline
+double qp_series_short_to_double(const struct qp_channel_series *cs,
+    short x)
+{
+  if(x == QP_SHORT_NAN)
+    return NAN;
+  return x/cs->scale;
+}
+
+static inline
+short qp_series_double_to_short(const struct qp_channel_series *cs,
+    double val)
+{
+  if(isnan(val))
+    return QP_SHORT_NAN;
+  val *= cs->scale;
+  if(val >= SHRT_MAX)
+    return SHRT_MAX;
+  if(val <= -SHRT_MAX)
+    return -SHRT_MAX;
+  return (short) rint(val);
+}
+
+static inline
+double qp_series_int_to_double(const struct qp_channel_series *cs,
+    int x)
+{
+  if(x == QP_INT_NAN)
+    return NAN;
+  return x/cs->scale;
+}
+
+static inline
+int qp_series_double_to_int(const struct qp_channel_series *cs,
+    double val)
+{
+  if(isnan(val))
+    return QP_INT_NAN;
+  val *= cs->scale;
+  if(val >= INT_MAX)
+    return INT_MAX;
+  if(val <= -INT_MAX)
+    return -INT_MAX;
+  return (int) rint(val);
+}
+
+
+#define QP_SERIES_TYPE              float
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_FLOAT
+#define QP_SERIES_FUNC(name)        qp_channel_series_float_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   ((double) (x))
+#include "channel_series_type.h"
+
+#define QP_SERIES_TYPE              int
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_INT
+#define QP_SERIES_FUNC(name)        qp_channel_series_int_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   qp_series_int_to_double(cs, x)
+#include "channel_series_type.h"
+
+#define QP_SERIES_TYPE              short
+#define QP_SERIES_VALUE_TYPE        QP_TYPE_SHORT
+#define QP_SERIES_FUNC(name)        qp_channel_series_short_##name
+#define QP_SERIES_TO_DOUBLE(cs,x)   qp_series_short_to_double(cs, x)
+#include "channel_series_type.h"
+
+
+
+/* Appends val to a series channel of any value type.  If the
+ * channel was made with value_type QP_TYPE_UNKNOWN this may
+ * change the value_type and scale of the channel so that val
+ * fits. */
+extern
+void qp_channel_series_append(qp_channel_t c, double val);
+
+/* Like qp_channel_series_append() for n values at a time */
+extern
+void qp_channel_series_append_n(qp_channel_t c, const double *vals,
+    size_t n);
+
+/* Appends n NANs, like to pad the top of a channel that starts
+ * lower in the file than the others.  The whole arrays of them are
+ * the shared array of NAN, see qp_channel_series_nan_array(), so
+ * they use no memory and are not summarized one value at a time. */
+extern
+void qp_channel_series_append_nan(qp_channel_t c, size_t n);
+
+
+/* Gets the summary of array k of a channel from
+ * qp_channel_series_map().  This only writes the summary of array k,
+ * so many threads may do this for different arrays at once. */
+extern
+void qp_channel_series_summarize(qp_channel_t c, size_t k);
+
+/* Gets the summary of the values with index i to j, inclusive,
+ * in r.  Series channels use the summary of each array that is
+ * all in the range, so this reads at most two arrays of values. */
+extern
+void qp_channel_series_range(qp_channel_t c, size_t i, size_t j,
+    struct qp_channel_chunk *r);
+
+
+/* The readers below work with any series value type and with
+ * function channels.  They cost a switch, so the plots use the
+ * function pointers to the typed readers in place of these. */
+
+static inline
+double qp_channel_series_begin(qp_channel_t c)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_begin(c);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_begin(c);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_begin(c);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_begin(c);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_begin(c);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return END_DOUBLE;
+}
+
+static inline
+double qp_channel_series_end(qp_channel_t c)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_end(c);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_end(c);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_end(c);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_end(c);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_end(c);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return END_DOUBLE;
+}
+
+static inline
+double qp_channel_series_next(qp_channel_t c)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_next(c);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_next(c);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_next(c);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_next(c);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_next(c);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return END_DOUBLE;
+}
+
+static inline
+double qp_channel_series_prev(qp_channel_t c)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_prev(c);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_prev(c);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_prev(c);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_prev(c);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_prev(c);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return END_DOUBLE;
+}
+
+static inline
+double qp_channel_series_index(qp_channel_t c, size_t i)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_index(c, i);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_index(c, i);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_index(c, i);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_index(c, i);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_index(c, i);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return END_DOUBLE;
+}
+
+/* For a channel that is increasing, not counting NAN like values,
+ * returns the index of the first value that is greater than val,
+ * or greater than or equal to val if or_equal is set, or the length
+ * if there is none.  This is O(log n) and does not move the reading
+ * cursor. */
+static inline
+size_t qp_channel_series_search(qp_channel_t c, double val, int or_equal)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_search(c, val, or_equal);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_search(c, val, or_equal);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_search(c, val, or_equal);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_search(c, val, or_equal);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_search(c, val, or_equal);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return 0;
+}
+
+static inline
+size_t qp_channel_series_find_lt(qp_channel_t c, double *v)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_find_lt(c, v);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_find_lt(c, v);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_find_lt(c, v);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_find_lt(c, v);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_find_lt(c, v);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return 0;
+}
+
+static inline
+size_t qp_channel_series_find_gt(qp_channel_t c, double *v)
+{
+  if(c->form == QP_CHANNEL_FORM_FUNC)
+    return qp_channel_func_find_gt(c, v);
+
+  switch(c->value_type)
+  {
+    case QP_TYPE_DOUBLE:
+      return qp_channel_series_double_find_gt(c, v);
+    case QP_TYPE_FLOAT:
+      return qp_channel_series_float_find_gt(c, v);
+    case QP_TYPE_INT:
+      return qp_channel_series_int_find_gt(c, v);
+    case QP_TYPE_SHORT:
+      return qp_channel_series_short_find_gt(c, v);
+    default:
+      VASSERT(0, "bad value_type=%d\n", c->value_type);
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,410 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Reading gzip, xz and zstd compressed files.  A thread
+ * decompresses the file into a pipe, and the file is read from the
+ * other end of the pipe like any other pipe, so libsndfile and the
+ * text parser see the decompressed bytes.  The pipe buffer is the
+ * ring buffer between the thread and the parser, so decompressing
+ * and parsing run at the same time. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#ifdef HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#  include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "qp.h"
+#include "debug.h"
+#include "spew.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* bytes we read from the compressed file at a time */
+#define IN_LEN    (256*1024)
+/* bytes we decompress before writing them to the pipe */
+#define OUT_LEN   (256*1024)
+/* the size of the pipe buffer that we ask for */
+#define PIPE_LEN  (1024*1024)
+
+
+static const struct
+{
+  const char *name;
+  const uint8_t magic[6];
+  size_t len;
+}
+formats[] =
+{
+  [QP_COMPRESS_GZIP] = { "gzip", { 0x1f, 0x8b }, 2 },
+  [QP_COMPRESS_XZ]   = { "xz",   { 0xfd, '7', 'z', 'X', 'Z', 0x00 }, 6 },
+  [QP_COMPRESS_ZSTD] = { "zstd", { 0x28, 0xb5, 0x2f, 0xfd }, 4 }
+};
+
+#define NUM_FORMATS  ((int)(sizeof(formats)/sizeof(formats[0])))
+
+
+struct decompress
+{
+  int type;
+  int in;  /* the compressed file */
+  int out; /* the pipe we write to */
+  char *name;
+  uint8_t *in_buf, *out_buf;
+};
+
+
+int qp_decompress_check(int fd)
+{
+  uint8_t head[6];
+  ssize_t n;
+  int type;
+
+  /* This does not move the file offset, and fails on pipes. */
+  n = pread(fd, head, sizeof(head), 0);
+  if(n < 2)
+    return QP_COMPRESS_NONE;
+
+  for(type=1; type<NUM_FORMATS; ++type)
+    if((size_t) n >= formats[type].len &&
+        !memcmp(head, formats[type].magic, formats[type].len))
+      return type;
+
+  return QP_COMPRESS_NONE;
+}
+
+/* Returns 0 on success, or 1 if the pipe is closed, that is the
+ * reader does not want any more. */
+static inline
+int write_out(struct decompress *d, size_t len)
+{
+  const uint8_t *buf;
+  buf = d->out_buf;
+
+  while(len)
+  {
+    ssize_t n;
+    n = write(d->out, buf, len);
+    if(n == -1)
+    {
+      if(errno == EINTR)
+        continue;
+      if(errno != EPIPE)
+        QP_EWARN("failed to write decompressed %s to pipe\n", d->name);
+      return 1;
+    }
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+static inline
+ssize_t read_in(struct decompress *d)
+{
+  ssize_t n;
+  while((n = read(d->in, d->in_buf, IN_LEN)) == -1 && errno == EINTR);
+  if(n == -1)
+    QP_EWARN("failed to read file %s\n", d->name);
+  return n;
+}
+
+#ifdef HAVE_ZLIB
+static
+int gunzip(struct decompress *d)
+{
+  z_stream z;
+  ssize_t n;
+  int ret = Z_OK, err = 0;
+
+  memset(&z, 0, sizeof(z));
+  /* 32 to read the gzip header */
+  if(inflateInit2(&z, 15 + 32) != Z_OK)
+    return 1;
+
+  while(!err && (n = read_in(d)) > 0)
+  {
+    z.next_in = d->in_buf;
+    z.avail_in = n;
+    do
+    {
+      if(ret == Z_STREAM_END)
+        /* the next gzip member that is catted onto the file */
+        inflateReset(&z);
+      z.next_out = d->out_buf;
+      z.avail_out = OUT_LEN;
+      ret = inflate(&z, Z_NO_FLUSH);
+      if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+      {
+        QP_WARN("gzip file %s is corrupt: %s\n", d->name,
+            (z.msg)?z.msg:"");
+        err = 1;
+        break;
+      }
+      if((err = write_out(d, OUT_LEN - z.avail_out)))
+        break;
+    } while(z.avail_in || !z.avail_out);
+  }
+
+  if(!err && !n && ret != Z_STREAM_END)
+  {
+    /* like unxz() we tell the user that data is missing */
+    QP_WARN("gzip file %s ends before the end of the "
+        "compressed data\n", d->name);
+    err = 1;
+  }
+
+  inflateEnd(&z);
+  return err || n;
+}
+#endif
+
+#ifdef HAVE_LZMA
+static
+int unxz(struct decompress *d)
+{
+  lzma_stream s = LZMA_STREAM_INIT;
+  lzma_action action = LZMA_RUN;
+  lzma_ret ret;
+  int err = 0;
+
+  if(lzma_stream_decoder(&s, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+    return 1;
+
+  do
+  {
+    if(!s.avail_in && action == LZMA_RUN)
+    {
+      ssize_t n;
+      if((n = read_in(d)) == -1)
+      {
+        err = 1;
+        break;
+      }
+      if(!n)
+        action = LZMA_FINISH;
+      s.next_in = d->in_buf;
+      s.avail_in = n;
+    }
+    s.next_out = d->out_buf;
+    s.avail_out = OUT_LEN;
+    ret = lzma_code(&s, action);
+    if(ret != LZMA_OK && ret != LZMA_STREAM_END)
+    {
+      QP_WARN("xz file %s is corrupt: error %d\n", d->name, (int) ret);
+      err = 1;
+      break;
+    }
+    err = write_out(d, OUT_LEN - s.avail_out);
+  } while(!err && ret != LZMA_STREAM_END);
+
+  lzma_end(&s);
+  return err;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static
+int unzstd(struct decompress *d)
+{
+  ZSTD_DCtx *z;
+  ssize_t n;
+  /* ret is 0 when a frame is done and all of it is written out */
+  size_t ret = 1;
+  int err = 0;
+
+  if(!(z = ZSTD_createDCtx()))
+    return 1;
+
+  while(!err && (n = read_in(d)) > 0)
+  {
+    ZSTD_inBuffer in = { d->in_buf, n, 0 };
+    ZSTD_outBuffer out;
+    do
+    {
+      out.dst = d->out_buf;
+      out.size = OUT_LEN;
+      out.pos = 0;
+      ret = ZSTD_decompressStream(z, &out, &in);
+      if(ZSTD_isError(ret))
+      {
+        QP_WARN("zstd file %s is corrupt: %s\n", d->name,
+            ZSTD_getErrorName(ret));
+        err = 1;
+        break;
+      }
+      if((err = write_out(d, out.pos)))
+        break;
+    } while(in.pos < in.size || (out.pos == out.size && ret));
+  }
+
+  if(!err && !n && ret)
+  {
+    QP_WARN("zstd file %s ends before the end of the "
+        "compressed data\n", d->name);
+    err = 1;
+  }
+
+  ZSTD_freeDCtx(z);
+  return err || n;
+}
+#endif
+
+static
+void *decompress_thread(void *data)
+{
+  struct decompress *d;
+  sigset_t set;
+  int err = 1;
+
+  d = data;
+
+  /* If the reader closes the pipe we get EPIPE from write() and
+   * not a SIGPIPE that kills the program. */
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  switch(d->type)
+  {
+#ifdef HAVE_ZLIB
+    case QP_COMPRESS_GZIP:
+      err = gunzip(d);
+      break;
+#endif
+#ifdef HAVE_LZMA
+    case QP_COMPRESS_XZ:
+      err = unxz(d);
+      break;
+#endif
+#ifdef HAVE_ZSTD
+    case QP_COMPRESS_ZSTD:
+      err = unzstd(d);
+      break;
+#endif
+    default:
+      ASSERT(0);
+      break;
+  }
+
+  DEBUG("%s decompressing %s %s\n", formats[d->type].name, d->name,
+      (err)?"stopped":"finished");
+
+  /* The reader gets end-of-file. */
+  close(d->out);
+  close(d->in);
+  free(d->in_buf);
+  free(d->out_buf);
+  free(d->name);
+  free(d);
+  return NULL;
+}
+
+int qp_decompress_start(int fd, int type, const char *name)
+{
+  struct decompress *d;
+  pthread_attr_t attr;
+  pthread_t thread;
+  int p[2];
+
+  ASSERT(type > QP_COMPRESS_NONE && type < NUM_FORMATS);
+
+  switch(type)
+  {
+#ifdef HAVE_ZLIB
+    case QP_COMPRESS_GZIP:
+#endif
+#ifdef HAVE_LZMA
+    case QP_COMPRESS_XZ:
+#endif
+#ifdef HAVE_ZSTD
+    case QP_COMPRESS_ZSTD:
+#endif
+      break;
+    default:
+      QP_WARN("file %s is %s compressed, but this Quickplot was "
+          "built without %s\n", name, formats[type].name,
+          formats[type].name);
+      return -1;
+  }
+
+  if(pipe(p))
+  {
+    QP_EWARN("pipe() failed for file %s\n", name);
+    return -1;
+  }
+  /* A bigger pipe lets the thread get further ahead of the parser. */
+  fcntl(p[1], F_SETPIPE_SZ, PIPE_LEN);
+
+  d = (struct decompress *) qp_malloc(sizeof(*d));
+  d->type = type;
+  d->in = fd;
+  d->out = p[1];
+  d->name = qp_strdup(name);
+  d->in_buf = (uint8_t *) qp_malloc(IN_LEN);
+  d->out_buf = (uint8_t *) qp_malloc(OUT_LEN);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if(pthread_create(&thread, &attr, decompress_thread, d))
+  {
+    QP_EWARN("failed to make a thread to decompress %s\n", name);
+    pthread_attr_destroy(&attr);
+    close(p[0]);
+    close(p[1]);
+    free(d->in_buf);
+    free(d->out_buf);
+    free(d->name);
+    free(d);
+    return -1;
+  }
+  pthread_attr_destroy(&attr);
+
+  DEBUG("reading %s compressed file %s from a thread\n",
+      formats[type].name, name);
+
+  return p[0];
+}
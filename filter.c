@@ -0,0 +1,640 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* The row filter of --where EXPR and --x-range MIN:MAX, that the
+ * text parser asks about each line of values before it keeps them.
+ * EXPR is compiled once into a little stack program, so testing a
+ * row is a short loop with no parsing. */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "qp.h"
+#include "debug.h"
+#include "spew.h"
+#include "scan_double.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* The most values on the stack when running an expression */
+#define MAX_STACK  (64)
+/* The most (, -, + and ! inside each other, so that a long run of
+ * them can't overflow the stack of the compiler */
+#define MAX_NEST   (256)
+
+/* filter_op codes */
+#define OP_NUMBER  0  /* push value */
+#define OP_COLUMN  1  /* push the value of the column slot */
+#define OP_NEG     2
+#define OP_NOT     3
+#define OP_MUL     4
+#define OP_DIV     5
+#define OP_ADD     6
+#define OP_SUB     7
+#define OP_LT      8
+#define OP_LE      9
+#define OP_GT      10
+#define OP_GE      11
+#define OP_EQ      12
+#define OP_NE      13
+#define OP_AND     14
+#define OP_OR      15
+
+struct filter_op
+{
+  int code;
+  double value; /* for OP_NUMBER */
+  size_t slot; /* for OP_COLUMN */
+};
+
+struct qp_filter
+{
+  /* the --where program, or none if num_ops is 0 */
+  struct filter_op *op;
+  size_t num_ops;
+
+  /* --x-range, that tests column 0 */
+  int x_range;
+  double x_min, x_max;
+  size_t x_slot;
+
+  /* The file columns that are used, and the index in a row of
+   * values of each, set by qp_filter_bind(). */
+  size_t *column, *index;
+  size_t num_columns;
+};
+
+/* The state of compiling an expression */
+struct compiler
+{
+  struct qp_filter *f;
+  const char *expr, *s;
+  size_t alloc_ops;
+  int depth, max_depth;
+  int nest; /* how deep in parse_unary() we are */
+  int err;
+};
+
+
+/* Returns the slot of file column col, adding it if it is new */
+static
+size_t add_column(struct qp_filter *f, size_t col)
+{
+  size_t i;
+  for(i=0; i<f->num_columns; ++i)
+    if(f->column[i] == col)
+      return i;
+  f->column = (size_t *) qp_realloc(f->column,
+      sizeof(size_t)*(f->num_columns+1));
+  f->column[f->num_columns] = col;
+  return f->num_columns++;
+}
+
+static
+void emit(struct compiler *c, int code, double value, size_t slot)
+{
+  struct qp_filter *f;
+  f = c->f;
+
+  if(f->num_ops == c->alloc_ops)
+  {
+    c->alloc_ops = (c->alloc_ops)?(2*c->alloc_ops):16;
+    f->op = (struct filter_op *) qp_realloc(f->op,
+        sizeof(struct filter_op)*c->alloc_ops);
+  }
+  f->op[f->num_ops].code = code;
+  f->op[f->num_ops].value = value;
+  f->op[f->num_ops].slot = slot;
+  ++f->num_ops;
+
+  if(code == OP_NUMBER || code == OP_COLUMN)
+  {
+    if(++c->depth > c->max_depth)
+      c->max_depth = c->depth;
+  }
+  else if(code != OP_NEG && code != OP_NOT)
+    /* binary operators pop two and push one */
+    --c->depth;
+}
+
+static
+void syntax_error(struct compiler *c, const char *what)
+{
+  if(c->err)
+    return;
+  c->err = 1;
+  QP_WARN("bad --where \"%s\": %s at \"%s\"\n", c->expr, what, c->s);
+}
+
+static inline
+void skip_space(struct compiler *c)
+{
+  while(isspace(*c->s))
+    ++c->s;
+}
+
+/* If the next token is op, skips it and returns 1 */
+static inline
+int token(struct compiler *c, const char *op)
+{
+  size_t len;
+  skip_space(c);
+  len = strlen(op);
+  if(strncmp(c->s, op, len))
+    return 0;
+  /* so that < does not take the < of <= */
+  if(len == 1 && (op[0] == '<' || op[0] == '>' || op[0] == '!') &&
+      c->s[1] == '=')
+    return 0;
+  c->s += len;
+  return 1;
+}
+
+static void parse_or(struct compiler *c);
+static void parse_unary(struct compiler *c);
+
+static
+void parse_operand(struct compiler *c)
+{
+  char *end;
+
+  if(token(c, "-"))
+  {
+    parse_unary(c);
+    emit(c, OP_NEG, 0, 0);
+    return;
+  }
+  if(token(c, "+"))
+  {
+    parse_unary(c);
+    return;
+  }
+  if(token(c, "!"))
+  {
+    parse_unary(c);
+    emit(c, OP_NOT, 0, 0);
+    return;
+  }
+  if(token(c, "("))
+  {
+    parse_or(c);
+    if(!c->err && !token(c, ")"))
+      syntax_error(c, "expected )");
+    return;
+  }
+
+  skip_space(c);
+
+  if((c->s[0] == 'c' || c->s[0] == 'C') && isdigit(c->s[1]))
+  {
+    /* cN is the value in column N of the file */
+    size_t col;
+    col = strtoul(c->s + 1, &end, 10);
+    c->s = end;
+    emit(c, OP_COLUMN, 0, add_column(c->f, col));
+    return;
+  }
+
+  if(isdigit(c->s[0]) || (c->s[0] == '.' && isdigit(c->s[1])))
+  {
+    double value;
+    value = qp_scan_strtod(c->s, &end);
+    c->s = end;
+    emit(c, OP_NUMBER, value, 0);
+    return;
+  }
+
+  syntax_error(c, "expected a number, a column like c2, or (");
+}
+
+static
+void parse_unary(struct compiler *c)
+{
+  if(c->err)
+    return;
+
+  if(c->nest == MAX_NEST)
+  {
+    syntax_error(c, "nested too deep");
+    return;
+  }
+  ++c->nest;
+  parse_operand(c);
+  --c->nest;
+}
+
+static
+void parse_product(struct compiler *c)
+{
+  parse_unary(c);
+  while(!c->err)
+  {
+    if(token(c, "*"))
+    {
+      parse_unary(c);
+      emit(c, OP_MUL, 0, 0);
+    }
+    else if(token(c, "/"))
+    {
+      parse_unary(c);
+      emit(c, OP_DIV, 0, 0);
+    }
+    else
+      break;
+  }
+}
+
+static
+void parse_sum(struct compiler *c)
+{
+  parse_product(c);
+  while(!c->err)
+  {
+    if(token(c, "+"))
+    {
+      parse_product(c);
+      emit(c, OP_ADD, 0, 0);
+    }
+    else if(token(c, "-"))
+    {
+      parse_product(c);
+      emit(c, OP_SUB, 0, 0);
+    }
+    else
+      break;
+  }
+}
+
+static
+void parse_compare(struct compiler *c)
+{
+  parse_sum(c);
+  while(!c->err)
+  {
+    int code;
+    if(token(c, "<="))
+      code = OP_LE;
+    else if(token(c, ">="))
+      code = OP_GE;
+    else if(token(c, "<"))
+      code = OP_LT;
+    else if(token(c, ">"))
+      code = OP_GT;
+    else if(token(c, "=="))
+      code = OP_EQ;
+    else if(token(c, "!="))
+      code = OP_NE;
+    else
+      break;
+    parse_sum(c);
+    emit(c, code, 0, 0);
+  }
+}
+
+static
+void parse_and(struct compiler *c)
+{
+  parse_compare(c);
+  while(!c->err && token(c, "&&"))
+  {
+    parse_compare(c);
+    emit(c, OP_AND, 0, 0);
+  }
+}
+
+static
+void parse_or(struct compiler *c)
+{
+  parse_and(c);
+  while(!c->err && token(c, "||"))
+  {
+    parse_and(c);
+    emit(c, OP_OR, 0, 0);
+  }
+}
+
+static
+int compile_where(struct qp_filter *f, const char *expr)
+{
+  struct compiler c;
+
+  memset(&c, 0, sizeof(c));
+  c.f = f;
+  c.expr = c.s = expr;
+
+  parse_or(&c);
+  skip_space(&c);
+  if(!c.err && *c.s)
+    syntax_error(&c, "expected an operator");
+  if(!c.err && c.max_depth > MAX_STACK)
+  {
+    QP_WARN("--where \"%s\" is too long\n", expr);
+    c.err = 1;
+  }
+  return c.err;
+}
+
+/* parses a --x-range MIN:MAX, where MIN or MAX may be left out */
+static
+int parse_x_range(struct qp_filter *f, const char *range)
+{
+  const char *s;
+  char *end;
+
+  f->x_min = -INFINITY;
+  f->x_max = INFINITY;
+  s = range;
+
+  while(isspace(*s))
+    ++s;
+  if(*s != ':')
+  {
+    f->x_min = qp_scan_strtod(s, &end);
+    if(end == s || isnan(f->x_min))
+      goto fail;
+    s = end;
+    while(isspace(*s))
+      ++s;
+  }
+  if(*s != ':')
+    goto fail;
+  ++s;
+  while(isspace(*s))
+    ++s;
+  if(*s)
+  {
+    f->x_max = qp_scan_strtod(s, &end);
+    if(end == s || isnan(f->x_max))
+      goto fail;
+    s = end;
+    while(isspace(*s))
+      ++s;
+    if(*s)
+      goto fail;
+  }
+
+  if(f->x_min > f->x_max)
+  {
+    double t;
+    t = f->x_min;
+    f->x_min = f->x_max;
+    f->x_max = t;
+  }
+
+  f->x_range = 1;
+  f->x_slot = add_column(f, 0);
+  return 0;
+
+fail:
+
+  QP_WARN("bad --x-range \"%s\", it should be like 1000:2000\n", range);
+  return 1;
+}
+
+struct qp_filter *qp_filter_create(const char *where, const char *x_range)
+{
+  struct qp_filter *f;
+  size_t i;
+
+  ASSERT(where || x_range);
+
+  f = (struct qp_filter *) qp_malloc(sizeof(*f));
+  memset(f, 0, sizeof(*f));
+
+  if((where && compile_where(f, where)) ||
+      (x_range && parse_x_range(f, x_range)))
+  {
+    qp_filter_destroy(f);
+    return NULL;
+  }
+
+  /* With no qp_filter_bind() the columns are the row indexes. */
+  f->index = (size_t *) qp_malloc(sizeof(size_t)*(f->num_columns+1));
+  for(i=0; i<f->num_columns; ++i)
+    f->index[i] = f->column[i];
+
+  return f;
+}
+
+void qp_filter_destroy(struct qp_filter *f)
+{
+  ASSERT(f);
+  if(f->op)
+    free(f->op);
+  if(f->column)
+    free(f->column);
+  if(f->index)
+    free(f->index);
+  free(f);
+}
+
+char *qp_filter_columns(const struct qp_filter *f, const char *list)
+{
+  size_t i, len;
+  char *cols;
+
+  ASSERT(f);
+  ASSERT(list);
+
+  len = strlen(list);
+  cols = (char *) qp_malloc(len + 24*f->num_columns + 1);
+  memcpy(cols, list, len + 1);
+  for(i=0; i<f->num_columns; ++i)
+    len += sprintf(cols + len, ",%zu", f->column[i]);
+  return cols;
+}
+
+void qp_filter_bind(struct qp_filter *f, const size_t *select)
+{
+  size_t i, k;
+
+  ASSERT(f);
+
+  for(i=0; i<f->num_columns; ++i)
+  {
+    if(!select)
+    {
+      f->index[i] = f->column[i];
+      continue;
+    }
+    for(k=0; select[k] != QP_SELECT_END && select[k] != f->column[i]; ++k);
+    /* a column that is not read is always blank */
+    f->index[i] = (select[k] == f->column[i])?k:QP_SELECT_END;
+  }
+}
+
+void qp_filter_state_init(struct qp_filter_state *st)
+{
+  ASSERT(st);
+  st->first_x = NAN;
+  st->last_x = NAN;
+  st->increasing = 1;
+  st->end_rows = QP_FILTER_NO_END;
+}
+
+static inline
+double row_value(const struct qp_filter *f, size_t slot,
+    double *const *row, size_t num, size_t i)
+{
+  size_t k;
+  k = f->index[slot];
+  return (k < num)?row[k][i]:NAN;
+}
+
+static inline
+int run_where(const struct qp_filter *f,
+    double *const *row, size_t num, size_t i)
+{
+  double stack[MAX_STACK];
+  const struct filter_op *op, *end;
+  double *top;
+
+  top = stack - 1;
+  end = f->op + f->num_ops;
+
+  for(op = f->op; op < end; ++op)
+  {
+    switch(op->code)
+    {
+      case OP_NUMBER:
+        *(++top) = op->value;
+        break;
+      case OP_COLUMN:
+        *(++top) = row_value(f, op->slot, row, num, i);
+        break;
+      case OP_NEG:
+        *top = - *top;
+        break;
+      case OP_NOT:
+        *top = (*top == 0);
+        break;
+#define BINARY(CODE, EXPR) \
+      case CODE: \
+        --top; \
+        *top = (EXPR); \
+        break
+      BINARY(OP_MUL, top[0] * top[1]);
+      BINARY(OP_DIV, top[0] / top[1]);
+      BINARY(OP_ADD, top[0] + top[1]);
+      BINARY(OP_SUB, top[0] - top[1]);
+      BINARY(OP_LT, top[0] < top[1]);
+      BINARY(OP_LE, top[0] <= top[1]);
+      BINARY(OP_GT, top[0] > top[1]);
+      BINARY(OP_GE, top[0] >= top[1]);
+      BINARY(OP_EQ, top[0] == top[1]);
+      BINARY(OP_NE, top[0] != top[1]);
+      BINARY(OP_AND, top[0] != 0 && top[1] != 0 &&
+          !isnan(top[0]) && !isnan(top[1]));
+      BINARY(OP_OR, (top[0] != 0 && !isnan(top[0])) ||
+          (top[1] != 0 && !isnan(top[1])));
+#undef BINARY
+      default:
+        ASSERT(0);
+        break;
+    }
+  }
+
+  ASSERT(top == stack);
+  return (*top != 0 && !isnan(*top));
+}
+
+int qp_filter_row(const struct qp_filter *f, struct qp_filter_state *st,
+    double *const *row, size_t num, size_t i, size_t num_rows)
+{
+  ASSERT(f);
+  ASSERT(st);
+
+  if(f->x_range)
+  {
+    double x;
+    x = row_value(f, f->x_slot, row, num, i);
+    if(isnan(x))
+      return 0;
+    if(isnan(st->first_x))
+      st->first_x = x;
+    else if(x < st->last_x)
+      st->increasing = 0;
+    st->last_x = x;
+
+    if(x > f->x_max)
+    {
+      /* If x has been increasing the rest are past it too. */
+      if(st->increasing && st->end_rows == QP_FILTER_NO_END)
+        st->end_rows = num_rows;
+      return 0;
+    }
+    if(x < f->x_min)
+      return 0;
+  }
+
+  if(f->num_ops)
+    return run_where(f, row, num, i);
+
+  return 1;
+}
+
+int qp_filter_join(struct qp_filter_state *st,
+    const struct qp_filter_state *next, size_t *num_rows)
+{
+  int increasing;
+
+  ASSERT(st);
+  ASSERT(next);
+
+  if(st->end_rows != QP_FILTER_NO_END)
+  {
+    /* We stopped before these rows. */
+    *num_rows = 0;
+    return 1;
+  }
+
+  increasing = st->increasing &&
+    (isnan(st->last_x) || isnan(next->first_x) ||
+     next->first_x >= st->last_x);
+
+  if(increasing && next->end_rows != QP_FILTER_NO_END)
+  {
+    *num_rows = next->end_rows;
+    st->end_rows = next->end_rows;
+    return 1;
+  }
+
+  st->increasing = increasing && next->increasing;
+  if(isnan(st->first_x))
+    st->first_x = next->first_x;
+  if(!isnan(next->last_x))
+    st->last_x = next->last_x;
+  return 0;
+}
@@ -31,6 +31,8 @@
 #include "list.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "callbacks.h"
 #include "qp.h"
 #include "plot.h"
@@ -612,8 +614,8 @@ void _qp_graph_rescale_plots(struct qp_graph *gr)
   struct qp_plot *p;
 
   p=qp_sllist_begin(gr->plots);
-  ASSERT(p->x->form == QP_CHANNEL_FORM_SERIES);
-  ASSERT(p->y->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(qp_channel_is_indexed(p->x));
+  ASSERT(qp_channel_is_indexed(p->y));
   csx0 = &(p->x->series);
   csy0 = &(p->y->series);
   gr->same_x_limits = 1;
@@ -623,8 +625,8 @@ void _qp_graph_rescale_plots(struct qp_graph *gr)
   {
     double dx, dy;
     struct qp_channel_series *cs;
-    ASSERT(p->x->form == QP_CHANNEL_FORM_SERIES);
-    ASSERT(p->y->form == QP_CHANNEL_FORM_SERIES);
+    ASSERT(qp_channel_is_indexed(p->x));
+    ASSERT(qp_channel_is_indexed(p->y));
     cs = &(p->x->series);
     dx = cs->max - cs->min;
     if(xmin > cs->min)
@@ -741,6 +743,96 @@ void _qp_graph_set_redraw(struct qp_graph *gr)
   }
 }
 
+/* returns 1 if the values in the plot channels are in the
+ * ranges that the plot was scaled with */
+static inline
+int plot_values_in_scale(struct qp_plot *p)
+{
+  double min, max;
+
+  /* qp_plot_x_rescale() gives xscale0 = 1/(max - min) and
+   * xshift0 = -min/(max - min) */
+  min = - p->xshift0/p->xscale0;
+  max = (1.0 - p->xshift0)/p->xscale0;
+  if(p->x->series.min < min || p->x->series.max > max)
+    return 0;
+
+  min = - p->yshift0/p->yscale0;
+  max = (1.0 - p->yshift0)/p->yscale0;
+  if(p->y->series.min < min || p->y->series.max > max)
+    return 0;
+
+  return 1;
+}
+
+/* Rescales the plots after values were appended and left the x
+ * scale.  We give the x scale room for as many more values on the
+ * side that grew, so the scale doubles and most of the next batches
+ * fit and just the new points get drawn by qp_graph_draw_tail(). */
+static
+void rescale_growing_plots(struct qp_graph *gr)
+{
+  struct qp_plot *p;
+  int grew_min = 0, grew_max = 0;
+
+  for(p=qp_sllist_begin(gr->plots);p;p=qp_sllist_next(gr->plots))
+  {
+    if(p->x->series.min < - p->xshift0/p->xscale0)
+      grew_min = 1;
+    if(p->x->series.max > (1.0 - p->xshift0)/p->xscale0)
+      grew_max = 1;
+  }
+
+  _qp_graph_rescale_plots(gr);
+
+  if(!grew_min && !grew_max)
+    return;
+
+  for(p=qp_sllist_begin(gr->plots);p;p=qp_sllist_next(gr->plots))
+  {
+    double min, max, dx;
+    min = - p->xshift0/p->xscale0;
+    max = (1.0 - p->xshift0)/p->xscale0;
+    dx = max - min;
+    if(grew_min)
+      min -= dx;
+    if(grew_max)
+      max += dx;
+    qp_plot_x_rescale(p, min, max);
+  }
+}
+
+void qp_graph_update(struct qp_graph *gr)
+{
+  struct qp_plot *p;
+  int in_scale = 1;
+
+  ASSERT(gr);
+
+  if(!qp_sllist_length(gr->plots))
+    return;
+
+  for(p=qp_sllist_begin(gr->plots);p;p=qp_sllist_next(gr->plots))
+    if(!plot_values_in_scale(p))
+    {
+      in_scale = 0;
+      break;
+    }
+
+  if(!in_scale && gr->zoom_level == 0)
+  {
+    /* We let the user keep looking where they zoomed to,
+     * otherwise the graph grows to show all the values. */
+    rescale_growing_plots(gr);
+    gr->pixbuf_needs_draw = 1;
+  }
+  else if(!qp_graph_draw_tail(gr))
+    gr->pixbuf_needs_draw = 1;
+
+  if(gr->pixbuf_needs_draw)
+    gtk_widget_queue_draw(gr->drawing_area);
+}
+
 void qp_graph_remove_plot(struct qp_graph *gr, struct qp_plot *p)
 {
   ASSERT(gr);
@@ -771,8 +863,8 @@ void qp_graph_add_plot(struct qp_graph *gr,
   x = sx->channels[x_channel_num];
   y = sy->channels[y_channel_num];
 
-  ASSERT(x->form == QP_CHANNEL_FORM_SERIES);
-  ASSERT(y->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(qp_channel_is_indexed(x));
+  ASSERT(qp_channel_is_indexed(y));
 
   qp_source_get_plot_name(pname, 128, sx, sy,
       x_channel_num, y_channel_num);
@@ -798,7 +890,7 @@ void qp_graph_same_x_scale(struct qp_graph *gr, int same_x_scale /* 0 or 1 */)
     struct qp_plot *p;
     for(p=qp_sllist_begin(gr->plots);p;p=qp_sllist_next(gr->plots))
     {
-      ASSERT(p->x->form == QP_CHANNEL_FORM_SERIES);
+      ASSERT(qp_channel_is_indexed(p->x));
       if(max < p->x->series.max)
         max = p->x->series.max;
       if(min > p->x->series.min)
@@ -857,7 +949,7 @@ void qp_graph_same_y_scale(struct qp_graph *gr, int same_y_scale /* 0 or 1 */)
     struct qp_plot *p;
     for(p=qp_sllist_begin(gr->plots);p;p=qp_sllist_next(gr->plots))
     {
-      ASSERT(p->y->form == QP_CHANNEL_FORM_SERIES);
+      ASSERT(qp_channel_is_indexed(p->y));
       if(max < p->y->series.max)
         max = p->y->series.max;
       if(min > p->y->series.min)
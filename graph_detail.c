@@ -42,6 +42,8 @@
 
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "plot.h"
 
 #ifdef DMALLOC
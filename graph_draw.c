@@ -33,6 +33,9 @@
 #include "callbacks.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pyramid.h"
 #include "qp.h"
 #include "plot.h"
 
@@ -151,6 +154,16 @@ void cairo_DrawLine(struct qp_graph *gr,
  *  bounds" to represent lines that would otherwise be drawn
  *  off the drawing area.
  */
+/* the number of x,y points in the plot */
+static inline
+size_t plot_length(struct qp_plot *p)
+{
+  size_t len, ylen;
+  len = qp_channel_series_length(p->x);
+  ylen = qp_channel_series_length(p->y);
+  return (ylen < len)?ylen:len;
+}
+
 static
 inline
 void CullDrawLine(struct qp_graph *gr,
@@ -404,6 +417,246 @@ void draw_grid(struct qp_graph *gr, cairo_t *cr,
 }
 
 
+/* A zoomed out plot with an increasing x channel can have many
+ * more values than pixel columns.  In place of reading all the
+ * values we read the min and max of the y values in each pixel
+ * column from the summary pyramid of the y channel.
+ *
+ * qp_plot_scale() must be called before this.  This returns the
+ * pyramid level to read, or -1 if the plot should be read value
+ * by value with qp_plot_begin() and qp_plot_next(). */
+static inline
+int summary_begin(struct qp_plot *p, int xpix_min, int xpix_max,
+    struct qp_channel_pyramid **py, size_t *bucket, size_t *end)
+{
+  double xmin, xmax;
+  size_t i, j, n;
+  int level;
+
+  if(!qp_plot_can_cull(p) || p->x->series.min == p->x->series.max)
+    return -1;
+
+  xmin = qp_plot_get_xval(p, xpix_min);
+  xmax = qp_plot_get_xval(p, xpix_max);
+  if(p->x->series.min > xmax || p->x->series.max < xmin)
+    return -1;
+
+  i = qp_channel_series_find_lt(p->x, &xmin);
+  j = qp_channel_series_find_gt(p->x, &xmax);
+
+  /* values per pixel column */
+  n = (j - i)/(xpix_max - xpix_min);
+  if(n < 2*QP_PYRAMID_LENGTH)
+    return -1;
+
+  if(p->y->series.has_nan || p->x->series.has_nan)
+  {
+    /* The pyramid does not keep the gaps, so we can only use it
+     * if there are no gaps in view. */
+    struct qp_channel_chunk r;
+    qp_channel_series_range(p->y, i, j, &r);
+    if(r.num_nan)
+      return -1;
+    qp_channel_series_range(p->x, i, j, &r);
+    if(r.num_nan)
+      return -1;
+  }
+
+  *py = qp_channel_pyramid_get(p->y);
+  if(!*py ||
+      n < 2*qp_channel_pyramid_bucket_length((*py)->first_level))
+    return -1;
+
+  /* We want at least two buckets per pixel column so that
+   * buckets that cross into the next column are a small
+   * part of the column. */
+  for(level = (*py)->first_level; level < (*py)->num_levels - 1 &&
+      2*qp_channel_pyramid_bucket_length(level + 1) <= n; ++level);
+
+  *bucket = i/qp_channel_pyramid_bucket_length(level);
+  *end = j/qp_channel_pyramid_bucket_length(level);
+  return level;
+}
+
+/* returns value i of channel c with the index reader, but for the
+ * first and last values of the arrays of lazy channels, which the
+ * channel keeps, so we read no arrays for buckets that are whole
+ * arrays or more. */
+static inline
+double summary_value(struct qp_channel *c,
+    double (*index)(struct qp_channel *c, size_t i), size_t i)
+{
+  struct qp_channel_arrays *a;
+
+  if(c->form == QP_CHANNEL_FORM_SERIES && (a = c->series.arrays)->lazy)
+  {
+    if(!(i & ARRAY_MASK))
+      return a->lazy_ends[2*(i >> ARRAY_SHIFT)];
+    if((i & ARRAY_MASK) == ARRAY_MASK || i == a->length - 1)
+      return a->lazy_ends[2*(i >> ARRAY_SHIFT) + 1];
+  }
+  return index(c, i);
+}
+
+/* Reads the buckets from *bucket to end that start in the same
+ * pixel column.  We get the pixel positions of the first and last
+ * values and the pixels of the min and max y values.  Returns 0 if
+ * there are no more buckets. */
+static inline
+int summary_next(struct qp_plot *p, struct qp_channel_pyramid *py,
+    int level, size_t *bucket, size_t end,
+    double *x_first, double *y_first, double *x_last, double *y_last,
+    double *y_min, double *y_max)
+{
+  size_t s, i;
+  double min, max;
+  int col;
+
+  if(*bucket > end)
+    return 0;
+
+  s = qp_channel_pyramid_bucket_length(level);
+  i = (*bucket)*s;
+  *x_first = p->xscale*summary_value(p->x, p->channel_series_x_index, i) +
+    p->xshift;
+  *y_first = p->yscale*summary_value(p->y, p->channel_series_y_index, i) +
+    p->yshift;
+  col = INT(*x_first);
+  min = py->min[level][*bucket];
+  max = py->max[level][*bucket];
+
+  for(++(*bucket); *bucket <= end; ++(*bucket))
+  {
+    i = (*bucket)*s;
+    if(INT(p->xscale*summary_value(p->x, p->channel_series_x_index, i) +
+          p->xshift) != col)
+      break;
+    if(py->min[level][*bucket] < min)
+      min = py->min[level][*bucket];
+    if(py->max[level][*bucket] > max)
+      max = py->max[level][*bucket];
+  }
+
+  i = (*bucket)*s - 1;
+  if(i >= py->length)
+    i = py->length - 1;
+  *x_last = p->xscale*summary_value(p->x, p->channel_series_x_index, i) +
+    p->xshift;
+  *y_last = p->yscale*summary_value(p->y, p->channel_series_y_index, i) +
+    p->yshift;
+  *y_min = p->yscale*min + p->yshift;
+  *y_max = p->yscale*max + p->yshift;
+  return 1;
+}
+
+/* Draws the lines of a plot with the summary of each pixel
+ * column: a line to the first value, a line from the min to the
+ * max, and a line to the last value.  That draws the same pixels
+ * as drawing lines to all the values.  Returns 0 if the lines
+ * were not drawn. */
+static inline
+int summary_draw_lines(struct qp_graph *gr, struct qp_plot *p,
+    double minusLineWidthPlus1, double widthPlus, double heightPlus)
+{
+  struct qp_channel_pyramid *py;
+  size_t bucket, end;
+  double prev_x = 0, prev_y = 0, xf, yf, xl, yl, ymin, ymax;
+  int level, new_line = 1, first = 1;
+
+  level = summary_begin(p, INT(minusLineWidthPlus1), INT(widthPlus),
+      &py, &bucket, &end);
+  if(level == -1)
+    return 0;
+
+  while(summary_next(p, py, level, &bucket, end,
+        &xf, &yf, &xl, &yl, &ymin, &ymax))
+  {
+    if(!first)
+      /* the line from the last pixel column */
+      CullDrawLine(gr, &new_line, minusLineWidthPlus1, widthPlus,
+          heightPlus, prev_x, prev_y, xf, yf);
+    first = 0;
+    CullDrawLine(gr, &new_line, minusLineWidthPlus1, widthPlus,
+        heightPlus, xf, yf, xf, ymin);
+    CullDrawLine(gr, &new_line, minusLineWidthPlus1, widthPlus,
+        heightPlus, xf, ymin, xf, ymax);
+    CullDrawLine(gr, &new_line, minusLineWidthPlus1, widthPlus,
+        heightPlus, xf, ymax, xl, yl);
+    prev_x = xl;
+    prev_y = yl;
+  }
+
+  if(!gr->x11)
+    cairo_stroke(gr->cr);
+
+  return 1;
+}
+
+/* Draws the points of a plot with one rectangle per pixel column
+ * that covers the points from the min to the max y value.  With so
+ * many values per pixel column the points between the min and max
+ * run together anyway.  qp_plot_scale() must be called with the
+ * point width offset before this.  Returns 0 if the points were not
+ * drawn. */
+static inline
+int summary_draw_points(struct qp_graph *gr, struct qp_plot *p,
+    cairo_t *cr, double point_w,
+    double point_min, double point_xmax, double point_ymax)
+{
+  struct qp_channel_pyramid *py;
+  size_t bucket, end;
+  double xf, yf, xl, yl, ymin, ymax;
+  int level;
+
+  level = summary_begin(p, INT(point_min), INT(point_xmax),
+      &py, &bucket, &end);
+  if(level == -1)
+    return 0;
+
+  while(summary_next(p, py, level, &bucket, end,
+        &xf, &yf, &xl, &yl, &ymin, &ymax))
+  {
+    double top, bottom;
+    int x, y, h;
+
+    /* the pixel y values may go either way */
+    if(ymin < ymax)
+    {
+      top = ymin;
+      bottom = ymax;
+    }
+    else
+    {
+      top = ymax;
+      bottom = ymin;
+    }
+
+    if(xf <= point_min || xf >= point_xmax ||
+        bottom <= point_min || top >= point_ymax)
+      continue; /* culled */
+
+    if(top < point_min)
+      top = point_min;
+    if(bottom > point_ymax)
+      bottom = point_ymax;
+
+    x = INT(xf);
+    y = INT(top);
+    h = INT(bottom) - y;
+
+    if(gr->x11)
+      XFillRectangle(gr->x11->dsp, gr->x11->pixmap,
+          gr->x11->gc, x, y, INT(point_w), h + INT(point_w));
+    else
+      cairo_rectangle(cr, x, y, point_w, h + point_w);
+  }
+
+  if(!gr->x11)
+    cairo_fill(cr);
+
+  return 1;
+}
+
 /* width, height      give the size of the thing being drawn
  *                    on in pixels
  *
@@ -523,7 +776,13 @@ void graph_draw(struct qp_graph *gr, cairo_t *cr,
         cairo_set_line_width(cr, p->line_width);
       }
 
-      if(qp_plot_begin(p, xscale, xshift, yscale, yshift,
+      /* zoomed out plots are drawn from the summary of the
+       * values in each pixel column */
+      qp_plot_scale(p, xscale, xshift, yscale, yshift);
+
+      if(!summary_draw_lines(gr, p,
+            minusLineWidthPlus1, widthPlus, heightPlus) &&
+          qp_plot_begin(p, xscale, xshift, yscale, yshift,
             INT(minusLineWidthPlus1), INT(minusLineWidthPlus1),
             INT(widthPlus), INT(heightPlus),
             &prev_x, &prev_y))
@@ -584,8 +843,12 @@ void graph_draw(struct qp_graph *gr, cairo_t *cr,
        * the point width offset in the tight loop in the
        * cairo_rectangle() call where we would add it
        * every loop interation. */
-      
-      if(qp_plot_begin(p, xscale, xshift - point_w2,
+      qp_plot_scale(p, xscale, xshift - point_w2,
+          yscale, yshift - point_w2);
+
+      if(!summary_draw_points(gr, p, cr, point_w,
+            point_min, point_xmax, point_ymax) &&
+          qp_plot_begin(p, xscale, xshift - point_w2,
                        yscale, yshift - point_w2,
                        INT(point_min), INT(point_min),
                        INT(point_xmax), INT(point_ymax),
@@ -639,11 +902,112 @@ void graph_draw(struct qp_graph *gr, cairo_t *cr,
      * - point_w2 offset above.  Needed for all plots when
      * using the value picker GUI */
     qp_plot_scale(p, xscale, xshift, yscale, yshift);
+
+    p->drawn_length = plot_length(p);
  
     p = (struct qp_plot *) qp_sllist_next(gr->plots);
   }
 }
 
+int qp_graph_draw_tail(struct qp_graph *gr)
+{
+  struct qp_plot *p;
+  cairo_t *cr;
+  int width, height;
+
+  /* We only keep drawing with cairo onto a back buffer
+   * that is all drawn. */
+  if(gr->x11 || gr->qp->shape || gr->pixbuf_needs_draw ||
+      gr->waiting_to_resize_draw || !gr->pixbuf_surface)
+    return 0;
+
+  width = gr->pixbuf_width;
+  height = gr->pixbuf_height;
+  cr = cairo_create(gr->pixbuf_surface);
+  cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+  cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+  cairo_set_antialias(cr, CAIRO_ANTIALIAS_DEFAULT);
+  gr->DrawLine = cairo_DrawLine;
+  gr->cr = cr;
+
+  /* The plots still have the scales from graph_draw() */
+  for(p = (struct qp_plot *) qp_sllist_begin(gr->plots); p;
+      p = (struct qp_plot *) qp_sllist_next(gr->plots))
+  {
+    size_t i, len;
+
+    len = plot_length(p);
+    if(len <= p->drawn_length)
+      continue;
+
+    if(p->lines)
+    {
+      double minusLineWidthPlus1, widthPlus, heightPlus;
+      double prev_x, prev_y, x_val, y_val;
+      int new_line = 1;
+
+      minusLineWidthPlus1 = - p->line_width - 1;
+      widthPlus = width + p->line_width;
+      heightPlus = height + p->line_width;
+      cairo_set_source_rgba(cr, p->l.c.r, p->l.c.g, p->l.c.b, p->l.c.a);
+      cairo_set_line_width(cr, p->line_width);
+
+      /* start at the last point that was drawn */
+      i = (p->drawn_length)?(p->drawn_length - 1):0;
+      prev_x = p->xscale*p->channel_series_x_index(p->x, i) + p->xshift;
+      prev_y = p->yscale*p->channel_series_y_index(p->y, i) + p->yshift;
+
+      for(++i; i<len; ++i)
+      {
+        x_val = p->xscale*p->channel_series_x_index(p->x, i) + p->xshift;
+        y_val = p->yscale*p->channel_series_y_index(p->y, i) + p->yshift;
+        CullDrawLine(gr, &new_line,
+            minusLineWidthPlus1, widthPlus, heightPlus,
+            prev_x, prev_y, x_val, y_val);
+        if(p->gaps || (is_good_double(x_val) && is_good_double(y_val)))
+        {
+          prev_x = x_val;
+          prev_y = y_val;
+        }
+        if(!p->gaps && new_line)
+          new_line = 0;
+      }
+      cairo_stroke(cr);
+    }
+
+    if(p->points)
+    {
+      double point_w, point_w2, point_min, point_xmax, point_ymax;
+      point_w2 = (point_w = p->point_size)/2;
+      point_min = - point_w2 - 2;
+      point_xmax = width + point_w2 + 1;
+      point_ymax = height + point_w2 + 1;
+
+      cairo_set_source_rgba(cr, p->p.c.r, p->p.c.g, p->p.c.b, p->p.c.a);
+
+      for(i = p->drawn_length; i<len; ++i)
+      {
+        double x_val, y_val;
+        x_val = p->xscale*p->channel_series_x_index(p->x, i) +
+          p->xshift - point_w2;
+        y_val = p->yscale*p->channel_series_y_index(p->y, i) +
+          p->yshift - point_w2;
+        if(is_good_double(x_val) && is_good_double(y_val) &&
+            point_min < x_val && point_min < y_val &&
+            x_val < point_xmax && y_val < point_ymax)
+          cairo_rectangle(cr, INT(x_val), INT(y_val), point_w, point_w);
+      }
+      cairo_fill(cr);
+    }
+
+    p->drawn_length = len;
+  }
+
+  cairo_destroy(cr);
+  gtk_widget_queue_draw(gr->drawing_area);
+  return 1;
+}
+
 static inline
 void draw_from_pixbuf(cairo_t *cr, struct qp_graph *gr,
     int gr_pixel_width, int gr_pixel_height)
@@ -32,6 +32,8 @@
 #include "callbacks.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "qp.h"
 #include "plot.h"
 
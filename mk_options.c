@@ -108,17 +108,69 @@ struct qp_option options[] =
                                                   "a dark green.",                                            0,          "struct "
                                                                                                                           "qp_colora" },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--binary",             0,    "LAYOUT",  "read the files after this option as raw binary values "
+                                                  "with no header.  ::LAYOUT@@ is a comma separated list of "
+                                                  "the types of the values in each row, from i8, u8, i16, "
+                                                  "u16, i32, u32, i64, u64, f32 and f64, like "
+                                                  "::--binary=f64,f64,i16@@.  A type may start with > for "
+                                                  "big endian or < for little endian, or big or little in "
+                                                  "the list sets it for the types after it.  The default is "
+                                                  "the byte order of this computer.  xN in the list skips N "
+                                                  "bytes of padding, and planar in the list reads all the "
+                                                  "values of each channel together, one channel after the "
+                                                  "other.  Channels of i16, i32, f32 or f64 values that are "
+                                                  "next to each other in the byte order of this computer "
+                                                  "are read from the file in place with no copy if no one "
+                                                  "may write to the file, since a file that is cut short "
+                                                  "while it is read in place would crash quickplot.  The "
+                                                  "smallest i16 and i32 values read as gaps.  NumPy .npy "
+                                                  "files are read like this without this option.  Set "
+                                                  "::LAYOUT@@ to NONE to read text files again.",             "NULL",     "char *"    },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--border",             "-b", 0,         "add a border to main window.  This is the default.  See "
                                                   "also ::--no-border@@.",                                    "TRUE",     "gboolean"  },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--buttons",            0,    0,         "show the button bar in the main window.  This is the "
                                                   "default.  See also ::--no-buttons@@.",                     "1",        "int"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--cache",              0,    0,         "keep a snapshot of the values read from the text files "
+                                                  "after this option in the directory "
+                                                  "::$XDG_CACHE_HOME/quickplot@@, or "
+                                                  "::~/.cache/quickplot@@, so that opening the same file "
+                                                  "again maps the snapshot and does not parse the file.  "
+                                                  "The snapshot is used if the file has the same size and "
+                                                  "modification time and is read with the same "
+                                                  "::--skip-lines@@, ::--labels@@ and "
+                                                  "::--label-separator@@.  Files smaller than 1 MB are not "
+                                                  "cached.  See also ::--no-cache@@.",                        "0",        "int"       },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--cairo-draw",         "-c", 0,         "draw graphs using the Cairo API.  Cairo drawing may be "
                                                   "slower, but you get translucent colors and "
                                                   "anti-aliasing in all aspects of the graph and in saved "
                                                   "image files.  See also ::--x11-draw@@.",                   0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--columns",            0,    "LIST",    "read only the columns ::LIST@@ of the text files after "
+                                                  "this option.  ::LIST@@ is a comma separated list of column "
+                                                  "numbers, starting at 0, ranges of them like ::4-9@@, and "
+                                                  "labels that are read with ::--labels@@, like "
+                                                  "::--columns \"0,time,12-14\"@@.  The channels are in the "
+                                                  "order of the columns in the file.  The other columns are "
+                                                  "skipped over and not stored, which is much faster and "
+                                                  "uses much less memory for files with many columns.  Set "
+                                                  "::LIST@@ to all to read all the columns.  The default, "
+                                                  "auto, reads all the columns unless ::--graph-file@@ "
+                                                  "options after the file name its channels, then only the "
+                                                  "columns that are plotted are read, and the "
+                                                  "::--graph-file@@ channel numbers are the numbers the "
+                                                  "channels would have if all the columns were read.",        "NULL",     "char *"    },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--compress-channels",  0,    0,         "compress the values read from the files after this "
+                                                  "option as they are read.  Time stamps, slowly changing "
+                                                  "values and runs of the same value can take many times "
+                                                  "less memory.  The values are uncompressed as they are "
+                                                  "read so drawing may be a little slower.  See also "
+                                                  "::--no-compress-channels@@.",                              "0",        "int"       },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--default-graph",      "-D", 0,         "create the default graph for the current file and turn "
                                                   "default graphing for future files read.  "
                                                   "If you give a ::--graph@@ or ::--graph-file@@ "
@@ -133,9 +185,14 @@ struct qp_option options[] =
                                                   "the same.  See also ::--same-scale@@, ::--same-x-scale@@ "
                                                   "and ::--same-y-scale@@.",                                  0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
-{ {0,1}, "--file",               "-f", "FILE",    "read data from file FILE.  If FILE is - (dash) then "
+{ {1,1}, "--file",               "-f", "FILE",    "read data from file FILE.  If FILE is - (dash) then "
                                                   "standard input will be read.  See also ::--pipe@@.",       0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {1,1}, "--follow",             0,    "FILE",    "read data from file FILE like ::--file@@ and keep "
+                                                  "reading the lines that are appended to it, like tail -f.  "
+                                                  "The graphs are redrawn with the new values at most "
+                                                  "::--redraw-rate@@ times a second.",                        0,          0           },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--fullscreen",         "-F", 0,         "make the main window fullscreen.  See also "
                                                   "::--no-fullscreen@@ and ::--maximize@@.",                  0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
@@ -151,7 +208,7 @@ struct qp_option options[] =
                                                                                                                           "tangle_in"
                                                                                                                           "t_t"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
-{ {0,1}, "--graph",              "-g", "LIST",    "make a graph with plots ::LIST@@.  "
+{ {1,1}, "--graph",              "-g", "LIST",    "make a graph with plots ::LIST@@.  "
                                                   "The ::LIST@@ is of the form ::\"x0 y0 x1 y1 x2 "
                                                   "y2 ...\"@@.  For example: ::--graph \"0 1 3 4\"@@ will "
                                                   "make two plots in a graph.  It will plot channel 1 vs "
@@ -163,7 +220,7 @@ struct qp_option options[] =
                                                   "the file loading options that load the channels that it "
                                                   "lists to plot.  See also ::--graph-file@@.",               0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
-{ {0,1}, "--graph-file",         "-G", "LIST",    "make a graph with plots ::LIST@@.  "
+{ {1,1}, "--graph-file",         "-G", "LIST",    "make a graph with plots ::LIST@@.  "
                                                   "The ::LIST@@ is of the form ::\"x0 y0 x1 y1 x2 "
                                                   "y2 ...\"@@.  Example: ::--graph-file \"0 1 3 4\"@@ will "
                                                   "make two plots in a graph.  It will plot channel 1 vs "
@@ -233,6 +290,18 @@ struct qp_option options[] =
                                                   "is not skipped.  See also: ::--skip-lines@@, "
                                                   "::--label-separator@@ and ::--no-labels@@.",               "0",        "int"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--lazy",               0,    0,         "keep the values of the text files read after this "
+                                                  "option in the file and not in memory.  The file is "
+                                                  "parsed once to find where each part of it starts, and "
+                                                  "its parts are parsed again as they are drawn, so text "
+                                                  "files much larger than memory can be plotted and "
+                                                  "zooming in reads just the part in view.  This is not "
+                                                  "done for pipes, compressed files, and with "
+                                                  "::--where@@, ::--x-range@@, ::--cache@@ or when "
+                                                  "following a file.  If the file is cut shorter while it "
+                                                  "is plotted, the parts that are not parsed yet read as "
+                                                  "gaps.  See also ::--no-lazy@@.",                           "0",        "int"       },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {2,0}, "--libsndfile-version", 0,    0,         "print the version of libsndfile that Quickplot was "
                                                   "built with and then exit",                                 0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
@@ -270,6 +339,15 @@ struct qp_option options[] =
 { {1,0}, "--local-menubars",     0,    0,         "disable that darn Ubuntu Unity globel menu bar.  This "
                                                   "will do nothing if not running with Unity.",               0,          0           },                                      
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--max-memory",         0,    "BYTES",   "keep at most about ::BYTES@@ of the values read from "
+                                                  "files in memory.  ::BYTES@@ may end in K, M or G, like "
+                                                  "::--max-memory=12G@@.  Values past that are kept in "
+                                                  "temporary files in ::TMPDIR@@ (or the XDG cache "
+                                                  "directory or /var/tmp, and not on tmpfs) that the system "
+                                                  "reads in as they are drawn, so files larger than memory "
+                                                  "can be plotted without swapping.  ::BYTES@@ of 0 is no "
+                                                  "limit.  This is the default.",                             "0",        "size_t"    },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--maximize",           "-m", 0,         "maximize the main window.  See also ::--no-maximize@@ "
                                                   "and ::--fullscreen@@.",                                    "0",        "int"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
@@ -284,6 +362,14 @@ struct qp_option options[] =
 { {0,1}, "--no-buttons",         0,    0,         "hide the button bar in the main window.  See also "
                                                   "::--buttons@@.",                                           0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--no-cache",           0,    0,         "don't use or keep snapshots of the files read after "
+                                                  "this option.  This is the default.  See also "
+                                                  "::--cache@@.",                                             0,          0           },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--no-compress-channels", 0,  0,         "don't compress the values read from the files after "
+                                                  "this option.  This is the default.  See also "
+                                                  "::--compress-channels@@.",                                 0,          0           },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--no-default-graph",   "-U", 0,         "stop making the default graph for each file loaded.  See "
                                                   "also ::--default-graph@@.",                                0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
@@ -306,6 +392,10 @@ struct qp_option options[] =
 { {0,1}, "--no-labels",          "-Q", 0,         "don't read channel labels from the file.  This is "
                                                   "the default.  See also ::--labels@@.",                     0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--no-lazy",            0,    0,         "keep the values of the files read after this option "
+                                                  "in memory.  This is the default.  See also "
+                                                  "::--lazy@@.",                                              0,          0           },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--no-linear-channel",  "-k", 0,         "turn off adding a linear channel for up coming files.  "
                                                   "See also ::--linear-channel@@.",                           0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
@@ -381,6 +471,13 @@ struct qp_option options[] =
                                                   "whether to read standard input or not.  See options "
                                                   "::--file@@, ::--pipe@@ and ::--no-pipe@@.",                "0",        "int"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--redraw-rate",        0,    "HZ",      "draw the graphs at most ::HZ@@ times a second as values "
+                                                  "are read from standard input or a pipe.  The graphs "
+                                                  "show up after the first line of values and grow as "
+                                                  "more values come in.  ::HZ@@ of 0 reads to the end "
+                                                  "of the pipe before making the graphs.  The default is "
+                                                  "10.",                                                      "10",       "int"       },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--same-scale",         "-s", 0,         "plot all plots in the same graph scale.  See also "
                                                   "::--different-scale@@, ::--same-x-scale@@ and "
                                                   "::--same-y-scale@@.",                                      0,          0           },
@@ -446,11 +543,47 @@ struct qp_option options[] =
 { {0,1}, "--tabs",               0,    0,         "show the graph tabs.  This is the default.  See also "
                                                   "::--no-tabs@@.",                                           "1",        "int"       },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--value-type",         0,    "TYPE",    "store the values read from the files after this option "
+                                                  "as ::TYPE@@.  ::TYPE@@ may be ::auto@@, ::short@@, "
+                                                  "::int@@, ::float@@ or ::double@@.  With ::auto@@ each "
+                                                  "channel is stored in the smallest type that holds all its "
+                                                  "values without loss, where short and int can hold numbers "
+                                                  "with a few decimal digits like 12.25.  This can use a lot "
+                                                  "less memory for large files.  The other types may round "
+                                                  "the values.  Sound files with 16 bit or smaller samples "
+                                                  "are stored as short with ::auto@@ or ::short@@, or as int "
+                                                  "if a channel has a -32768 sample, and their time channel "
+                                                  "is computed from the sample rate and uses no memory.  "
+                                                  "::auto@@ is the default.",                                 "QP_TYPE_UNKNOWN",
+                                                                                                                          "int"       },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {1,0}, "--verbose",            "-v", 0,         "spew more to standard output.  See also ::--silent@@.",    0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
 { {2,0}, "--version",            "-V", 0,         "print the Quickplot version number and then exit "
                                                   "returning 0 exit status",                                  0,          0           },
 /*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--where",              0,    "EXPR",    "keep only the lines of values in the text files after "
+                                                  "this option that make the expression ::EXPR@@ true, like "
+                                                  "::--where \"c2 > 0 && c5 < 1e3\"@@.  ::cN@@ is the value "
+                                                  "in column ::N@@ of the file, starting at 0.  ::EXPR@@ may "
+                                                  "have numbers, ::+ - * /@@, ::< <= > >= == !=@@, ::&& || "
+                                                  "!@@ and parentheses, like in C.  A blank value makes a "
+                                                  "comparison false.  The lines that are not kept are never "
+                                                  "stored.  The columns that ::EXPR@@ uses are read even if "
+                                                  "::--columns@@ does not list them.  Set ::EXPR@@ to none to "
+                                                  "keep all the lines, which is the default.",                "NULL",     "char *"    },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
+{ {0,1}, "--x-range",            0,    "MIN:MAX", "keep only the lines of values in the text files after "
+                                                  "this option with the value in the first column, column 0, "
+                                                  "from ::MIN@@ to ::MAX@@, like ::--x-range 1000:2000@@.  "
+                                                  "::MIN@@ or ::MAX@@ may be left out, like ::--x-range "
+                                                  "1000:@@.  The other lines are never stored.  If the first "
+                                                  "column does not decrease up to a value past ::MAX@@ the "
+                                                  "rest of the file is not read, so looking at a short time "
+                                                  "in a long log file is fast and uses little memory.  This "
+                                                  "may be used with ::--where@@.  Set ::MIN:MAX@@ to none to "
+                                                  "keep all the lines, which is the default.",                "NULL",     "char *"    },
+/*------------------------------------------------------------------------------------------------------------------------------------*/
 { {0,1}, "--x11-draw",           "-q", 0,         "draw points and lines using the X11 API.  This is the "
                                                   "default.  Drawing may be much faster than with Cairo, "
                                                   "but there will be no translucent colors and no "
@@ -554,6 +687,15 @@ void print_arg_parsing_code(int p)
       "\n"
   );
 
+  if(p == 1)
+    printf(
+      "     if(argv[i][0] == '-' && argv[i][1])\n"
+      "       /* The files that are loading read the options\n"
+      "        * that this may change. */\n"
+      "       wait_for_loads();\n"
+      "\n"
+    );
+
 
 
   for(i=1;i<length;++i)
@@ -9,6 +9,7 @@ void parse_1st_File(const char *file)
     if(app->op_pipe != 0)
       app->op_pipe = 1;
   }
+  plots_add_file(file);
 }
 
 static inline
@@ -109,6 +110,31 @@ void parse_1st_background_color(char *arg, int argc, char **argv, int *i)
   check_color_opt("--background-color", arg);
 }
 
+static inline
+void parse_1st_file(char *arg, int argc, char **argv, int *i)
+{
+  plots_add_file(arg);
+}
+
+static inline
+void parse_1st_follow(char *arg, int argc, char **argv, int *i)
+{
+  plots_add_file(arg);
+}
+
+static inline
+void parse_1st_graph(char *arg, int argc, char **argv, int *i)
+{
+  /* The channel numbers count the channels of all the files. */
+  plots.all_files = 1;
+}
+
+static inline
+void parse_1st_graph_file(char *arg, int argc, char **argv, int *i)
+{
+  plots_add_graph_file(arg);
+}
+
 static inline
 void parse_1st_grid_line_color(char *arg, int argc, char **argv, int *i)
 {
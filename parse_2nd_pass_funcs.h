@@ -12,7 +12,7 @@ void parse_2nd_File(const char *filename)
   /* by default pipe is read before the
    * first non-pipe file. */
   check_load_stdin(0);
-  load_file(filename);
+  load_file(filename, 0);
 }
 
 static inline
@@ -39,6 +39,12 @@ void parse_2nd_buttons(void)
   app->op_buttons = 1;
 }
 
+static inline
+void parse_2nd_cache(void)
+{
+  app->op_cache = 1;
+}
+
 static inline
 void parse_2nd_cairo_draw(void)
 {
@@ -47,6 +53,18 @@ void parse_2nd_cairo_draw(void)
     default_qp->x11_draw = 0;
 }
 
+static inline
+void parse_2nd_compress_channels(void)
+{
+  app->op_compress_channels = 1;
+}
+
+static inline
+void parse_2nd_lazy(void)
+{
+  app->op_lazy = 1;
+}
+
 static inline
 void parse_2nd_default_graph(void)
 {
@@ -147,6 +165,24 @@ void parse_2nd_no_buttons(void)
   app->op_buttons = 0;
 }
 
+static inline
+void parse_2nd_no_cache(void)
+{
+  app->op_cache = 0;
+}
+
+static inline
+void parse_2nd_no_compress_channels(void)
+{
+  app->op_compress_channels = 0;
+}
+
+static inline
+void parse_2nd_no_lazy(void)
+{
+  app->op_lazy = 0;
+}
+
 static inline
 void parse_2nd_no_default_graph(void)
 {
@@ -337,12 +373,50 @@ void parse_2nd_background_color(char *arg, int argc, char **argv, int *i)
         sizeof(default_qp->background_color));
 }
 
+static inline
+void parse_2nd_binary(char *arg, int argc, char **argv, int *i)
+{
+  if(app->op_binary)
+  {
+    free(app->op_binary);
+    app->op_binary = NULL;
+  }
+  if(!strcasecmp(arg, "none"))
+    return;
+  if(qp_binary_layout_check(arg))
+  {
+    QP_ERROR("bad option: --binary='%s'\n", arg);
+    exit(1);
+  }
+  app->op_binary = qp_strdup(arg);
+}
+
+static inline
+void parse_2nd_columns(char *arg, int argc, char **argv, int *i)
+{
+  if(app->op_columns)
+  {
+    free(app->op_columns);
+    app->op_columns = NULL;
+  }
+  if(!strcasecmp(arg, "auto"))
+    return;
+  app->op_columns = qp_strdup(arg);
+}
+
 static inline
 void parse_2nd_file(char *arg, int argc, char **argv, int *i)
 {
   parse_2nd_File(arg);
 }
 
+static inline
+void parse_2nd_follow(char *arg, int argc, char **argv, int *i)
+{
+  check_load_stdin(0);
+  load_file(arg, 1);
+}
+
 static inline
 void parse_2nd_geometry(char *arg, int argc, char **argv, int *j)
 {
@@ -396,10 +470,38 @@ void parse_2nd_graph(char *arg, int argc, char **argv, int *i)
   graph_plots(x, y, len);
 }
 
+/* Returns the channel of the source s, that load_file() read only
+ * the plotted columns of, that has the number n that it would have
+ * if all the columns were read, or -1 if that column was not read. */
+static inline
+ssize_t projected_channel(struct qp_source *s, ssize_t n)
+{
+  size_t num_select, k, linear, file_linear;
+
+  ASSERT(s->select);
+
+  for(num_select=0; s->select[num_select] != QP_SELECT_END; ++num_select);
+  /* 1 if a linear channel was prepended */
+  linear = s->num_channels - num_select;
+  file_linear = parser->p2.projected_linear;
+  if(linear && !file_linear && s->select[0] == 0 &&
+      num_select < parser->p2.projected_columns)
+    /* The lines only had the first column, so all the columns
+     * would have had the linear channel too. */
+    file_linear = 1;
+
+  if(n < file_linear)
+    return (linear)?0:-1;
+  for(k=0; k<num_select; ++k)
+    if(s->select[k] == n - file_linear)
+      return k + linear;
+  return -1;
+}
+
 static inline
 void parse_2nd_graph_file(char *arg, int argc, char **argv, int *i)
 {
-  ssize_t  *x = NULL, *y = NULL, offset = 0, j;
+  ssize_t  *x = NULL, *y = NULL, offset = 0, j, max_channel_num;
   size_t len = 0;
   struct qp_source *s, *last_s;
 
@@ -415,8 +517,12 @@ void parse_2nd_graph_file(char *arg, int argc, char **argv, int *i)
     offset += s->num_channels;
 
   check_load_stdin(0);
+  max_channel_num = last_s->num_channels - 1;
+  if(last_s == parser->p2.projected)
+    /* the numbers are of all the columns in the file */
+    max_channel_num = INT_MAX - 1;
   get_plot_option(arg, &x, &y, &len, "--graph-file",
-      -offset, last_s->num_channels - 1);
+      -offset, max_channel_num);
 
   if(!len)
   {
@@ -426,9 +532,23 @@ void parse_2nd_graph_file(char *arg, int argc, char **argv, int *i)
 
   for(j=0;j<len;++j)
   {
+    if(last_s == parser->p2.projected)
+    {
+      if(x[j] >= 0 && (x[j] = projected_channel(last_s, x[j])) == -1)
+        break;
+      if(y[j] >= 0 && (y[j] = projected_channel(last_s, y[j])) == -1)
+        break;
+    }
     x[j] += offset;
     y[j] += offset;
   }
+
+  if(j < len)
+  {
+    QP_ERROR("bad option --graph-file=\"%s\": file %s has no "
+        "such column\n", arg, last_s->name);
+    exit(1);
+  }
   
   graph_plots(x, y, len);
 }
@@ -537,6 +657,20 @@ void parse_2nd_lines(char *arg, int argc, char **argv, int *i)
     default_qp->lines = app->op_lines;
 }
 
+static inline
+void parse_2nd_max_memory(char *arg, int argc, char **argv, int *i)
+{
+  size_t bytes;
+  bytes = qp_arena_parse_size(arg);
+  if(bytes == (size_t) -1)
+  {
+    QP_ERROR("bad option: --max-memory='%s'\n", arg);
+    exit(1);
+  }
+  app->op_max_memory = bytes;
+  qp_arena_set_max_memory(bytes);
+}
+
 static inline
 void parse_2nd_number_of_plots(char *arg, int argc, char **argv, int *i)
 {
@@ -555,6 +689,12 @@ void parse_2nd_point_size(char *arg, int argc, char **argv, int *i)
     default_qp->point_size = app->op_point_size;
 }
 
+static inline
+void parse_2nd_redraw_rate(char *arg, int argc, char **argv, int *i)
+{
+  app->op_redraw_rate = get_long(arg, 0, 1000, "--redraw-rate");
+}
+
 static inline
 void parse_2nd_same_x_scale(char *arg, int argc, char **argv, int *i)
 {
@@ -584,3 +724,58 @@ void parse_2nd_skip_lines(char *arg, int argc, char **argv, int *i)
   app->op_skip_lines = get_long(arg, 0, INT_MAX - 10, "--skip-lines");
 }
 
+
+static inline
+void parse_2nd_value_type(char *arg, int argc, char **argv, int *i)
+{
+  int value_type;
+  value_type = qp_channel_value_type_from_name(arg);
+  if(value_type == -1)
+  {
+    QP_ERROR("bad option: --value-type='%s'\n", arg);
+    exit(1);
+  }
+  app->op_value_type = value_type;
+}
+
+static inline
+void parse_2nd_where(char *arg, int argc, char **argv, int *i)
+{
+  struct qp_filter *f;
+
+  if(app->op_where)
+  {
+    free(app->op_where);
+    app->op_where = NULL;
+  }
+  if(!strcasecmp(arg, "none"))
+    return;
+  if(!(f = qp_filter_create(arg, NULL)))
+  {
+    QP_ERROR("bad option: --where='%s'\n", arg);
+    exit(1);
+  }
+  qp_filter_destroy(f);
+  app->op_where = qp_strdup(arg);
+}
+
+static inline
+void parse_2nd_x_range(char *arg, int argc, char **argv, int *i)
+{
+  struct qp_filter *f;
+
+  if(app->op_x_range)
+  {
+    free(app->op_x_range);
+    app->op_x_range = NULL;
+  }
+  if(!strcasecmp(arg, "none"))
+    return;
+  if(!(f = qp_filter_create(NULL, arg)))
+  {
+    QP_ERROR("bad option: --x-range='%s'\n", arg);
+    exit(1);
+  }
+  qp_filter_destroy(f);
+  app->op_x_range = qp_strdup(arg);
+}
@@ -152,26 +152,207 @@ int check_stdin(void)
   return 0;
 }
 
+/* Called in the 1st pass for each file that the 2nd pass loads,
+ * other than stdin, which we do not read only some columns of. */
+static inline
+void plots_add_file(const char *filename)
+{
+  if(!strcmp(filename, "-"))
+    return;
+  plots.file = (struct file_plots *) qp_realloc(plots.file,
+      sizeof(*plots.file)*(plots.num_files+1));
+  memset(&plots.file[plots.num_files], 0, sizeof(*plots.file));
+  ++plots.num_files;
+}
+
+/* Called in the 1st pass for --graph-file LIST to add the channels
+ * that it plots to the last file. */
+static inline
+void plots_add_graph_file(const char *list)
+{
+  struct file_plots *f;
+  char *s, *end;
+
+  if(!plots.num_files)
+    return;
+  f = &plots.file[plots.num_files-1];
+
+  s = (char *) list;
+  while(*s)
+  {
+    long n;
+    n = get_plot_num(s, &end);
+    if(n == INT_MAX)
+    {
+      f->bad = 1;
+      return;
+    }
+    s = end;
+    if(n < 0)
+    {
+      /* It plots channels of the files before, so they
+       * must have all their channels. */
+      plots.all_files = 1;
+      continue;
+    }
+    f->chan = (ssize_t *) qp_realloc(f->chan,
+        sizeof(ssize_t)*(f->num_chan+1));
+    f->chan[f->num_chan++] = n;
+  }
+}
+
+static
+int compare_ssize(const void *a, const void *b)
+{
+  ssize_t x, y;
+  x = *((const ssize_t *) a);
+  y = *((const ssize_t *) b);
+  return (x < y)?-1:((x > y)?1:0);
+}
+
+/* Returns a --columns LIST, that is malloc()ed, of the columns that
+ * the --graph-file options after the file that the 2nd pass loads
+ * now plot, or NULL to read all the columns. */
+static
+char *get_projection(void)
+{
+  struct file_plots *f;
+  ssize_t *col;
+  size_t j, num = 0, len = 0;
+  char *list;
+  int linear;
+
+  if(app->op_columns || app->op_pipe || plots.all_files ||
+      parser->p2.num_files > plots.num_files)
+    return NULL;
+  f = &plots.file[parser->p2.num_files-1];
+  if(f->bad || !f->num_chan)
+    return NULL;
+
+  /* With --linear-channel channel 0 is not a column. */
+  linear = (app->op_linear_channel)?1:0;
+  col = (ssize_t *) qp_malloc(sizeof(ssize_t)*f->num_chan);
+  for(j=0; j<f->num_chan; ++j)
+    if(f->chan[j] >= linear)
+      col[num++] = f->chan[j] - linear;
+  if(!num)
+  {
+    free(col);
+    return NULL;
+  }
+  qsort(col, num, sizeof(ssize_t), compare_ssize);
+
+  list = (char *) qp_malloc(num*24);
+  list[0] = '\0';
+  parser->p2.projected_columns = 0;
+  for(j=0; j<num; ++j)
+    if(!j || col[j] != col[j-1])
+    {
+      len += sprintf(list + len, "%s%zd", (len)?",":"", col[j]);
+      ++parser->p2.projected_columns;
+    }
+  free(col);
+  parser->p2.projected_linear = linear;
+  return list;
+}
+
+/* Finishes loading the files that are loading in threads, so the
+ * last file loaded is the last of app->sources. */
+static inline
+void wait_for_loads(void)
+{
+  qp_source_load_wait(NULL);
+  parser->p2.loading = NULL;
+}
+
+/* called by qp_source_load() after a file is loaded */
 static
-void load_file(const char *filename)
+void file_loaded(qp_source_t source, void *data)
 {
+  struct file_load *fl;
+  fl = data;
+
+  if(!source)
+     exit(1);
+
+  if(fl->graph && qp_win_graph_default_source(NULL, source, NULL))
+    exit(1);
+
+  free(fl);
+}
+
+static
+void load_file(const char *filename, int follow)
+{
+  struct qp_source *source;
+  char *projection = NULL;
+
   if(parser->p2.needs_graph && app->op_default_graph)
   {
-    ASSERT(qp_sllist_last(app->sources));
+    if(parser->p2.loading)
+      /* We make it when it is loaded. */
+      parser->p2.loading->graph = 1;
+    else
+    {
+      ASSERT(qp_sllist_last(app->sources));
 
-    if(qp_win_graph_default_source(NULL, (qp_source_t)
-          qp_sllist_last(app->sources), NULL))
-      exit(1);
+      if(qp_win_graph_default_source(NULL, (qp_source_t)
+            qp_sllist_last(app->sources), NULL))
+        exit(1);
+    }
 
     parser->p2.needs_graph = NULL;
   }
+  parser->p2.loading = NULL;
 
   if(!strcmp(filename, "-") &&
       (parser->p2.got_stdin || !app->op_pipe))
     return;   
         
 
-  if(!qp_source_create(filename, QP_TYPE_UNKNOWN))
+  parser->p2.projected = NULL;
+  if(strcmp(filename, "-"))
+  {
+    ++parser->p2.num_files;
+    if((projection = get_projection()))
+    {
+      DEBUG("reading only columns %s of %s for --graph-file\n",
+          projection, filename);
+      app->op_columns = projection;
+    }
+  }
+
+  if(!projection && !follow)
+  {
+    /* The files load at the same time, each in a thread. */
+    struct file_load *fl;
+    fl = qp_malloc(sizeof(*fl));
+    fl->graph = 0;
+    parser->p2.loading = fl;
+    if(!qp_source_load(filename, QP_TYPE_UNKNOWN, NULL, file_loaded, fl))
+      /* It is loaded and fl is freed. */
+      parser->p2.loading = NULL;
+    parser->p2.needs_graph = (char *) filename;
+    if(!strcmp(filename, "-"))
+      parser->p2.got_stdin = 1;
+    return;
+  }
+
+  /* so that the sources are in the order of the files */
+  wait_for_loads();
+
+  source = (follow)?qp_source_create_follow(filename, QP_TYPE_UNKNOWN):
+        qp_source_create(filename, QP_TYPE_UNKNOWN);
+
+  if(projection)
+  {
+    app->op_columns = NULL;
+    free(projection);
+    if(source && source->select)
+      parser->p2.projected = source;
+  }
+
+  if(!source)
      exit(1);
 
   parser->p2.needs_graph = (char *) filename;
@@ -193,7 +374,7 @@ void check_load_stdin(int here)
      * may catch any file reading options 
      * that may effect the reading of the pipe,
      * that may be in arguments before those. */
-    load_file("-");
+    load_file("-", 0);
   }
 }
 
@@ -45,6 +45,7 @@
 #include "callbacks.h"
 #include "get_opt.h"
 #include "channel.h"
+#include "arena.h"
 #include "shell.h"
 #include "utils.h"
 
@@ -53,6 +54,12 @@
 #endif
 
 
+/* a file from the command line that is loading in a thread */
+struct file_load
+{
+  int graph; /* make the default graph when it is loaded */
+};
+
 union qp_parser
 {
   struct
@@ -65,11 +72,42 @@ union qp_parser
   {
     /* needs_graph = last file loaded and not plotted yet */
     char *needs_graph;
+    /* the last file if it is still loading in a thread */
+    struct file_load *loading;
     int got_stdin;
+    /* number of files loaded, not counting stdin */
+    size_t num_files;
+    /* The last file loaded if we read only the columns that
+     * --graph-file plots, with the --linear-channel setting and
+     * number of columns that it was read with. */
+    struct qp_source *projected;
+    int projected_linear;
+    size_t projected_columns;
   } p2;
 };
 
 
+/* The channels that the --graph-file options after each file plot,
+ * from the 1st pass, so that the 2nd pass can read only the columns
+ * that are plotted.  See plots_add_graph_file(). */
+struct file_plots
+{
+  ssize_t *chan;
+  size_t num_chan;
+  int bad; /* we could not read the list */
+};
+
+static
+struct
+{
+  struct file_plots *file;
+  size_t num_files;
+  /* set if the channel numbers may refer to the channels of
+   * more than one file, like with --graph */
+  int all_files;
+} plots = { NULL, 0, 0 };
+
+
 /* This is the one globel pointer used to do
  * argument parsing.
  * We allocate it and then free it when we are done
@@ -137,7 +175,12 @@ void qp_getargs_2nd_pass(int argc, char **argv)
 
   /* reinitialize parser */
   parser->p2.needs_graph = NULL;
+  parser->p2.loading = NULL;
   parser->p2.got_stdin = 0;
+  parser->p2.num_files = 0;
+  parser->p2.projected = NULL;
+  parser->p2.projected_linear = 0;
+  parser->p2.projected_columns = 0;
 
 
   /* This is the an auto-generated function */
@@ -146,17 +189,24 @@ void qp_getargs_2nd_pass(int argc, char **argv)
   /* load stdin file if it needs to be */
   check_load_stdin(0);
 
+  /* The files that are still loading finish from the main loop,
+   * so the windows show them as they load. */
 
-  if(parser->p2.needs_graph)
+  if(parser->p2.needs_graph && app->op_default_graph)
   {
     /* the last file loaded has no graph yet */
-    
-    ASSERT(qp_sllist_last(app->sources));
 
-    if(app->op_default_graph)
+    if(parser->p2.loading)
+      /* We make it when it is loaded, or when its preview is. */
+      parser->p2.loading->graph = 1;
+    else
+    {
+      ASSERT(qp_sllist_last(app->sources));
+
       if(qp_win_graph_default_source(NULL, (qp_source_t)
-          qp_sllist_last(app->sources), NULL))
+            qp_sllist_last(app->sources), NULL))
         exit(1);
+    }
   }
 
   {
@@ -222,6 +272,17 @@ void qp_getargs_2nd_pass(int argc, char **argv)
       exit(1);
   }
 
+  if(plots.file)
+  {
+    size_t j;
+    for(j=0; j<plots.num_files; ++j)
+      if(plots.file[j].chan)
+        free(plots.file[j].chan);
+    free(plots.file);
+    plots.file = NULL;
+    plots.num_files = 0;
+  }
+
   free(parser);
 }
 
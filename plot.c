@@ -32,6 +32,8 @@
 #include "list.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "qp.h"
 #include "plot.h"
 #include "color_gen.h"
@@ -147,51 +149,14 @@ struct qp_plot *qp_plot_copy_create(struct qp_graph *gr, struct qp_plot *old_p)
   return p;
 }
 
-qp_plot_t qp_plot_create(qp_graph_t gr,
-      qp_channel_t x, qp_channel_t y, const char *name,
-      double xmin, double xmax, double ymin, double ymax)
+/* Makes p->x a copy of x and sets the functions that read it */
+static
+void set_x_channel(struct qp_plot *p, struct qp_channel *x)
 {
-  struct qp_plot *p;
-  size_t num_points = (size_t) -1;
-  ASSERT(gr);
-  ASSERT(x);
-  ASSERT(y);
-  ASSERT(name);
-
-  p = (struct qp_plot*) qp_malloc(sizeof(*p));
-  memset(p, 0, sizeof(*p));
-  p->plot_num = ++gr->plot_create_count;
-  qp_sllist_append(gr->plots, p);
-  p->name = qp_strdup(name);
-  p->gr = gr;
-  gr->current_plot = p;
-  p->gaps = gr->gaps;
-  p->x_entry = NULL;
-  p->y_entry = NULL;
-  p->x_picker = NULL;
-  p->y_picker = NULL;
-
-
-  /* get default point and line colors */
-  qp_color_gen_next(gr->color_gen, &p->p.c.r, &p->p.c.g, &p->p.c.b, -1);
-  qp_color_gen_next(gr->color_gen, &p->l.c.r, &p->l.c.g, &p->l.c.b, -1);
-  p->p.c.a = 0.95;
-  p->l.c.a = 0.85;
-
-
-  if(gr->x11)
-    make_x11_colors(p, gr);
-
-
   switch(x->form)
   {
     case QP_CHANNEL_FORM_SERIES:
       {
-        if(xmax < xmin)
-        {
-          xmin = x->series.min;
-          xmax = x->series.max;
-        }
         p->x = qp_channel_series_create(x, 0);
         p->x_is_reading = qp_channel_series_is_reading;
 
@@ -206,27 +171,60 @@ qp_plot_t qp_plot_create(qp_graph_t gr,
             p->channel_series_x_index = qp_channel_series_double_index;
             p->channel_series_x_get_index = qp_channel_series_double_get_index;
             break;
+          case QP_TYPE_FLOAT:
+            p->channel_x_begin = qp_channel_series_float_begin;
+            p->channel_x_end = qp_channel_series_float_end;
+            p->channel_x_next = qp_channel_series_float_next;
+            p->channel_x_prev = qp_channel_series_float_prev;
+            p->channel_series_x_index = qp_channel_series_float_index;
+            p->channel_series_x_get_index = qp_channel_series_float_get_index;
+            break;
+          case QP_TYPE_INT:
+            p->channel_x_begin = qp_channel_series_int_begin;
+            p->channel_x_end = qp_channel_series_int_end;
+            p->channel_x_next = qp_channel_series_int_next;
+            p->channel_x_prev = qp_channel_series_int_prev;
+            p->channel_series_x_index = qp_channel_series_int_index;
+            p->channel_series_x_get_index = qp_channel_series_int_get_index;
+            break;
+          case QP_TYPE_SHORT:
+            p->channel_x_begin = qp_channel_series_short_begin;
+            p->channel_x_end = qp_channel_series_short_end;
+            p->channel_x_next = qp_channel_series_short_next;
+            p->channel_x_prev = qp_channel_series_short_prev;
+            p->channel_series_x_index = qp_channel_series_short_index;
+            p->channel_series_x_get_index = qp_channel_series_short_get_index;
+            break;
           default:
             VASSERT(0, "write more code here");
             break;
         }
       }
       break;
-    /* TODO: add more cases */
+    case QP_CHANNEL_FORM_FUNC:
+      p->x = qp_channel_series_create(x, 0);
+      p->x_is_reading = qp_channel_series_is_reading;
+      p->channel_x_begin = qp_channel_func_begin;
+      p->channel_x_end = qp_channel_func_end;
+      p->channel_x_next = qp_channel_func_next;
+      p->channel_x_prev = qp_channel_func_prev;
+      p->channel_series_x_index = qp_channel_func_index;
+      p->channel_series_x_get_index = qp_channel_func_get_index;
+      break;
     default:
       VASSERT(0, "write more code here");
       break;
   }
+}
 
+/* Makes p->y a copy of y and sets the functions that read it */
+static
+void set_y_channel(struct qp_plot *p, struct qp_channel *y)
+{
   switch(y->form)
   {
     case QP_CHANNEL_FORM_SERIES:
       {
-        if(ymax < ymin)
-        {
-          ymin = y->series.min;
-          ymax = y->series.max;
-        }
         p->y = qp_channel_series_create(y, 0);
         p->y_is_reading = qp_channel_series_is_reading;
   
@@ -240,22 +238,102 @@ qp_plot_t qp_plot_create(qp_graph_t gr,
             p->channel_y_prev = qp_channel_series_double_prev;
             p->channel_series_y_index = qp_channel_series_double_index;
             break;
+          case QP_TYPE_FLOAT:
+            p->channel_y_begin = qp_channel_series_float_begin;
+            p->channel_y_end = qp_channel_series_float_end;
+            p->channel_y_next = qp_channel_series_float_next;
+            p->channel_y_prev = qp_channel_series_float_prev;
+            p->channel_series_y_index = qp_channel_series_float_index;
+            break;
+          case QP_TYPE_INT:
+            p->channel_y_begin = qp_channel_series_int_begin;
+            p->channel_y_end = qp_channel_series_int_end;
+            p->channel_y_next = qp_channel_series_int_next;
+            p->channel_y_prev = qp_channel_series_int_prev;
+            p->channel_series_y_index = qp_channel_series_int_index;
+            break;
+          case QP_TYPE_SHORT:
+            p->channel_y_begin = qp_channel_series_short_begin;
+            p->channel_y_end = qp_channel_series_short_end;
+            p->channel_y_next = qp_channel_series_short_next;
+            p->channel_y_prev = qp_channel_series_short_prev;
+            p->channel_series_y_index = qp_channel_series_short_index;
+            break;
           default:
             VASSERT(0, "write more code here");
             break;
         }
       }
       break;
-    /* TODO: add more cases */
+    case QP_CHANNEL_FORM_FUNC:
+      p->y = qp_channel_series_create(y, 0);
+      p->y_is_reading = qp_channel_series_is_reading;
+      p->channel_y_begin = qp_channel_func_begin;
+      p->channel_y_end = qp_channel_func_end;
+      p->channel_y_next = qp_channel_func_next;
+      p->channel_y_prev = qp_channel_func_prev;
+      p->channel_series_y_index = qp_channel_func_index;
+      break;
     default:
       VASSERT(0, "write more code here");
       break;
   }
+}
+
+qp_plot_t qp_plot_create(qp_graph_t gr,
+      qp_channel_t x, qp_channel_t y, const char *name,
+      double xmin, double xmax, double ymin, double ymax)
+{
+  struct qp_plot *p;
+  size_t num_points = (size_t) -1;
+  ASSERT(gr);
+  ASSERT(x);
+  ASSERT(y);
+  ASSERT(name);
+
+  p = (struct qp_plot*) qp_malloc(sizeof(*p));
+  memset(p, 0, sizeof(*p));
+  p->plot_num = ++gr->plot_create_count;
+  qp_sllist_append(gr->plots, p);
+  p->name = qp_strdup(name);
+  p->gr = gr;
+  gr->current_plot = p;
+  p->gaps = gr->gaps;
+  p->x_entry = NULL;
+  p->y_entry = NULL;
+  p->x_picker = NULL;
+  p->y_picker = NULL;
+
+
+  /* get default point and line colors */
+  qp_color_gen_next(gr->color_gen, &p->p.c.r, &p->p.c.g, &p->p.c.b, -1);
+  qp_color_gen_next(gr->color_gen, &p->l.c.r, &p->l.c.g, &p->l.c.b, -1);
+  p->p.c.a = 0.95;
+  p->l.c.a = 0.85;
+
+
+  if(gr->x11)
+    make_x11_colors(p, gr);
+
+
+  if(xmax < xmin)
+  {
+    xmin = x->series.min;
+    xmax = x->series.max;
+  }
+  if(ymax < ymin)
+  {
+    ymin = y->series.min;
+    ymax = y->series.max;
+  }
+
+  set_x_channel(p, x);
+  set_y_channel(p, y);
 
   /* find the number of points if we can */
-  if(p->x->form == QP_CHANNEL_FORM_SERIES)
+  if(qp_channel_is_indexed(p->x))
       num_points = qp_channel_series_length(p->x);
-  if(p->y->form == QP_CHANNEL_FORM_SERIES)
+  if(qp_channel_is_indexed(p->y))
   {
     size_t len;
     len = qp_channel_series_length(p->y);
@@ -265,7 +343,10 @@ qp_plot_t qp_plot_create(qp_graph_t gr,
 
   if(gr->lines == -1)
   {
-    if(num_points > 1000000)
+    /* Zoomed out plots with increasing x are drawn from the
+     * summary pyramid of the y values, so they can have lines
+     * with any number of points. */
+    if(num_points > 1000000 && !qp_plot_can_cull(p))
       p->lines = 0;
     else
       p->lines = 1;
@@ -334,6 +415,46 @@ qp_plot_t qp_plot_create(qp_graph_t gr,
 }
 
  
+void qp_plot_set_channels(struct qp_plot *p,
+    qp_channel_t x, qp_channel_t y)
+{
+  struct qp_channel *old_x, *old_y;
+  ASSERT(p);
+  ASSERT(x);
+  ASSERT(y);
+
+  /* x or y may be the channel that we have now, so we copy
+   * them before we free the old ones */
+  old_x = p->x;
+  old_y = p->y;
+  set_x_channel(p, x);
+  set_y_channel(p, y);
+  if(qp_channel_is_indexed(old_x))
+    qp_channel_destroy(old_x);
+  if(qp_channel_is_indexed(old_y))
+    qp_channel_destroy(old_y);
+
+  if(p->x_picker)
+  {
+    size_t len;
+    if(qp_channel_is_indexed(p->x_picker))
+      qp_channel_destroy(p->x_picker);
+    if(qp_channel_is_indexed(p->y_picker))
+      qp_channel_destroy(p->y_picker);
+    p->x_picker = qp_channel_series_create(p->x, 0);
+    p->y_picker = qp_channel_series_create(p->y, 0);
+    p->num_points = qp_channel_series_length(p->x_picker);
+    len = qp_channel_series_length(p->y_picker);
+    if(p->num_points > len)
+      p->num_points = len;
+    if(p->picker_i >= p->num_points)
+      p->picker_i = 0;
+  }
+
+  /* It all needs to be drawn again. */
+  p->drawn_length = 0;
+}
+
 void qp_plot_destroy(qp_plot_t plot, struct qp_graph *gr)
 {
   ASSERT(plot);
@@ -349,15 +470,14 @@ void qp_plot_destroy(qp_plot_t plot, struct qp_graph *gr)
         gr->current_plot = p;
     qp_sllist_destroy(l, 0);
 
-    /* if the channels are series we must free
-     * resources */
-    if(plot->x->form == QP_CHANNEL_FORM_SERIES)
+    /* the plot channels are copies that we must free */
+    if(qp_channel_is_indexed(plot->x))
       qp_channel_destroy(plot->x);
-    if(plot->y->form == QP_CHANNEL_FORM_SERIES)
+    if(qp_channel_is_indexed(plot->y))
       qp_channel_destroy(plot->y);
-    if(plot->x_picker && plot->x_picker->form == QP_CHANNEL_FORM_SERIES)
+    if(plot->x_picker && qp_channel_is_indexed(plot->x_picker))
       qp_channel_destroy(plot->x_picker);
-    if(plot->y_picker && plot->y_picker->form == QP_CHANNEL_FORM_SERIES)
+    if(plot->y_picker && qp_channel_is_indexed(plot->y_picker))
       qp_channel_destroy(plot->y_picker);
 
     /* If using X11 to draw we need to free the X11 colors */
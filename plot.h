@@ -150,6 +150,23 @@ void qp_plot_y_rescale(struct qp_plot *p, double ymin, double ymax)
 }
 
 
+/* returns 1 if the x values increase with the index and we can
+ * find the range of indexes that are in view without reading all
+ * the values.  NAN like values are fine, they are just gaps that
+ * the readers skip over, and the series channel search skips
+ * them too. */
+static inline
+int qp_plot_can_cull(struct qp_plot *p)
+{
+  return (qp_channel_is_indexed(p->x) &&
+      qp_channel_is_indexed(p->y) &&
+      p->x->series.is_increasing &&
+      qp_channel_series_length(p->x) == qp_channel_series_length(p->y) &&
+      (p->x->form == QP_CHANNEL_FORM_SERIES ||
+       !p->x->series.has_nan))?1:0;
+}
+
+
 /*****************************************************************/
 /* All the functions below return a graph pixel x or y position. */
 /*****************************************************************/
@@ -166,11 +183,7 @@ int qp_plot_begin(struct qp_plot *p,
   p->num_read = (size_t) -1;
 
 
-  if(p->x->form == QP_CHANNEL_FORM_SERIES &&
-      p->y->form == QP_CHANNEL_FORM_SERIES &&
-      p->x->series.is_increasing &&
-      qp_channel_series_length(p->x) == qp_channel_series_length(p->y) &&
-      !p->x->series.has_nan && !p->y->series.has_nan)
+  if(qp_plot_can_cull(p))
   {
     /* culling */
     /* this is likely the most common case
@@ -198,8 +211,8 @@ int qp_plot_begin(struct qp_plot *p,
     j   = qp_channel_series_length(p->y);
     if(j < len)
       len = j;
-    j = qp_channel_series_double_find_gt(p->x, &xmax);
-    i = qp_channel_series_double_find_lt(p->x, &xmin);
+    j = qp_channel_series_find_gt(p->x, &xmax);
+    i = qp_channel_series_find_lt(p->x, &xmin);
 
     if(j < len -1)
       /* the number left to read after this returns */
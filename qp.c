@@ -37,6 +37,8 @@
 #include "list.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
 #include "term_color.h"
 #include "plot.h"
 
@@ -606,7 +608,7 @@ int qp_win_graph(qp_win_t qp, const ssize_t *x, const ssize_t *y, size_t num,
   {
     struct qp_channel *chan;
     get_source_channel_num(app->sources, x[i], &chan, NULL);
-    if(chan->form == QP_CHANNEL_FORM_SERIES)
+    if(qp_channel_is_indexed(chan))
     {
       double dx;
       dx = chan->series.max - chan->series.min;
@@ -702,7 +704,7 @@ int qp_win_graph(qp_win_t qp, const ssize_t *x, const ssize_t *y, size_t num,
   {
     struct qp_channel *chan;
     get_source_channel_num(app->sources, y[i], &chan, NULL);
-      if(chan->form == QP_CHANNEL_FORM_SERIES)
+      if(qp_channel_is_indexed(chan))
     {
       double dy = chan->series.max - chan->series.min;
       if(ymin > chan->series.min)
@@ -824,9 +826,9 @@ int qp_win_graph(qp_win_t qp, const ssize_t *x, const ssize_t *y, size_t num,
         p; ++i, p=qp_sllist_next(gr->plots))
     {
       size_t len = (size_t) -1;
-      if(p->x->form == QP_CHANNEL_FORM_SERIES)
+      if(qp_channel_is_indexed(p->x))
         len = qp_channel_series_length(p->x);
-      if(p->y->form == QP_CHANNEL_FORM_SERIES &&
+      if(qp_channel_is_indexed(p->y) &&
           qp_channel_series_length(p->y) < len)
           len = qp_channel_series_length(p->y);
       APPEND("  plot %zu [%zu,%zu]: %s",
@@ -847,9 +849,9 @@ int qp_win_graph(qp_win_t qp, const ssize_t *x, const ssize_t *y, size_t num,
         p; ++i, p=qp_sllist_next(gr->plots))
     {
       size_t len = (size_t) -1;
-      if(p->x->form == QP_CHANNEL_FORM_SERIES)
+      if(qp_channel_is_indexed(p->x))
         len = qp_channel_series_length(p->x);
-      if(p->y->form == QP_CHANNEL_FORM_SERIES &&
+      if(qp_channel_is_indexed(p->y) &&
           qp_channel_series_length(p->y) < len)
           len = qp_channel_series_length(p->y);
       QP_APPEND("  plot %zu [%zu,%zu]: %s",
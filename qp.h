@@ -131,6 +131,11 @@ struct qp_plot
    * based on the nature of the data. */
   size_t num_read;
 
+  /* The number of values that where drawn in the graph back
+   * buffer, so that values that are appended later can be drawn
+   * without drawing it all again.  See qp_graph_draw_tail(). */
+  size_t drawn_length;
+
   double line_width, point_size;
 
   /* These show the middle mouse picker plot values */
@@ -165,6 +170,25 @@ struct qp_plot
 };
 
 
+struct qp_source_reader;
+struct qp_filter;
+
+/* What the row filter knows about the rows before.  See
+ * qp_filter_row(). */
+struct qp_filter_state
+{
+  /* the first and last x values, NAN until we get one */
+  double first_x, last_x;
+  /* if the x values have not decreased */
+  int increasing;
+  /* If not QP_FILTER_NO_END, we got a row past the --x-range
+   * with x increasing up to it, after this many rows were kept,
+   * and the rows after it are not kept. */
+  size_t end_rows;
+};
+
+#define QP_FILTER_NO_END  ((size_t) -1)
+
 struct qp_source
 {
   char *name;
@@ -178,8 +202,54 @@ struct qp_source
 
   /* An array of channels (pointers) */
   struct qp_channel **channels;
+
+  /* The arrays of values of the channels are from this, so
+   * they are released all at once when the source is
+   * destroyed. */
+  struct qp_arena *arena;
+
+  /* Values parsed from lines of text that are not appended
+   * to the channels yet, so that we can append many values
+   * at a time.  batch[k] is for channels[k] and has
+   * batch_len values. */
+  double **batch;
+  size_t batch_len;
+
+  /* If not NULL the columns of the text file that are read,
+   * select[k] for channels[k], in increasing order and ending
+   * with QP_SELECT_END.  The other columns are skipped.  See
+   * qp_source_select_columns(). */
+  size_t *select;
+
+  /* If not NULL only the rows of values that pass this are kept.
+   * See --where and --x-range. */
+  struct qp_filter *filter;
+  struct qp_filter_state filter_state;
+
+  /* If not NULL we are still reading values from a pipe
+   * into this source.  See source.c */
+  struct qp_source_reader *reader;
+};
+
+/* Values parsed from lines of text by another thread than the one
+ * that appends them to the channels of the source.  column[k] has
+ * num_rows values for channels[k] and may hold alloc_rows. */
+struct qp_columns
+{
+  size_t num_columns;
+  size_t num_rows;
+  size_t alloc_rows;
+  double **column;
+  /* the columns of the text that are read, like struct
+   * qp_source select */
+  const size_t *select;
+  /* like struct qp_source filter and filter_state */
+  const struct qp_filter *filter;
+  struct qp_filter_state filter_state;
 };
 
+#define QP_SELECT_END  ((size_t) -1)
+
 
 
 /* graphs do not exist unless they are
@@ -433,7 +503,9 @@ struct qp_win
             *button_graph_detail,
             *notebook, /* graph tabs */
             *statusbar,
-            *status_entry;
+            *status_entry,
+            *load_progress, /* for files that are loading */
+            *load_cancel;
 
   
   struct qp_graph_detail *graph_detail;
@@ -555,6 +627,153 @@ void qp_plot_destroy(struct qp_plot *plot, struct qp_graph *gr);
 extern
 int qp_source_parse_doubles(struct qp_source *source, char *line_in);
 
+/* Appends the values that qp_source_parse_doubles() is holding
+ * to the channels and frees the memory it held them in.  Call
+ * this when there are no more lines to parse for now. */
+extern
+void qp_source_parse_doubles_flush(struct qp_source *source);
+
+/* Parses the lines of text from begin to end, not including end, like
+ * qp_source_parse_doubles() but adding the values to cols.  This
+ * does not touch the source so many threads can run it at once. */
+extern
+void qp_source_parse_doubles_range(struct qp_columns *cols,
+    const char *begin, const char *end);
+
+/* Like qp_source_parse_doubles_range() but stops after the line
+ * that makes cols have num_rows rows.  Returns the start of the
+ * line after the last one parsed. */
+extern
+const char *qp_source_parse_doubles_rows(struct qp_columns *cols,
+    const char *begin, const char *end, size_t num_rows);
+
+/* Appends the values in cols to the source channels, adding channels
+ * if there are more columns.  Flush qp_source_parse_doubles() before
+ * this. */
+extern
+void qp_source_append_columns(struct qp_source *source,
+    struct qp_columns *cols);
+
+/* frees the memory in cols and zeros it to use again, keeping
+ * the select and filter */
+extern
+void qp_columns_free(struct qp_columns *cols);
+
+/* Sets source->select from the --columns list, that has column
+ * numbers, starting at 0, ranges of them like 4-9, and labels
+ * of source, separated by commas.  The labels of the columns that
+ * are not read are removed.  Returns 0 on success, or 1 and spews
+ * if a label is not found. */
+extern
+int qp_source_select_columns(struct qp_source *source, const char *list);
+
+/* Returns the row filter of --where EXPR and --x-range RANGE, either
+ * of which may be NULL, or returns NULL and spews if one is bad.
+ * The filter is in filter.c */
+extern
+struct qp_filter *qp_filter_create(const char *where, const char *x_range);
+
+extern
+void qp_filter_destroy(struct qp_filter *f);
+
+/* Returns a malloc()ed --columns list that is list with the
+ * columns that f uses added to it. */
+extern
+char *qp_filter_columns(const struct qp_filter *f, const char *list);
+
+/* Sets f to look at rows of the columns in select, like struct
+ * qp_source select, or all the columns if select is NULL. */
+extern
+void qp_filter_bind(struct qp_filter *f, const size_t *select);
+
+extern
+void qp_filter_state_init(struct qp_filter_state *st);
+
+/* Returns 1 if the values row[k][i], for k < num, pass f, else 0.
+ * num_rows is the number of rows that were kept before this one. */
+extern
+int qp_filter_row(const struct qp_filter *f, struct qp_filter_state *st,
+    double *const *row, size_t num, size_t i, size_t num_rows);
+
+/* Adds the state next, of rows that were filtered by another
+ * thread, to st of the rows before them.  Returns 1 if the rows
+ * stop in next, after *num_rows of the ones that it kept, or 0
+ * if we go on to the rows after next. */
+extern
+int qp_filter_join(struct qp_filter_state *st,
+    const struct qp_filter_state *next, size_t *num_rows);
+
+/* Reads the values of source from fd if it is a NumPy .npy file,
+ * or with the --binary layout if layout is not NULL, by mapping
+ * the file.  Returns 0 on success, 1 on error, and -1 if the file
+ * is not one of those and nothing was read. */
+extern
+int qp_source_read_binary(struct qp_source *source, int fd,
+    const char *layout);
+
+/* Makes the channels of source read the text in the regular file fd
+ * from offset, where the values start, only when they are drawn, in
+ * place of keeping them in memory.  This parses the file once to
+ * find where each array of values starts and their min and max.  See
+ * --lazy.  Returns 0 on success, 1 on error, and -1 if nothing was
+ * read.  This is in source_lazy.c */
+extern
+int qp_source_read_lazy(struct qp_source *source, int fd, off_t offset);
+
+/* Tells the main thread how much of the file the thread of
+ * qp_source_load() has read, if this is that thread.  Returns 1 if
+ * the load is canceled. */
+extern
+int qp_source_load_progress(size_t count);
+
+/* Returns 0 if layout is a good --binary LAYOUT, else spews why
+ * not and returns 1. */
+extern
+int qp_binary_layout_check(const char *layout);
+
+/* The compressed file types that we read, see decompress.c */
+#define QP_COMPRESS_NONE  0
+#define QP_COMPRESS_GZIP  1
+#define QP_COMPRESS_XZ    2
+#define QP_COMPRESS_ZSTD  3
+
+/* Returns the QP_COMPRESS_* type of the regular file fd from its
+ * first bytes, without moving the file offset. */
+extern
+int qp_decompress_check(int fd);
+
+/* Starts a thread that decompresses fd, of type from
+ * qp_decompress_check(), into a pipe and returns the read end
+ * of the pipe.  The thread closes fd when it is done.  Returns -1
+ * and spews on failure. */
+extern
+int qp_decompress_start(int fd, int type, const char *name);
+
+/* The --cache snapshot of a text file.  See source_cache.c */
+struct qp_cache;
+
+/* Returns the cache entry for the text file filename, that is open
+ * as fd, as it is now and read into source with the app options as
+ * they are now, or NULL if we do not cache the file. */
+extern
+struct qp_cache *qp_cache_create(struct qp_source *source,
+    const char *filename, int fd);
+
+extern
+void qp_cache_destroy(struct qp_cache *cache);
+
+/* Reads the values of source from the snapshot in cache by mapping
+ * it.  Returns 0 on success, or -1 if there is no good snapshot and
+ * nothing was read. */
+extern
+int qp_source_cache_read(struct qp_source *source, struct qp_cache *cache);
+
+/* Writes a snapshot of the channels and labels that were just read
+ * into source, so that qp_source_cache_read() can read them later. */
+extern
+void qp_source_cache_write(struct qp_source *source,
+    struct qp_cache *cache);
+
 extern
 void qp_graph_zoom_out(struct qp_graph *gr, int all);
 
@@ -577,6 +796,12 @@ qp_plot_t qp_plot_create(struct qp_graph *graph,
     qp_channel_t x, qp_channel_t y, const char *name,
     double xmin, double xmax, double ymin, double ymax);
 
+/* Makes the plot draw copies of x and y in place of the channels
+ * it has, keeping its scales, colors and the rest. */
+extern
+void qp_plot_set_channels(struct qp_plot *p,
+    qp_channel_t x, qp_channel_t y);
+
 extern
 qp_graph_t qp_graph_create(qp_win_t qp, const char *name);
 
@@ -595,6 +820,19 @@ void qp_graph_append(qp_graph_t graph, qp_plot_t  plot);
 extern
 void qp_graph_draw(struct qp_graph *gr, cairo_t *cr);
 
+/* Draws the values that where appended to the plot channels since
+ * the graph was drawn onto the graph back buffer, without drawing
+ * the rest again.  Returns 0 if it could not and the graph needs
+ * to be all drawn. */
+extern
+int qp_graph_draw_tail(struct qp_graph *gr);
+
+/* Redraws the graph after values are appended to its plots
+ * channels.  The plots are rescaled if the values are no longer
+ * in the plot scales and the graph is not zoomed in. */
+extern
+void qp_graph_update(struct qp_graph *gr);
+
 
 extern
 int qp_win_save_png(struct qp_win *qp,
@@ -609,6 +847,39 @@ extern
 qp_source_t qp_source_create(
     const char *filename, int value_type);
 
+/* Like qp_source_create() but the source keeps reading
+ * the lines that are appended to the file, like tail -f. */
+extern
+qp_source_t qp_source_create_follow(
+    const char *filename, int value_type);
+
+/* Reads the file in a thread so that the windows keep working while
+ * it loads, and shows the progress in the status bar of qp, or of
+ * all the windows if qp is NULL.  loaded() is called from the main
+ * loop with the source after it is added to app->sources, or with
+ * NULL if it failed or was canceled.  Big
+ * text files are first added with a sample of their rows, and the
+ * values of that source are replaced when the file is all read.  Files
+ * that are not regular files, like pipes, are read before this
+ * returns NULL.  The threads read the app options, so finish the
+ * loads with qp_source_load_wait() before changing them. */
+struct qp_loader;
+extern
+struct qp_loader *qp_source_load(const char *filename, int value_type,
+    struct qp_win *qp,
+    void (*loaded)(qp_source_t source, void *data), void *data);
+
+/* Finishes the loads that started before ld and ld, in the order
+ * they started.  If ld is NULL it finishes all of them. */
+extern
+void qp_source_load_wait(struct qp_loader *ld);
+
+/* Cancels the loads that the status bar of qp shows, that is the
+ * files opened from qp and the ones that were not opened from a
+ * window. */
+extern
+void qp_source_load_cancel(struct qp_win *qp);
+
 extern
 qp_source_t qp_source_create_from_func(
     const char *name, int value_type,
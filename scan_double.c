@@ -0,0 +1,69 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <float.h>
+#include <locale.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "scan_double.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* digits, signs, the point, and I or N for INF and NAN */
+const unsigned char qp_scan_start[256] =
+{
+  ['\0'] = 1,
+  ['+'] = 1, ['-'] = 1, ['.'] = 1,
+  ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1,
+  ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+  ['i'] = 1, ['I'] = 1, ['n'] = 1, ['N'] = 1
+};
+
+
+/* made the first time it is used */
+static locale_t c_locale = (locale_t) 0;
+
+double qp_scan_strtod(const char *s, char **end)
+{
+  if(!c_locale)
+  {
+    locale_t l;
+    l = newlocale(LC_NUMERIC_MASK, "C", (locale_t) 0);
+    ASSERT(l);
+    if(!__sync_bool_compare_and_swap(&c_locale, (locale_t) 0, l))
+      /* another thread made it first */
+      freelocale(l);
+  }
+  return strtod_l(s, end, c_locale);
+}
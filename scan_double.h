@@ -0,0 +1,270 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* A scanner for numbers in text that gives the same doubles as
+ * strtod() in the "C" locale no matter what the locale is set to.
+ * Most numbers in data files have less than 20 digits and a small
+ * exponent, and they are read here with one multiply or divide of
+ * exact doubles, which rounds correctly.  Anything else, like hex
+ * numbers, INF, NAN, and numbers with many digits, is passed to
+ * strtod_l(). */
+
+#include <stdint.h>
+#include <strings.h>
+#include <float.h>
+
+
+/* qp_scan_start[c] is 1 for the chars c that a number may start
+ * with, and for '\0' so that we stop there. */
+extern
+const unsigned char qp_scan_start[256];
+
+/* strtod() in the "C" locale */
+extern
+double qp_scan_strtod(const char *s, char **end);
+
+
+static inline
+int qp_scan_is_digit(char c)
+{
+  return (c >= '0' && c <= '9')?1:0;
+}
+
+/* Reads the number that starts at s, not skipping anything.
+ * Returns 1 and sets *val and *end to the char after the number,
+ * or returns 0 if there is no number at s. */
+static inline
+int qp_scan_double(const char *s, char **end, double *val)
+{
+  /* all the powers of 10 that are exact doubles */
+  static const double p10[] =
+  {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+  };
+  const char *p;
+  uint64_t m = 0;
+  int neg = 0, nd = 0, e10 = 0, dropped = 0;
+
+  p = s;
+  if(*p == '+' || *p == '-')
+  {
+    neg = (*p == '-');
+    ++p;
+  }
+
+  if(!qp_scan_is_digit(*p) && !(*p == '.' && qp_scan_is_digit(p[1])))
+  {
+    if(!strncasecmp(p, "inf", 3) || !strncasecmp(p, "nan", 3))
+      goto slow;
+    return 0;
+  }
+
+  if(p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    /* hex */
+    goto slow;
+
+  while(*p == '0')
+    ++p;
+  for(; qp_scan_is_digit(*p); ++p)
+  {
+    if(nd < 19)
+    {
+      m = m*10 + (*p - '0');
+      ++nd;
+    }
+    else
+    {
+      ++e10;
+      dropped |= (*p != '0');
+    }
+  }
+
+  if(*p == '.')
+  {
+    ++p;
+    if(!nd)
+      /* leading zeros after the point */
+      for(; *p == '0'; ++p)
+        --e10;
+    for(; qp_scan_is_digit(*p); ++p)
+    {
+      if(nd < 19)
+      {
+        m = m*10 + (*p - '0');
+        ++nd;
+        --e10;
+      }
+      else
+        dropped |= (*p != '0');
+    }
+  }
+
+  if(*p == 'e' || *p == 'E')
+  {
+    /* the exponent is only part of the number if it has digits */
+    const char *q;
+    int eneg = 0, ex = 0;
+    q = p + 1;
+    if(*q == '+' || *q == '-')
+    {
+      eneg = (*q == '-');
+      ++q;
+    }
+    if(qp_scan_is_digit(*q))
+    {
+      for(; qp_scan_is_digit(*q); ++q)
+        if(ex < 100000)
+          ex = ex*10 + (*q - '0');
+      e10 += (eneg)?-ex:ex;
+      p = q;
+    }
+  }
+
+#if FLT_EVAL_METHOD == 0
+  if(!dropped)
+  {
+    double x;
+    if(m == 0)
+      x = 0;
+    else if(m <= (((uint64_t) 1) << 53) && e10 >= -22 && e10 <= 22)
+      /* m and 10^|e10| are exact doubles so this is one correctly
+       * rounded operation */
+      x = (e10 < 0)?(m/p10[-e10]):(m*p10[e10]);
+    else
+      goto slow;
+
+    *val = (neg)?-x:x;
+    *end = (char *) p;
+    return 1;
+  }
+#endif
+
+slow:
+
+  *val = qp_scan_strtod(s, end);
+  return (*end != s)?1:0;
+}
+
+/* Gets the next double in *line skipping any chars that cannot be
+ * part of a number, like strtod() at each char until one parses.
+ * Returns 1 and moves *line past the number if it gets one, or 0 if
+ * there are no more numbers. */
+static inline
+int qp_scan_next_double(double *val, char **line)
+{
+  char *s, *end;
+
+  s = *line;
+  while(1)
+  {
+    /* skip the separators in bulk */
+    while(!qp_scan_start[(unsigned char) *s])
+      ++s;
+    if(!*s)
+    {
+      *line = s;
+      return 0;
+    }
+    if(qp_scan_double(s, &end, val))
+    {
+      *line = end;
+      return 1;
+    }
+    ++s;
+  }
+}
+
+/* Returns the end of the number that starts at s, the same as
+ * qp_scan_double() does but with no conversion, or NULL if there
+ * is no number at s. */
+static inline
+char *qp_scan_number_end(const char *s)
+{
+  const char *p;
+  char *end;
+
+  p = s;
+  if(*p == '+' || *p == '-')
+    ++p;
+
+  if(!qp_scan_is_digit(*p) && !(*p == '.' && qp_scan_is_digit(p[1])))
+  {
+    if(!strncasecmp(p, "inf", 3) || !strncasecmp(p, "nan", 3))
+      goto slow;
+    return NULL;
+  }
+
+  if(p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    goto slow;
+
+  for(; qp_scan_is_digit(*p); ++p);
+  if(*p == '.')
+    for(++p; qp_scan_is_digit(*p); ++p);
+  if(*p == 'e' || *p == 'E')
+  {
+    const char *q;
+    q = p + 1;
+    if(*q == '+' || *q == '-')
+      ++q;
+    if(qp_scan_is_digit(*q))
+    {
+      for(; qp_scan_is_digit(*q); ++q);
+      p = q;
+    }
+  }
+  return (char *) p;
+
+slow:
+
+  qp_scan_strtod(s, &end);
+  return (end != s)?end:NULL;
+}
+
+/* Like qp_scan_next_double() but the number is skipped and not
+ * converted.  Returns 1 if there was a number, or 0 if there are
+ * no more numbers. */
+static inline
+int qp_scan_skip_double(char **line)
+{
+  char *s, *end;
+
+  s = *line;
+  while(1)
+  {
+    while(!qp_scan_start[(unsigned char) *s])
+      ++s;
+    if(!*s)
+    {
+      *line = s;
+      return 0;
+    }
+    if((end = qp_scan_number_end(s)))
+    {
+      *line = end;
+      return 1;
+    }
+    ++s;
+  }
+}
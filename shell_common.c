@@ -151,6 +151,7 @@ struct command commands[] =
 #endif
   { "input",    "IFILE",    "set shell to read input from IFILE"    , 0},
   { "open",     "FILE ...", "open and read data from FILEs"         , 0},
+  { "open",     "--follow FILE ...", "open FILEs and read what is added", 0},
   { "plot",     "PAR ...",  "get and set plot pararmeters"          , 0},
   { "quit",     0,          "quit quickplot and exit the shell"     , 0},
   { "window",   "PAR ...",  "get and set window parameters"         , 0},
@@ -173,14 +174,24 @@ struct command help_commands[] =
 
 struct command app_commands[] =
 {
+  { "binary",          "LAYOUT",     "read files as binary LAYOUT"        , 0 },
+  { "cache",           "BOOL",       "cache files read after"             , 0 },
+  { "columns",         "LIST",       "read columns LIST of files after"   , 0 },
+  { "compress_channels", "BOOL",     "compress values read after"         , 0 },
   { "default_graph",   "BOOL",       "create default graphs after"        , 0 },
   { "geometry",        "GEO",        "geometry of next window created"    , 0 },
   { "label_separator", "STR",        "read labels separator"              , 0 },
   { "labels",          "BOOL",       "read labels"                        , 0 },
+  { "lazy",            "BOOL",       "parse files read after as drawn"    , 0 },
   { "linear_channel",  "START STOP", "prepend a linear channel"           , 0 },
+  { "max_memory",      "BYTES",      "memory for values before files"     , 0 },
   { "new_window",      "BOOL",       "make new window for new graphs"     , 0 },
   { "number_of_plots", "NUM",        "number plots in default_graph"      , 0 },
+  { "redraw_rate",     "HZ",         "graph redraws a second from pipes"  , 0 },
   { "skip_lines",      "NUM",        "skip first NUM lines reading"       , 0 },
+  { "value_type",      "TYPE",       "store values read as TYPE"          , 0 },
+  { "where",           "EXPR",       "keep lines where EXPR read after"   , 0 },
+  { "x_range",         "MIN:MAX",    "keep lines in x range read after"   , 0 },
   { 0,                 0,           0                                     , 0 }
 };
 
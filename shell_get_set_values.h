@@ -395,6 +395,24 @@ void PrintParValDescHeader(FILE *out)
 static
 char *app_get_value(const char *name)
 {
+  if(!strcmp(name, "binary"))
+  {
+    if(app->op_binary)
+      return StringValue(app->op_binary);
+    snprintf(get_buf, GET_BUF_LEN, "none");
+    return get_buf;
+  }
+  if(!strcmp(name, "cache"))
+    return BoolValue(app->op_cache);
+  if(!strcmp(name, "columns"))
+  {
+    if(app->op_columns)
+      return StringValue(app->op_columns);
+    snprintf(get_buf, GET_BUF_LEN, "auto");
+    return get_buf;
+  }
+  if(!strcmp(name, "compress_channels"))
+    return BoolValue(app->op_compress_channels);
   if(!strcmp(name, "default_graph"))
     return BoolValue(app->op_default_graph);
   if(!strcmp(name, "geometry"))
@@ -403,13 +421,23 @@ char *app_get_value(const char *name)
     return StringValue(app->op_label_separator);
   if(!strcmp(name, "labels"))
     return BoolValue(app->op_labels);
+  if(!strcmp(name, "lazy"))
+    return BoolValue(app->op_lazy);
   if(!strcmp(name, "linear_channel"))
   {
     if(app->op_linear_channel)
       snprintf(get_buf, GET_BUF_LEN,
             "'%g %g'",
-            ((double*)(app->op_linear_channel->data))[0],
-            ((double*)(app->op_linear_channel->data))[1]);
+            app->op_linear_channel->func.param[0],
+            app->op_linear_channel->func.param[1]);
+    else
+      snprintf(get_buf, GET_BUF_LEN, "off");
+    return get_buf;
+  }
+  if(!strcmp(name, "max_memory"))
+  {
+    if(app->op_max_memory)
+      snprintf(get_buf, GET_BUF_LEN, "%zu", app->op_max_memory);
     else
       snprintf(get_buf, GET_BUF_LEN, "off");
     return get_buf;
@@ -418,8 +446,30 @@ char *app_get_value(const char *name)
     return BoolValue(app->op_new_window);
   if(!strcmp(name, "number_of_plots"))
     return IntValue(app->op_number_of_plots);
+  if(!strcmp(name, "redraw_rate"))
+    return IntValue(app->op_redraw_rate);
   if(!strcmp(name, "skip_lines"))
     return IntValue(app->op_skip_lines);
+  if(!strcmp(name, "value_type"))
+  {
+    snprintf(get_buf, GET_BUF_LEN, "%s",
+        qp_channel_value_type_name(app->op_value_type));
+    return get_buf;
+  }
+  if(!strcmp(name, "where"))
+  {
+    if(app->op_where)
+      return StringValue(app->op_where);
+    snprintf(get_buf, GET_BUF_LEN, "none");
+    return get_buf;
+  }
+  if(!strcmp(name, "x_range"))
+  {
+    if(app->op_x_range)
+      return StringValue(app->op_x_range);
+    snprintf(get_buf, GET_BUF_LEN, "none");
+    return get_buf;
+  }
   VASSERT(0, "name=\"%s\" not found\n", name);
   return NULL;
 }
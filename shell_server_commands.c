@@ -55,6 +55,7 @@
 #include "shell_common.h"
 #include "callbacks.h"
 #include "channel.h"
+#include "arena.h"
 #include "utils.h"
 #include "shell_get_set_values.h"
 #include "zoom.h"
@@ -72,6 +73,15 @@
  *
  * Need to look into flex and bison???*/
 
+/* called by qp_source_load() after a file from the open
+ * command is loaded */
+static
+void open_loaded(qp_source_t s, void *data)
+{
+  if(s && app->op_default_graph)
+    qp_win_graph_default_source(NULL, s, NULL);
+}
+
 /* returns 1 if it can keep running
  * returns 0 if the qp_shell is destroyed */
 int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
@@ -272,7 +282,64 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
 
     if(!strcmp(argv[0], "app"))
     {
-      if(!strcmp(argv[1], "default_graph"))
+      if(argc > 2)
+        /* The files that are loading read the app options. */
+        qp_source_load_wait(NULL);
+
+      if(!strcmp(argv[1], "binary"))
+      {
+        if(argc == 3)
+        {
+          if(strcasecmp(argv[2], "none") && qp_binary_layout_check(argv[2]))
+            fprintf(out, "Invalid binary layout\n");
+          else
+          {
+            if(app->op_binary)
+              free(app->op_binary);
+            app->op_binary = NULL;
+            if(strcasecmp(argv[2], "none"))
+              app->op_binary = qp_strdup(argv[2]);
+          }
+        }
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("binary"));
+        else
+          BadCommand2(out, argc, argv);
+      }
+      else if(!strcmp(argv[1], "cache"))
+      {
+        if(argc == 3)
+          app->op_cache = GetBool(argv[2], 0);
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("cache"));
+        else
+          BadCommand2(out, argc, argv);
+      }
+      else if(!strcmp(argv[1], "columns"))
+      {
+        if(argc == 3)
+        {
+          if(app->op_columns)
+            free(app->op_columns);
+          app->op_columns = NULL;
+          if(strcasecmp(argv[2], "auto"))
+            app->op_columns = qp_strdup(argv[2]);
+        }
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("columns"));
+        else
+          BadCommand2(out, argc, argv);
+      }
+      else if(!strcmp(argv[1], "compress_channels"))
+      {
+        if(argc == 3)
+          app->op_compress_channels = GetBool(argv[2], 0);
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("compress_channels"));
+        else
+          BadCommand2(out, argc, argv);
+      }
+      else if(!strcmp(argv[1], "default_graph"))
       {
         if(argc == 2)
           fprintf(out, "%s\n", BoolValue(app->op_default_graph));
@@ -326,6 +393,15 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
         else
           BadCommand2(out, argc, argv);
       }
+      else if(!strcmp(argv[1], "lazy"))
+      {
+        if(argc == 3)
+          app->op_lazy = GetBool(argv[2], 0);
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("lazy"));
+        else
+          BadCommand2(out, argc, argv);
+      }
       else if(!strcmp(argv[1], "linear_channel"))
       {
         if(argc == 2)
@@ -376,6 +452,29 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
         else
           BadCommand2(out, argc, argv);
       }
+      else if(!strcmp(argv[1], "max_memory"))
+      {
+        if(argc == 3)
+        {
+          size_t bytes;
+          if(!strcmp(argv[2], "off"))
+            bytes = 0;
+          else
+            bytes = qp_arena_parse_size(argv[2]);
+          if(bytes == (size_t) -1)
+            fprintf(out, "bad number of bytes: %s\n"
+                "BYTES may end in K, M or G, or be off\n", argv[2]);
+          else
+          {
+            app->op_max_memory = bytes;
+            qp_arena_set_max_memory(bytes);
+          }
+        }
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("max_memory"));
+        else
+          BadCommand2(out, argc, argv);
+      }
       else if(!strcmp(argv[1], "new_window"))
       {
         if(argc == 3)
@@ -394,6 +493,15 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
         else
           BadCommand2(out, argc, argv);
       }
+      else if(!strcmp(argv[1], "redraw_rate"))
+      {
+        if(argc == 3)
+          GetInt(out, argv[2], 0, 1000, &app->op_redraw_rate);
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("redraw_rate"));
+        else
+          BadCommand2(out, argc, argv);
+      }
       else if(!strcmp(argv[1], "skip_lines"))
       {
         if(argc == 3)
@@ -403,6 +511,50 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
         else
           BadCommand2(out, argc, argv);
       }
+      else if(!strcmp(argv[1], "value_type"))
+      {
+        if(argc == 3)
+        {
+          int value_type;
+          value_type = qp_channel_value_type_from_name(argv[2]);
+          if(value_type == -1)
+            fprintf(out, "bad value type: %s\n"
+                "TYPE may be auto, short, int, float or double\n", argv[2]);
+          else
+            app->op_value_type = value_type;
+        }
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value("value_type"));
+        else
+          BadCommand2(out, argc, argv);
+      }
+      else if(!strcmp(argv[1], "where") || !strcmp(argv[1], "x_range"))
+      {
+        char **op;
+        op = (argv[1][0] == 'w')?&app->op_where:&app->op_x_range;
+        if(argc == 3)
+        {
+          struct qp_filter *f = NULL;
+          if(strcasecmp(argv[2], "none") &&
+              !(f = (argv[1][0] == 'w')?qp_filter_create(argv[2], NULL):
+                qp_filter_create(NULL, argv[2])))
+            fprintf(out, "bad %s: %s\n", argv[1], argv[2]);
+          else
+          {
+            if(f)
+              qp_filter_destroy(f);
+            if(*op)
+              free(*op);
+            *op = NULL;
+            if(strcasecmp(argv[2], "none"))
+              *op = qp_strdup(argv[2]);
+          }
+        }
+        if(argc == 2 || argc == 3)
+          fprintf(out, "%s\n", app_get_value(argv[1]));
+        else
+          BadCommand2(out, argc, argv);
+      }
       else if(!strcmp(argv[1], "border"))
       {
         if(argc == 3)
@@ -1231,12 +1383,25 @@ int do_server_commands(size_t argc, char **argv, struct qp_shell *sh)
     }
     else if(!strcmp(argv[0], "open"))
     {
-      /* open files */
+      /* open files, and follow the files after --follow */
       char **filename;
+      int follow = 0;
       for(filename = &argv[1]; *filename; ++filename)
       {
         struct qp_source *s;
-        s = qp_source_create(*filename, QP_TYPE_UNKNOWN);
+        if(!strcmp(*filename, "--follow"))
+        {
+          follow = 1;
+          continue;
+        }
+        if(!follow)
+        {
+          /* The windows keep working while the file loads. */
+          qp_source_load(*filename, QP_TYPE_UNKNOWN, NULL,
+              open_loaded, NULL);
+          continue;
+        }
+        s = qp_source_create_follow(*filename, QP_TYPE_UNKNOWN);
         if(s && app->op_default_graph)
           qp_win_graph_default_source(NULL, s, NULL);
       }
@@ -26,12 +26,14 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <errno.h>
-#include <dlfcn.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <sys/inotify.h>
 
 #include <sndfile.h>
 #include <gtk/gtk.h>
@@ -46,6 +48,10 @@
 #include "list.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pack.h"
+#include "arena.h"
 
 #ifdef DMALLOC
 #  include "dmalloc.h"
@@ -53,966 +59,2453 @@
 
 
 
-#define BUF_LEN  (4096)
-
-static __thread ssize_t (*sys_read)(int fd,
-      void *buf, size_t count) = NULL;
-
-static __thread off_t (*sys_lseek)(int fd,
-    off_t offset, int whence) = NULL;
-
-static __thread struct qp_reader *qp_rd = NULL;
+/* The size of the read()s that fill the reader buffer */
+#define READ_LEN  (256*1024)
 
+/* The file that source_read() reads, with a buffer in front of it.
+ * libsndfile looks at the top of the file through the buffer with
+ * sf_open_virtual(), and if it is not sound the text parser starts
+ * from the top again, which is still in the buffer if the file is a
+ * pipe.  Lines are parsed where they are in the buffer, not copied
+ * out of it. */
 struct qp_reader
 {
-  int fd;
-  FILE *file;
-  /* We use this buffer to virtualize read()
-   * We think that libsndfile will know that
-   * the file good by reading just RD_LEN. */
-  uint8_t *buf;
-  size_t len, /* bytes read from system read() */
-         rd;  /* bytes read by reader */
-  int past; /* read past the buffer */
+  int fd; /* or -1 if all the data is in buf */
+  /* The bytes that are read and not used yet are buf[start] to
+   * buf[end-1].  buf[0] is at offset in the file.  There is always
+   * room for one more byte after buf[end-1], so the last line can
+   * have a '\0' after it. */
+  char *buf;
+  size_t alloc, start, end;
+  off_t offset;
+  int eof; /* read() gave end-of-file */
+  /* If set we keep all the bytes that we read, so we can seek
+   * back to the top of a pipe. */
+  int keep;
+  /* reader_line() puts a '\0' after the line it returns.  This is
+   * where, and the byte that was there, or held is -1. */
+  size_t held;
+  char held_char;
+  int is_pipe;
   char *filename;
+  int follow; /* keep reading what is appended to the file */
+  /* the pipe is from a thread that decompresses the file */
+  int compressed;
 };
 
+/* A file that is read by a thread, so that the windows keep working
+ * while it loads.  The main thread adds the source to app->sources
+ * and the menus when the thread is done.  See qp_source_load(). */
+struct qp_loader
+{
+  struct qp_source *source;
+  char *filename;
+  pthread_t thread;
+  int err;    /* the read failed or was canceled */
+  int done;   /* set by the thread when it is finished */
+  /* A source with a sample of the rows of a big file, that the
+   * thread sets so it can be graphed before the file is all read,
+   * and if the main thread added it to app->sources. */
+  struct qp_source *preview;
+  int preview_shown;
+  int cancel; /* set by the main thread to stop reading */
+  /* The window that the file was opened from, which shows the
+   * progress and can cancel it, or NULL for all windows. */
+  struct qp_win *qp;
+  /* How much is read so far and how much there is to read, in bytes
+   * for text files and in frames for sound files.  total is 0 if we
+   * do not know. */
+  size_t count, total;
+  void (*loaded)(qp_source_t source, void *data);
+  void *data;
+};
 
-/* Wrapping the system read() just so we can read
- * a pipe with the libsndfile API and if the
- * pipe was not sound data then we can read
- * what was in the front of the pipe from 
- * the qp_rd buffer.  It turns out that stdio
- * streams are in the same library as the read()
- * function and do not call my wrapper.
- * So we use our own Getline() that starts by
- * copying from the qp_rd buffer and than switches
- * to calling getline() after the buffer is all
- * copied.  This function does more than we
- * need, because we wrongly thought that getline would
- * call it.  We are lucky that libsndfile does not
- * use stdio streams to read. */
-ssize_t read(int fd, void *buf, size_t count)
-{
-  if(!sys_read)
-  {
-    char *error;
-    dlerror();
-    sys_read = dlsym(RTLD_NEXT, "read");
-    if((error = dlerror()) != NULL)
-    {
-      EERROR("dlsym(RTLD_NEXT, \"read\") failed: %s\n", error);
-      QP_EERROR("Failed to virtualize read(): %s\n", error);
-      exit(1);
-    }
-  }
-
-
-  if(qp_rd && qp_rd->fd == fd && !qp_rd->past)
-  {
-    ssize_t n;
-    size_t rcount;
-
-    //DEBUG("count=%zu  rd=%zu len=%zu\n", count, qp_rd->rd, qp_rd->len);
-
-    if(BUF_LEN == qp_rd->rd)
-    {
-      /* The read before this one was the last
-       * read that was buffered.  Now it is reading
-       * past the buffer and we are no longer
-       * buffering the read.  We are screwed if
-       * we need more buffering. */
-      qp_rd->past = 1;
-      DEBUG("Finished virtualizing read()\n");
-      return sys_read(fd, buf, count);
-    }
-
-    if(qp_rd->len >= qp_rd->rd + count)
-    {
-      /* pure virtual read */
-      memcpy(buf, &qp_rd->buf[qp_rd->rd], count);
-      qp_rd->rd += count;
-      return (ssize_t) count;
-    }
-
-    if(BUF_LEN == qp_rd->len)
-    {
-      /* We cannot read any more and
-       * we still have unread buffer data.
-       * pure virtual read with less than
-       * requested returned */
-      /* count is greater than what is buffered */
-      n = BUF_LEN - qp_rd->rd;
-      memcpy(buf, &qp_rd->buf[qp_rd->rd], n);
-      qp_rd->rd = BUF_LEN;
-      return n;
-    }
+/* the load that this thread is doing, if any */
+static __thread struct qp_loader *qp_ld = NULL;
 
-    /* At this point we will read more into
-     * the buffer */
+/* The loads that are not finished, or finished and not added to
+ * app->sources yet, in the order that they started. */
+static struct qp_sllist *loaders = NULL;
 
-    if(count > BUF_LEN - qp_rd->rd)
-      /* Giving less than asked for.
-       * We may fill the buffer full. */
-      rcount = BUF_LEN - qp_rd->len;
-    else
-      /* Try to give what was asked for. */
-      rcount = count + qp_rd->rd - qp_rd->len;
+static guint load_progress_timeout = 0;
 
-    errno = 0;
-    n = sys_read(fd, &qp_rd->buf[qp_rd->rd], rcount);
 
-    if(n < 0)
-    {
-      EWARN("read(fd=%d, buf=%p, count=%zu) failed\n",
-          fd, &qp_rd->buf[qp_rd->rd], rcount);
-      QP_EWARN("reading file \"%s\" failed", qp_rd->filename);
-      qp_rd->past = 1;
-      return n;
-    }
-    if(n == 0 && qp_rd->rd == qp_rd->len)
-    {
-      /* virtual and real end of file */
-      //DEBUG("read(fd=%d, buf=%p, count=%zu)=0 end of file\n",
-      //    fd, &qp_rd->buf[qp_rd->rd], rcount);
-      return n;
-    }
-   
-    /* assuming that the OS is not a piece of shit */
-    ASSERT(n <= rcount);
+static inline
+void reader_init(struct qp_reader *rd, int fd, const char *filename,
+    int follow)
+{
+  memset(rd, 0, sizeof(*rd));
+  rd->fd = fd;
+  rd->held = (size_t) -1;
+  rd->filename = (char *) filename;
+  rd->follow = follow;
+}
 
-    qp_rd->len += n;
-    n = qp_rd->len - qp_rd->rd;
-    memcpy(buf, &qp_rd->buf[qp_rd->rd], n);
-    qp_rd->rd += n;
-    return n;
+/* Puts back the byte that the last line from reader_line() has its
+ * '\0' on. */
+static inline
+void reader_release(struct qp_reader *rd)
+{
+  if(rd->held != (size_t) -1)
+  {
+    rd->buf[rd->held] = rd->held_char;
+    rd->held = (size_t) -1;
   }
-  else
-    return sys_read(fd, buf, count);
 }
 
+/* the file offset of the next byte that is not used */
+static inline
+off_t reader_tell(const struct qp_reader *rd)
+{
+  return rd->offset + rd->start;
+}
 
-/* We virtualize lseek() to work around a bug in libsndfile 1.0.25:
- * it calls lseek() when reading a pipe with Ogg file format data. */
-off_t lseek(int fd, off_t offset, int whence)
+/* Reads more of the file into the buffer.  Returns the number of
+ * bytes read, 0 on end-of-file, or -1 on error, or if the file is
+ * non-blocking and there is nothing to read now. */
+static
+ssize_t reader_fill(struct qp_reader *rd)
 {
-  if(!sys_lseek)
+  ssize_t n;
+
+  reader_release(rd);
+
+  if(rd->fd == -1)
   {
-    char *error;
-    dlerror();
-    sys_lseek = dlsym(RTLD_NEXT, "lseek");
-    if((error = dlerror()) != NULL)
-    {
-      EERROR("dlsym(RTLD_NEXT, \"lseek\") failed: %s\n", error);
-      QP_EERROR("Failed to virtualize lseek(): %s\n", error);
-      ASSERT(0);
-      exit(1);
-    }
+    rd->eof = 1;
+    return 0;
   }
 
-  if(qp_rd && qp_rd->fd == fd && !qp_rd->past && whence == SEEK_SET)
+  if(!rd->keep && rd->start)
   {
-    if(offset > BUF_LEN || offset > qp_rd->rd)
-    {
-      ERROR("Virtualized lseek(fd=%d, offset=%ld, SEEK_SET) failed\n",
-          fd, offset);
-      QP_ERROR("Failed to virtualize lseek(fd=%d, offset=%ld, SEEK_SET)"
-          " values where not expected.\n", fd, offset);
-      ASSERT(0);
-      exit(1);
-    }
-
-    DEBUG("Virtualizing lseek(fd=%d, offset=%ld, SEEK_SET)\n", fd, offset);
+    /* We are done with the bytes before start. */
+    memmove(rd->buf, rd->buf + rd->start, rd->end - rd->start);
+    rd->offset += rd->start;
+    rd->end -= rd->start;
+    rd->start = 0;
+  }
 
-    qp_rd->rd = offset;
-    return offset; /* success */
+  if(rd->alloc < rd->end + READ_LEN + 1)
+  {
+    /* a long line, or we keep what we read */
+    if(!rd->alloc)
+      rd->alloc = READ_LEN + 1;
+    while(rd->alloc < rd->end + READ_LEN + 1)
+      rd->alloc *= 2;
+    rd->buf = (char *) qp_realloc(rd->buf, rd->alloc);
   }
 
-  return sys_lseek(fd, offset, whence);
+  while((n = read(rd->fd, rd->buf + rd->end,
+          rd->alloc - rd->end - 1)) == -1 && errno == EINTR);
+
+  if(n > 0)
+    rd->end += n;
+  else if(n == 0)
+    rd->eof = 1;
+  return n;
 }
 
-/* This starts by copying data from the qp_rd
- * read() buffer and then when that is empty it
- * finishes reading the file to complete a line,
- * and after that it just calls getline() */
+/* Returns the next line in the buffer with its '\n', if it has one,
+ * and a '\0' after that, and sets *len to its length.  The line is
+ * good until the reader is used again.  Returns NULL if there is no
+ * whole line in the buffer.  At end-of-file the bytes that are left
+ * are the last line, unless we follow the file, in which case they
+ * wait for the rest of the line. */
 static inline
-ssize_t Getline(char **lineptr, size_t *n, FILE *file)
+char *reader_line(struct qp_reader *rd, size_t *len)
 {
-  ssize_t i;
-  int c;
+  char *line, *nl;
 
-  if(!qp_rd || qp_rd->rd == qp_rd->len)
-    return getline(lineptr, n, file);
-  
-  i = qp_rd->rd;
+  reader_release(rd);
 
+  if(rd->start == rd->end)
+    return NULL;
+
+  line = rd->buf + rd->start;
+  if((nl = memchr(line, '\n', rd->end - rd->start)))
+    *len = nl - line + 1;
+  else if(rd->eof && !rd->follow)
+    *len = rd->end - rd->start;
+  else
+    return NULL;
+
+  rd->start += *len;
+  rd->held = rd->start;
+  rd->held_char = rd->buf[rd->start];
+  rd->buf[rd->start] = '\0';
+  return line;
+}
 
-  while(i < qp_rd->len && qp_rd->buf[i] != '\n')
-    ++i;
+/* Like getline(3), but the line is in the reader buffer, as from
+ * reader_line().  Returns the length of the line, 0 on end-of-file,
+ * or -1 on error. */
+static
+ssize_t reader_getline(struct qp_reader *rd, char **line)
+{
+  size_t len;
 
-  if(qp_rd->buf[i] == '\n')
+  while(!(*line = reader_line(rd, &len)))
   {
-    i -= qp_rd->rd;
-    ++i; /* copy the '\n' too */
-    if(*n < i + 1)
-      *lineptr = qp_realloc(*lineptr, i + 1);
-    memcpy(*lineptr, &qp_rd->buf[qp_rd->rd], i);
-    qp_rd->rd += i;
-    (*lineptr)[i] = '\0';
-    *n = i + 1;
-    return i;
+    if(rd->eof)
+      return 0;
+    if(reader_fill(rd) == -1)
+      return -1;
   }
-  
-  /* i == qp_rd->len  && qp_rd->buf[i] != '\n' */
+  return len;
+}
+
+/* Seeks a regular file to offset and empties the buffer. */
+static inline
+off_t reader_lseek(struct qp_reader *rd, off_t offset)
+{
+  reader_release(rd);
+  if(rd->fd == -1 || lseek(rd->fd, offset, SEEK_SET) == -1)
+    return -1;
+  rd->offset = offset;
+  rd->start = rd->end = 0;
+  rd->eof = 0;
+  return offset;
+}
 
-  i -= qp_rd->rd; /* copy i bytes from the qp_rd buffer */
+/* Returns offset, or -1 if we cannot get there.  A pipe can go back
+ * as far as the bytes that are in the buffer. */
+static
+off_t reader_seek(struct qp_reader *rd, off_t offset)
+{
+  reader_release(rd);
 
-  if(*n < i + 1)
+  if(offset >= rd->offset && offset <= rd->offset + (off_t) rd->end)
   {
-    *n = i + 1 + 128;
-    *lineptr = qp_realloc(*lineptr, *n);
+    rd->start = offset - rd->offset;
+    return offset;
   }
-  memcpy(*lineptr, &qp_rd->buf[qp_rd->rd], i);
-  qp_rd->rd = qp_rd->len;
-  
-  /* Now we need to read the file until '\n' or EOF */
 
-  c = getc(file);
-  while(c != EOF)
+  if(!rd->is_pipe)
+    return reader_lseek(rd, offset);
+
+  if(offset < rd->offset)
+    return -1;
+
+  /* read the pipe up to offset */
+  while(rd->offset + (off_t) rd->end < offset)
   {
-    (*lineptr)[i++] = c;
-    /* we now have i chars in *lineptr */
-    if(*n == i + 1)
-      *lineptr = qp_realloc(*lineptr , (*n += 128));
-    if(c == '\n')
-      break;
-    c = getc(file);
+    rd->start = rd->end;
+    if(reader_fill(rd) < 1)
+      return -1;
   }
-  (*lineptr)[i] = '\0';
-
-  return i;
+  rd->start = offset - rd->offset;
+  return offset;
 }
 
+/* libsndfile reads the file through the reader buffer with these. */
 
 static
-int read_ascii(qp_source_t source, struct qp_reader *rd)
+sf_count_t vio_get_filelen(void *data)
 {
-  char *line = NULL;
-  size_t line_buf_len = 0;
-  ssize_t n;
-  size_t line_count = 0;
-  int (*parse_line)(struct qp_source *source,
-      char *line);
-  int data_flag = -1;
+  struct qp_reader *rd;
+  struct stat st;
+
+  rd = (struct qp_reader *) data;
+  if(!rd->is_pipe && !fstat(rd->fd, &st))
+    return st.st_size;
+  /* We cannot know how long a pipe is. */
+  return SF_COUNT_MAX;
+}
 
-  /* TODO: check for other types */
-  source->value_type = QP_TYPE_DOUBLE;
+static
+sf_count_t vio_seek(sf_count_t offset, int whence, void *data)
+{
+  struct qp_reader *rd;
+  rd = (struct qp_reader *) data;
 
-  switch(source->value_type)
+  switch(whence)
   {
-    /* TODO: brake these cases up into
-     * other data parsers. */
-    case QP_TYPE_DOUBLE:
-
-      parse_line = qp_source_parse_doubles;
+    case SEEK_SET:
       break;
-
-  /* TODO: add other cases */
-
-    default:
-      ASSERT(0);
+    case SEEK_CUR:
+      offset += reader_tell(rd);
+      break;
+    case SEEK_END:
+      if(rd->is_pipe)
+        return -1;
+      offset += vio_get_filelen(data);
       break;
+    default:
+      return -1;
   }
 
-  if(app->op_skip_lines)
+  return reader_seek(rd, offset);
+}
+
+static
+sf_count_t vio_read(void *ptr, sf_count_t count, void *data)
+{
+  struct qp_reader *rd;
+  sf_count_t n = 0;
+
+  rd = (struct qp_reader *) data;
+
+  while(n < count)
   {
-    size_t skip_lines;
-    skip_lines = app->op_skip_lines;
+    size_t len;
+    if(rd->start == rd->end && (rd->eof || reader_fill(rd) < 1))
+      break;
+    len = rd->end - rd->start;
+    if(len > (size_t) (count - n))
+      len = count - n;
+    memcpy(((char *) ptr) + n, rd->buf + rd->start, len);
+    rd->start += len;
+    n += len;
+  }
+  return n;
+}
 
-    while(skip_lines--)
-    {
-      errno = 0;
-      n = Getline(&line, &line_buf_len, rd->file);
+static
+sf_count_t vio_write(const void *ptr, sf_count_t count, void *data)
+{
+  return 0; /* we only read */
+}
 
-      ++line_count;
+static
+sf_count_t vio_tell(void *data)
+{
+  return reader_tell((struct qp_reader *) data);
+}
 
-      if(n == -1 || errno)
-      {
-        if(!errno)
-        {
-          /* end-of-file so it is zero length */
-          WARN("getline() read no data in file %s\n",
-            source->name);
-          QP_WARN("read no data in file %s\n",
-            source->name);
-        }
-        else
-        {
-          EWARN("getline() read no data in file %s\n",
-            source->name);
-          QP_EWARN("read no data in file %s\n",
-            source->name);
-        }
+static
+SF_VIRTUAL_IO reader_vio =
+{ vio_get_filelen, vio_seek, vio_read, vio_write, vio_tell };
 
-        if(line)
-          free(line);
-        return 1; /* error */
-      }
-    }
-  }
 
-#define CHUNK 16
+/* The most bytes we read from a pipe before we let the
+ * GLib main loop do other things */
+#define READER_MAX_BYTES  (1024*1024)
 
-  if(app->op_labels)
-  {
-    char *s, *sep;
-    size_t sep_len, num_labels = 0, mem_len = CHUNK;
+/* A source that is read from a pipe, or from a file that we follow,
+ * keeps reading the values as they come in, after the source and its
+ * graphs are made.  We are a GSource in the GLib main loop, like
+ * struct qp_shell. */
+struct qp_source_reader
+{
+  GSource gsource; /* We inherit GSource. */
+  GPollFD fd;
+  /* the file that we read, which we own now */
+  struct qp_reader rd;
+  guint tag;
+  /* If we follow a file, fd polls this inotify(7) file
+   * descriptor and not the file; else this is -1. */
+  int inotify_fd;
 
-    source->labels = qp_malloc(sizeof(char *)*(mem_len+1));
+  struct qp_source *source;
 
-    errno = 0;
-    n = Getline(&line, &line_buf_len, rd->file);
+  /* We parse into this and not source so that the value channels
+   * line up with the values in the lines, even after source
+   * prepends a linear channel or removes channels.  data.channels
+   * are copies of the source channels that we append to, and the
+   * channels that we add when lines have more values. */
+  struct qp_source data;
+  /* The number of data.channels that source has copies of */
+  size_t num_shown_channels;
+  /* The linear channel that source prepended, or NULL */
+  struct qp_channel *linear;
+
+  /* If set there may be whole lines in the rd buffer, which
+   * poll() will not tell us about. */
+  int check_file;
+
+  guint redraw_tag; /* timeout to redraw, or 0 */
+  gint64 redraw_time; /* when we last redrew */
+};
 
-    ++line_count;
+/* Gets c in sync with the channel it is a copy of, returning 1,
+ * or returns 0 if c is not from this reader. */
+static inline
+int reader_sync_channel(struct qp_source_reader *r, struct qp_channel *c)
+{
+  struct qp_channel **w;
 
-    if(n == -1 || errno)
-    {
-      if(!errno)
-      {
-        /* end-of-file so it is zero length */
-        WARN("getline() read no data in file %s\n",
-          source->name);
-        QP_WARN("read no data in file %s\n",
-          source->name);
-      }
-      else
-      {
-        EWARN("getline() read no data in file %s\n",
-          source->name);
-        QP_EWARN("read no data in file %s\n",
-          source->name);
-      }
+  if(!c || !qp_channel_is_indexed(c))
+    return 0;
 
-      if(line)
-          free(line);
-        return 1; /* error */
-    }
+  if(r->linear && qp_channel_equals(c, r->linear))
+  {
+    if(c != r->linear)
+      qp_channel_series_sync(c, r->linear);
+    return 1;
+  }
 
-    s = line;
-    sep = app->op_label_separator;
-    sep_len = strlen(sep);
-    
-    do
+  for(w = r->data.channels; *w; ++w)
+    if(qp_channel_equals(c, *w))
     {
-      char *end;
-      size_t len;
-      end = s;
-      /* find the next separator */
-      end = s;
-      while(*end && *end != '\n' && *end != '\r' &&
-          strncmp(end, sep, sep_len))
-        ++end;
+      if(c != *w)
+        qp_channel_series_sync(c, *w);
+      return 1;
+    }
+  return 0;
+}
 
-      /* *end == '\0' or end == "the separator" */
-      len = end - s;
-      /* get a label */
-      source->labels[num_labels] = qp_strndup(s, len);
-      ++num_labels;
+/* Appends the values that we have parsed to the channels and
+ * redraws the graphs that plot them. */
+static
+void reader_redraw(struct qp_source_reader *r)
+{
+  struct qp_source *source;
+  struct qp_channel **c;
+  struct qp_win *qp;
 
-      if(!(*end) || *end == '\n' || *end == '\r')
-        break;
+  source = r->source;
+  qp_source_parse_doubles_flush(&r->data);
+  r->redraw_time = g_get_monotonic_time();
 
-      /* skip the separator */
-      s = end + sep_len;
-      if(!(*s))
-        break;
+  if(r->data.num_values == source->num_values)
+    return;
 
-      if(num_labels == mem_len)
-      {
-        mem_len += CHUNK;
-        source->labels = qp_realloc(source->labels,
-            sizeof(char *)*(mem_len+1));
-      }
+  if(r->num_shown_channels < r->data.num_channels)
+  {
+    /* Lines with more values gave us more channels */
+    for(; r->num_shown_channels < r->data.num_channels;
+        ++r->num_shown_channels)
+    {
+      struct qp_channel *w;
+      w = r->data.channels[r->num_shown_channels];
+      qp_channel_series_set_growing(w);
+      ++source->num_channels;
+      source->channels = (struct qp_channel **)
+        qp_realloc(source->channels,
+            (source->num_channels+1)*sizeof(struct qp_channel*));
+      source->channels[source->num_channels-1] =
+        qp_channel_series_create(w, 0);
+      source->channels[source->num_channels] = NULL;
+    }
+    qp_app_graph_detail_source_remake();
+  }
 
-    } while(*s);
+  source->num_values = r->data.num_values;
+  if(r->linear)
+    qp_channel_func_set_length(r->linear, source->num_values);
 
-    source->labels[num_labels] = NULL;
-    source->num_labels = num_labels;
-  }
-#undef CHUNK
+  for(c = source->channels; *c; ++c)
+    reader_sync_channel(r, *c);
 
-  do
+  for(qp=qp_sllist_begin(app->qps); qp; qp=qp_sllist_next(app->qps))
   {
-    /* we seperate the first read because it shows
-     * the error case when the file has no data at all. */
-    errno = 0;
-    n = Getline(&line, &line_buf_len, rd->file);
-
-    ++line_count;
-    if(n == -1 || errno)
+    struct qp_graph *gr;
+    for(gr=qp_sllist_begin(qp->graphs); gr; gr=qp_sllist_next(qp->graphs))
     {
-      if(!errno)
-      {
-        /* end-of-file so it is zero length */
-        WARN("getline() read no data in file %s\n",
-            source->name);
-        QP_WARN("read no data in file %s\n",
-            source->name);
-      }
-      else
+      struct qp_plot *p;
+      int grew = 0;
+      for(p=qp_sllist_begin(gr->plots); p; p=qp_sllist_next(gr->plots))
       {
-        EWARN("getline() read no data in file %s\n",
-            source->name);
-        QP_EWARN("read no data in file %s\n",
-            source->name);
-
+        int x, y;
+        x = reader_sync_channel(r, p->x);
+        y = reader_sync_channel(r, p->y);
+        if(!x && !y)
+          continue;
+        grew = 1;
+        if(p->x_picker)
+        {
+          size_t len;
+          reader_sync_channel(r, p->x_picker);
+          reader_sync_channel(r, p->y_picker);
+          p->num_points = qp_channel_series_length(p->x_picker);
+          len = qp_channel_series_length(p->y_picker);
+          if(p->num_points > len)
+            p->num_points = len;
+        }
       }
-      if(line)
-        free(line);
-      return 1; /* error */
+      if(grew)
+        qp_graph_update(gr);
     }
-    data_flag = parse_line(source, line);
-  } while(data_flag == 0);
+  }
+}
 
-  /* Now we have an least one line of values.
-   * We would have returned if we did not. */
+static
+gboolean reader_redraw_callback(gpointer data)
+{
+  struct qp_source_reader *r;
+  r = (struct qp_source_reader *) data;
+  r->redraw_tag = 0;
+  reader_redraw(r);
+  return FALSE;
+}
 
-  errno = 0;
-  while((n = Getline(&line, &line_buf_len, rd->file)) > 0)
-  {
-    ++line_count;
-    parse_line(source, line);
-    errno = 0;
-  }
+/* Redraws now or later so that we redraw at most
+ * app->op_redraw_rate times a second. */
+static inline
+void reader_schedule_redraw(struct qp_source_reader *r)
+{
+  gint64 wait;
 
-  if(line)
-    free(line);
+  if(r->redraw_tag)
+    /* we will redraw soon */
+    return;
 
-  /* n == -1 and errno == 0 on end-of-file */
-  if((n == -1 && errno != 0) || errno)
-  {
-#if QP_DEBUG
-    if(errno)
-      EWARN("getline() failed to read file %s\n",
-          source->name);
-    else
-      WARN("getline() failed to read file %s\n",
-          source->name);
-#endif
-    QP_WARN("failed to read file %s\n", source->name);
-    return 1; /* error */
-  }
+  wait = r->redraw_time - g_get_monotonic_time() +
+    ((app->op_redraw_rate > 0)?(1000000/app->op_redraw_rate):1000000);
 
-  return 0; /* success */
+  if(wait <= 0)
+    reader_redraw(r);
+  else
+    r->redraw_tag = g_timeout_add(wait/1000 + 1,
+        reader_redraw_callback, r);
 }
 
-/* returns an allocated string */
-static char *unique_name(const char *name)
+static
+void reader_destroy(struct qp_source_reader *r)
 {
-  size_t num = 1, len = 0;
-  char *buf = NULL;
-  ASSERT(name && name[0]);
-  ASSERT(name[strlen(name)-1] != DIR_CHAR);
+  struct qp_channel **c;
 
-  if(name[0] == '-' && !name[1])
-  {
-    name = "stdin";
-    /* Sometimes the user wants to know why the
-     * program is just hanging.  It is hanging
-     * because it is waiting for input from the
-     * terminal? */
-    QP_NOTICE("Reading stdin\n");
-  }
+  ASSERT(r);
+  ASSERT(r->source->reader == r);
+
+  if(r->redraw_tag)
+    g_source_remove(r->redraw_tag);
+
+  qp_source_parse_doubles_flush(&r->data);
+  for(c = r->data.channels; *c; ++c)
+    qp_channel_destroy(*c);
+  free(r->data.channels);
+  if(r->data.select)
+    free(r->data.select);
+
+  if(r->rd.fd != STDIN_FILENO)
+    close(r->rd.fd);
+  if(r->rd.buf)
+    free(r->rd.buf);
+
+  r->source->reader = NULL;
+
+  g_source_remove_poll(&r->gsource, &r->fd);
+  if(r->inotify_fd != -1)
+    close(r->inotify_fd);
+  g_source_destroy(&r->gsource);
+  g_source_unref(&r->gsource);
+}
+
+static
+gboolean reader_prepare(GSource *gsource, gint *timeout)
+{
+  *timeout = -1; /* block */
+  return ((struct qp_source_reader *) gsource)->check_file;
+}
+
+static
+gboolean reader_check(GSource *gsource)
+{
+  struct qp_source_reader *r;
+  r = (struct qp_source_reader *) gsource;
+  return (r->check_file ||
+      (r->fd.revents & (G_IO_IN | G_IO_HUP | G_IO_ERR)));
+}
+
+/* If the file we follow got shorter, like from `cp /dev/null FILE' or
+ * logrotate copytruncate, we start reading it from the top again,
+ * like tail -f does. */
+static inline
+void follow_check_truncate(struct qp_source_reader *r)
+{
+  struct stat st;
+
+  if(fstat(r->rd.fd, &st) ||
+      st.st_size >= r->rd.offset + (off_t) r->rd.end)
+    return;
 
+  QP_NOTICE("file %s was truncated, reading from the top\n",
+      r->source->name);
+  /* This drops the line that had no '\n' too. */
+  if(reader_lseek(&r->rd, 0) == -1)
+    QP_EWARN("failed to seek to the top of file %s\n", r->source->name);
+}
+
+static
+gboolean reader_dispatch(GSource *gsource, GSourceFunc callback,
+    gpointer data)
+{
+  struct qp_source_reader *r;
+  size_t count = 0, len;
+  ssize_t n = 1;
+  char *line;
 
+  r = (struct qp_source_reader *) gsource;
+  r->check_file = 0;
+
+  if(r->inotify_fd != -1)
   {
-    /* we use just the base name without the directory part */
-    char *s;
-    s = (char *) &name[strlen(name)-1];
-    while(s != name && *s != DIR_CHAR)
-      --s;
-    if(*s == DIR_CHAR)
-      ++s;
-    buf = (char *) (name = qp_strdup(s));
+    /* We do not care what the events are, just that the file
+     * changed, so we read them all and see what is in it. */
+    char buf[1024];
+    while(read(r->inotify_fd, buf, sizeof(buf)) > 0);
+    follow_check_truncate(r);
   }
 
-  while(1)
+  while(count < READER_MAX_BYTES)
   {
-    struct qp_source *s;
-    for(s=(struct qp_source*) qp_sllist_begin(app->sources);
-        s;
-        s=(struct qp_source*) qp_sllist_next(app->sources))
-      if(strcmp(s->name, buf) == 0)
-        break;
-    if(s)
+    if((line = reader_line(&r->rd, &len)))
     {
-      ++num;
-      if(buf == name)
-        buf = (char*) qp_malloc(len= strlen(buf)+16);
-      snprintf(buf, len, "%s(%zu)", name, num);
+      qp_source_parse_doubles(&r->data, line);
+      count += len;
+      continue;
     }
-    else
+    /* At end-of-file reader_line() gives us the last line, if it
+     * had no '\n', on the next time around. */
+    if(r->rd.eof || (n = reader_fill(&r->rd)) == -1)
+      break;
+  }
+
+  if(count >= READER_MAX_BYTES)
+    /* There may be more lines in the buffer. */
+    r->check_file = 1;
+  else if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    /* We read all there is for now. */
+    ;
+  else if(n != -1 && r->inotify_fd != -1)
+    /* We read to the end of the file we follow, for now.  Any
+     * line without a '\n' waits in the buffer for the rest of it. */
+    r->rd.eof = 0;
+  else
+  {
+    /* end of file or an error */
+    if(n == -1)
+      QP_EWARN("failed to read %s\n", r->source->name);
+    reader_redraw(r);
+    INFO("finished reading %zu sets of values from %s\n",
+        r->source->num_values, r->source->name);
+    reader_destroy(r);
+    return FALSE;
+  }
+
+  reader_schedule_redraw(r);
+  return TRUE;
+}
+
+static
+GSourceFuncs reader_funcs =
+{ reader_prepare, reader_check, reader_dispatch, NULL, NULL, NULL };
+
+/* Makes the source keep reading the pipe in rd as the data comes in
+ * from the GLib main loop, starting with what is in the rd buffer
+ * that is not read yet.  If rd is a regular file that we follow we
+ * read what is appended to it.  The source reader takes the file
+ * and the buffer from rd. */
+static
+void reader_create(qp_source_t source, struct qp_reader *rd)
+{
+  struct qp_source_reader *r;
+  struct qp_channel **c;
+  size_t i;
+  int inotify_fd = -1;
+
+  ASSERT(!source->reader);
+  ASSERT(rd->is_pipe || rd->follow);
+
+  if(!rd->is_pipe)
+  {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd == -1 ||
+        inotify_add_watch(inotify_fd, rd->filename, IN_MODIFY) == -1)
     {
-      if(buf != name)
-        free((char*)name);
-      return buf;
+      EWARN("inotify failed to watch file %s\n", rd->filename);
+      QP_EWARN("%sFailed to follow file%s %s%s%s\n",
+          bred, trm, btur, rd->filename, trm);
+      if(inotify_fd != -1)
+        close(inotify_fd);
+      return;
     }
   }
+
+  /* append the values that the parser is holding */
+  qp_source_parse_doubles_flush(source);
+
+  r = (struct qp_source_reader *) g_source_new(&reader_funcs, sizeof(*r));
+  r->rd = *rd;
+  rd->buf = NULL;
+  rd->fd = -1;
+  r->inotify_fd = inotify_fd;
+  r->fd.fd = (inotify_fd != -1)?inotify_fd:r->rd.fd;
+  r->fd.events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+  r->fd.revents = 0;
+  r->source = source;
+  r->linear = NULL;
+  /* the lines that are in the buffer go first */
+  r->check_file = 1;
+  r->redraw_tag = 0;
+  r->redraw_time = g_get_monotonic_time();
+
+  memset(&r->data, 0, sizeof(r->data));
+  r->data.name = source->name;
+  r->data.value_type = source->value_type;
+  r->data.num_values = source->num_values;
+  r->data.num_channels = source->num_channels;
+  r->data.arena = source->arena;
+  if(source->select)
+  {
+    /* The source select is cut to the channels that it has
+     * after the first lines are read, so we keep our own. */
+    for(i=0; source->select[i] != QP_SELECT_END; ++i);
+    r->data.select = (size_t *) qp_malloc(sizeof(size_t)*(i+1));
+    memcpy(r->data.select, source->select, sizeof(size_t)*(i+1));
+  }
+  /* The filter goes on from where read_ascii() left it. */
+  r->data.filter = source->filter;
+  r->data.filter_state = source->filter_state;
+  r->data.channels = (struct qp_channel **)
+    qp_malloc((source->num_channels+1)*sizeof(struct qp_channel *));
+  for(i=0, c = source->channels; *c; ++c, ++i)
+  {
+    qp_channel_series_set_growing(*c);
+    r->data.channels[i] = qp_channel_series_create(*c, 0);
+  }
+  r->data.channels[i] = NULL;
+  r->num_shown_channels = i;
+
+  source->reader = r;
+
+  if(r->rd.is_pipe)
+  {
+    int flags;
+    flags = fcntl(r->fd.fd, F_GETFL);
+    if(flags == -1 || fcntl(r->fd.fd, F_SETFL, flags | O_NONBLOCK))
+      QP_EWARN("fcntl(fd=%d, F_SETFL, O_NONBLOCK) failed\n", r->fd.fd);
+  }
+
+  /* This is lower priority than drawing, like the shell. */
+  g_source_set_priority(&r->gsource, G_PRIORITY_LOW);
+  r->tag = g_source_attach(&r->gsource, NULL);
+  VASSERT(r->tag > 0, "g_source_attach() failed\n");
+  g_source_add_poll(&r->gsource, &r->fd);
+
+  DEBUG("reading %s %s as values come in\n",
+      (inotify_fd != -1)?"file":"pipe", source->name);
+}
+
+/* Tells the main thread how much of the file this loading thread
+ * has read.  Returns 1 if the load is canceled. */
+static inline
+int load_progress(size_t count)
+{
+  if(!qp_ld)
+    return 0;
+  __atomic_store_n(&qp_ld->count, count, __ATOMIC_RELAXED);
+  return __atomic_load_n(&qp_ld->cancel, __ATOMIC_RELAXED);
 }
 
+int qp_source_load_progress(size_t count)
+{
+  return load_progress(count);
+}
 
 static inline
-struct qp_source *
-make_source(const char *filename, int value_type)
+void load_total(size_t total)
 {
-  qp_app_check();
-  ASSERT(filename && filename[0]);
-  struct qp_source *source;
-  source = (struct qp_source *)
-    qp_malloc(sizeof(struct qp_source));
-  source->name = unique_name(filename);
-  source->num_values = 0;
-  source->value_type = (value_type)?value_type:QP_TYPE_DOUBLE;
-  source->num_channels = 0;
-  source->labels = NULL;
-  source->num_labels = 0;
-  /* NULL terminated array on channels */
-  source->channels = qp_malloc(sizeof(struct qp_channel *));
-  *(source->channels) = NULL;
-  qp_sllist_append(app->sources, source);
+  if(qp_ld)
+    __atomic_store_n(&qp_ld->total, total, __ATOMIC_RELAXED);
+}
 
-  return source;
+static inline
+int load_canceled(void)
+{
+  return (qp_ld && __atomic_load_n(&qp_ld->cancel, __ATOMIC_RELAXED));
 }
 
-/* Returns 0 if the file is read as a libsndfile
- * Returns 1 is not.
- * Returns -1 and spews if we have a system read error */
+/* Returns 1 if the rest of the rows are past the end of the
+ * --x-range, so we do not read them. */
+static inline
+int past_x_range(const struct qp_source *source)
+{
+  return (source->filter &&
+      source->filter_state.end_rows != QP_FILTER_NO_END);
+}
+
+/* Regular files with more than this much text after the first line
+ * of values are parsed with a thread for each processor. */
+#define PARALLEL_MIN_SIZE     ((off_t) 4*1024*1024)
+/* About how much text each thread parses at a time */
+#define PARALLEL_BLOCK        ((size_t) 8*1024*1024)
+#define PARALLEL_MAX_THREADS  (32)
+
+struct parse_job
+{
+  pthread_t thread;
+  int joinable;
+  const char *begin, *end;
+  struct qp_columns cols;
+};
+
 static
-int read_sndfile(struct qp_source *source, struct qp_reader *rd)
+void *parse_job_thread(void *data)
 {
-  double *x, rate;
-  size_t count;
-  SNDFILE *file;
-  SF_INFO info;
-  size_t skip_lines;
+  struct parse_job *job;
+  job = data;
+  qp_source_parse_doubles_range(&job->cols, job->begin, job->end);
+  return NULL;
+}
 
-  skip_lines = app->op_skip_lines;
+/* returns the start of the line after the one that p is in */
+static inline
+const char *next_line(const char *p, const char *end)
+{
+  const char *nl;
+  if(p >= end)
+    return end;
+  nl = memchr(p, '\n', end - p);
+  return (nl)?(nl + 1):end;
+}
 
-  file = sf_open_fd(rd->fd, SFM_READ, &info, 0);
-  if(!file)
-  {
-    QP_INFO("file \"%s\" is not readable by libsndfile\n",
-        rd->filename);
-    return 1; /* not a libsndfile */
-  }
-  else if(info.frames < skip_lines)
+/* Parses the rest of the regular file in rd, from offset, with
+ * threads that each parse a range of whole lines into their own
+ * columns.  The columns are appended to the channels in file order
+ * so we get the same channels as we do parsing one line at a time.
+ * Returns 0 on success, 1 on error, and -1 if the file is not one
+ * that we do this with and nothing was read. */
+static
+int read_ascii_parallel(qp_source_t source, struct qp_reader *rd,
+    off_t offset)
+{
+  struct parse_job *job;
+  struct stat st;
+  const char *map, *p, *end;
+  long num_threads, page_size;
+  int i, err = 0;
+
+  if(rd->is_pipe || fstat(rd->fd, &st) || !S_ISREG(st.st_mode) ||
+      st.st_size - offset < PARALLEL_MIN_SIZE)
+    return -1;
+
+  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if(num_threads < 2)
+    return -1;
+  if(num_threads > PARALLEL_MAX_THREADS)
+    num_threads = PARALLEL_MAX_THREADS;
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, rd->fd, 0);
+  if(map == MAP_FAILED)
   {
-    QP_INFO("file \"%s\" is readable by libsndfile with %"PRId64
-        " samples which is less the lines to skip from --skip-lines=%zu\n",
-        rd->filename, info.frames, skip_lines);
-    return -1; /* error */
+    EWARN("mmap() file %s failed\n", source->name);
+    return -1;
   }
+  madvise((void *) map, st.st_size, MADV_SEQUENTIAL);
 
+  DEBUG("parsing %s with %ld threads\n", source->name, num_threads);
 
-  rate = info.samplerate;
-  x = qp_malloc(sizeof(double)*(info.channels+1));
-
-  source->num_channels = info.channels+1;
-  source->channels = qp_realloc(source->channels,
-        sizeof(struct qp_channel *)*(info.channels+2));
-  source->channels[source->num_channels] = NULL;
-  source->value_type = QP_TYPE_DOUBLE;
+  /* append the values that the parser is holding */
+  qp_source_parse_doubles_flush(source);
 
-  /* use count as dummy index for now */
-  for(count=0; count<source->num_channels; ++count)
-    source->channels[count] =
-      qp_channel_create(QP_CHANNEL_FORM_SERIES, QP_TYPE_DOUBLE);
+  page_size = sysconf(_SC_PAGESIZE);
+  job = qp_malloc(sizeof(*job)*num_threads);
+  memset(job, 0, sizeof(*job)*num_threads);
+  for(i=0; i<num_threads; ++i)
+  {
+    job[i].cols.select = source->select;
+    job[i].cols.filter = source->filter;
+    qp_filter_state_init(&job[i].cols.filter_state);
+  }
+  p = map + offset;
+  end = map + st.st_size;
 
-  count = 0;
+  if(rd->follow)
+    /* The last line may not be all written yet, so the reader
+     * gets it from the file after we are done here. */
+    while(end > p && end[-1] != '\n')
+      --end;
 
-  while(1)
+  while(p < end && !past_x_range(source))
   {
-    int i;
+    const char *round_end;
+    size_t len, skip;
 
-    if(sf_readf_double(file, x, 1) < 1)
-      break;
+    len = num_threads*PARALLEL_BLOCK;
+    if(len > (size_t)(end - p))
+      len = end - p;
+    round_end = next_line(p + len - 1, end);
 
-    if(skip_lines)
+    for(i=0; i<num_threads; ++i)
     {
-      --skip_lines;
-      continue;
+      job[i].begin = (i)?job[i-1].end:p;
+      if(i == num_threads - 1)
+        job[i].end = round_end;
+      else
+        job[i].end = next_line(p + len*(i+1)/num_threads, round_end);
+      job[i].joinable = !pthread_create(&job[i].thread, NULL,
+          parse_job_thread, &job[i]);
+      if(!job[i].joinable)
+        /* parse it in this thread */
+        parse_job_thread(&job[i]);
+    }
+
+    /* Stitch them together in order while the later ones may
+     * still be parsing. */
+    for(i=0; i<num_threads; ++i)
+    {
+      if(job[i].joinable)
+        pthread_join(job[i].thread, NULL);
+      if(source->filter)
+        /* This cuts the rows after the end of the --x-range. */
+        qp_filter_join(&source->filter_state, &job[i].cols.filter_state,
+            &job[i].cols.num_rows);
+      qp_source_append_columns(source, &job[i].cols);
+      qp_columns_free(&job[i].cols);
     }
 
-    /* TODO: use other channel types like load as shorts or ints */
+    /* We are done with these pages of the file. */
+    skip = ((size_t) p) % page_size;
+    madvise((void *)(p - skip), round_end - p + skip, MADV_DONTNEED);
 
-    qp_channel_series_double_append(source->channels[0], count/rate);
-    for(i=0;i<info.channels;++i)
-       qp_channel_series_double_append(source->channels[i+1], x[i]);
+    p = round_end;
 
-    ++count;
+    if(load_progress(p - map))
+    {
+      err = 1;
+      break;
+    }
   }
 
-  source->num_values = count;
-  free(x);
-  sf_close(file);
+  free(job);
 
-  if(count)
+  if(rd->follow && reader_lseek(rd, end - map) == -1)
   {
-    char label0[128];
-    snprintf(label0, 128, "time (1/%d sec)", info.samplerate);
-  
-    source->labels = qp_malloc(sizeof(char *)*2);
-    source->labels[0] = qp_strdup(label0);
-    source->labels[1] = NULL;
-    source->num_labels = 1;
+    EWARN("lseek() file %s failed\n", source->name);
+    QP_EWARN("failed to read file %s\n", source->name);
+    err = 1;
+  }
 
-    DEBUG("read\nlibsndfile \"%s\" with %d sound channel(s), "
-        "at rate %d Hz with %zu values, %g seconds of sound\n",
-        rd->filename,
-        info.channels, info.samplerate,
-        count, count/rate);
-    return 0; /* success */
+  if(munmap((void *) map, st.st_size))
+  {
+    EWARN("munmap() file %s failed\n", source->name);
+    QP_EWARN("failed to read file %s\n", source->name);
+    err = 1;
   }
 
-  QP_WARN("No sound data found in file \"%s\"\n", rd->filename);
-  return -1; /* fail no data in file, caller cleans up */
+  return err;
 }
 
-/* returns non-zero if fd is a pipe */
-static int is_pipe(struct qp_reader *rd)
+static
+int read_ascii(qp_source_t source, struct qp_reader *rd)
 {
-  struct stat st;
-  if(fstat(rd->fd, &st) == -1)
-  {
-    QP_ERROR("fstat() failed to stat file \"%s\"\n", rd->filename);
-    exit(1);
-  }
-  return (st.st_mode & S_IFIFO);
-}
+  char *line = NULL;
+  ssize_t n;
+  size_t line_count = 0;
+  int (*parse_line)(struct qp_source *source,
+      char *line);
+  int data_flag = -1;
+  off_t offset = 0; /* bytes read from the file */
+  off_t data_offset = 0; /* where the first line of values is */
+
+  /* All the value types are parsed as doubles and the
+   * channels store them as source->value_type. */
+  ASSERT(source->value_type == QP_TYPE_UNKNOWN ||
+      source->value_type == QP_TYPE_SHORT ||
+      source->value_type == QP_TYPE_INT ||
+      source->value_type == QP_TYPE_FLOAT ||
+      source->value_type == QP_TYPE_DOUBLE);
+  parse_line = qp_source_parse_doubles;
+
+  if(((rd->is_pipe && app->op_redraw_rate > 0) || rd->follow) &&
+      source->value_type == QP_TYPE_UNKNOWN)
+    /* The graphs will read the channels while we append to
+     * them, so the value type must not change. */
+    source->value_type = QP_TYPE_DOUBLE;
 
+  if(app->op_skip_lines)
+  {
+    size_t skip_lines;
+    skip_lines = app->op_skip_lines;
 
-qp_source_t qp_source_create(const char *filename, int value_type)
-{
-  struct qp_source *source;
-  struct qp_reader rd;
-  int r;
+    while(skip_lines--)
+    {
+      n = reader_getline(rd, &line);
 
-  source = make_source(filename, value_type);
+      ++line_count;
 
-  rd.fd = -1;
-  rd.rd = 0;
-  rd.len = 0;
-  rd.past = 0;
-  rd.file = NULL;
-  rd.buf = NULL;
-  rd.filename = (char *) filename;
-  qp_rd = &rd;
+      if(n < 1)
+      {
+        if(!n)
+        {
+          /* end-of-file so it is zero length */
+          WARN("read no data in file %s\n",
+            source->name);
+          QP_WARN("read no data in file %s\n",
+            source->name);
+        }
+        else
+        {
+          EWARN("read() failed in file %s\n",
+            source->name);
+          QP_EWARN("read no data in file %s\n",
+            source->name);
+        }
 
-  if(strcmp(filename,"-") == 0)
-  {
-    rd.file = stdin;
-    rd.fd = STDIN_FILENO;
+        return 1; /* error */
+      }
+      offset += n;
+    }
   }
 
-  if(rd.fd == -1)
-    rd.fd = open(filename, O_RDONLY);
+#define CHUNK 16
 
-  if(rd.fd == -1)
+  if(app->op_labels)
   {
-    EWARN("open(\"%s\",O_RDONLY) failed\n", filename);
-    QP_EWARN("%sFailed to open file%s %s%s%s\n",
-        bred, trm, btur, filename, trm);
-    goto fail;
-  }
+    char *s, *sep;
+    size_t sep_len, num_labels = 0, mem_len = CHUNK;
 
-  if(!is_pipe(&rd))
-  {
-    /* don't buffer read() and lseek() */
-    qp_rd = NULL;
+    source->labels = qp_malloc(sizeof(char *)*(mem_len+1));
+
+    n = reader_getline(rd, &line);
+
+    ++line_count;
+
+    if(n < 1)
+    {
+      if(!n)
+      {
+        /* end-of-file so it is zero length */
+        WARN("read no data in file %s\n",
+          source->name);
+        QP_WARN("read no data in file %s\n",
+          source->name);
+      }
+      else
+      {
+        EWARN("read() failed in file %s\n",
+          source->name);
+        QP_EWARN("read no data in file %s\n",
+          source->name);
+      }
+
+      return 1; /* error */
+    }
+    offset += n;
+
+    s = line;
+    sep = app->op_label_separator;
+    sep_len = strlen(sep);
+    
+    do
+    {
+      char *end;
+      size_t len;
+      end = s;
+      /* find the next separator */
+      end = s;
+      while(*end && *end != '\n' && *end != '\r' &&
+          strncmp(end, sep, sep_len))
+        ++end;
+
+      /* *end == '\0' or end == "the separator" */
+      len = end - s;
+      /* get a label */
+      source->labels[num_labels] = qp_strndup(s, len);
+      ++num_labels;
+
+      if(!(*end) || *end == '\n' || *end == '\r')
+        break;
+
+      /* skip the separator */
+      s = end + sep_len;
+      if(!(*s))
+        break;
+
+      if(num_labels == mem_len)
+      {
+        mem_len += CHUNK;
+        source->labels = qp_realloc(source->labels,
+            sizeof(char *)*(mem_len+1));
+      }
+
+    } while(*s);
+
+    source->labels[num_labels] = NULL;
+    source->num_labels = num_labels;
+  }
+#undef CHUNK
+
+  if(app->op_where || app->op_x_range)
+  {
+    if(!(source->filter = qp_filter_create(app->op_where,
+            app->op_x_range)))
+      return 1; /* error */
+    qp_filter_state_init(&source->filter_state);
+  }
+
+  if(app->op_columns && strcasecmp(app->op_columns, "all"))
+  {
+    char *list;
+    int err;
+
+    /* The columns that the filter looks at are read too. */
+    list = (source->filter)?
+      qp_filter_columns(source->filter, app->op_columns):
+      app->op_columns;
+    err = qp_source_select_columns(source, list);
+    if(list != app->op_columns)
+      free(list);
+    if(err)
+      return 1; /* error */
+  }
+
+  if(source->filter)
+    qp_filter_bind(source->filter, source->select);
+
+  do
+  {
+    /* we seperate the first read because it shows
+     * the error case when the file has no data at all. */
+    n = reader_getline(rd, &line);
+
+    ++line_count;
+    if(n < 1)
+    {
+      if(!n)
+      {
+        /* end-of-file so it is zero length */
+        WARN("read no data in file %s\n",
+            source->name);
+        QP_WARN("read no data in file %s\n",
+            source->name);
+      }
+      else
+      {
+        EWARN("read() failed in file %s\n",
+            source->name);
+        QP_EWARN("read no data in file %s\n",
+            source->name);
+
+      }
+      return 1; /* error */
+    }
+    data_offset = offset;
+    offset += n;
+    data_flag = parse_line(source, line);
+  } while(data_flag == 0 && !past_x_range(source));
+
+  if(data_flag == 0)
+  {
+    QP_WARN("no values in file %s are in --x-range %s\n",
+        source->name, app->op_x_range);
+    return 1; /* error */
+  }
+
+  /* Now we have an least one line of values.
+   * We would have returned if we did not. */
+
+  if(rd->is_pipe && !rd->compressed &&
+      (app->op_redraw_rate > 0 || rd->follow))
+  {
+    /* We read the rest of the pipe as it comes in. */
+    reader_create(source, rd);
+    return 0;
+  }
+
+  if(app->op_lazy && !rd->is_pipe && !rd->follow && !source->filter &&
+      !app->op_cache &&
+      (data_flag = qp_source_read_lazy(source, rd->fd, data_offset)) != -1)
+    /* The values are parsed again from the file as they are read,
+     * starting with the line we just parsed. */
+    return data_flag;
+
+  if((data_flag = read_ascii_parallel(source, rd, offset)) != -1)
+  {
+    if(!data_flag && rd->follow && !past_x_range(source))
+      /* We read what is appended to the file as it comes in. */
+      reader_create(source, rd);
+    return data_flag;
+  }
+
+  n = 0;
+  while(!past_x_range(source) && (n = reader_getline(rd, &line)) > 0)
+  {
+    /* If we follow the file, a line that is not all written yet
+     * stays in the buffer and we get end-of-file. */
+    ++line_count;
+    parse_line(source, line);
+    offset += n;
+    if(load_progress(offset))
+      break;
+  }
+
+  /* append the values that the parser is holding */
+  qp_source_parse_doubles_flush(source);
+
+  if(load_canceled())
+    return 1; /* canceled */
+
+  if(n == -1)
+  {
+    EWARN("read() failed to read file %s\n", source->name);
+    QP_WARN("failed to read file %s\n", source->name);
+    return 1; /* error */
+  }
+
+  if(rd->follow && !past_x_range(source))
+    /* We read what is appended to the file as it comes in,
+     * starting with the rest of the line that is in the buffer. */
+    reader_create(source, rd);
+
+  return 0; /* success */
+}
+
+/* returns an allocated string */
+static char *unique_name(const char *name)
+{
+  size_t num = 1, len = 0;
+  char *buf = NULL;
+  ASSERT(name && name[0]);
+  ASSERT(name[strlen(name)-1] != DIR_CHAR);
+
+  if(name[0] == '-' && !name[1])
+  {
+    name = "stdin";
+    /* Sometimes the user wants to know why the
+     * program is just hanging.  It is hanging
+     * because it is waiting for input from the
+     * terminal? */
+    QP_NOTICE("Reading stdin\n");
+  }
+
+
+  {
+    /* we use just the base name without the directory part */
+    char *s;
+    s = (char *) &name[strlen(name)-1];
+    while(s != name && *s != DIR_CHAR)
+      --s;
+    if(*s == DIR_CHAR)
+      ++s;
+    buf = (char *) (name = qp_strdup(s));
+  }
+
+  while(1)
+  {
+    struct qp_source *s;
+    for(s=(struct qp_source*) qp_sllist_begin(app->sources);
+        s;
+        s=(struct qp_source*) qp_sllist_next(app->sources))
+      if(strcmp(s->name, buf) == 0)
+        break;
+    if(!s && loaders)
+    {
+      /* and the sources that are still loading */
+      struct qp_loader *ld;
+      for(ld=(struct qp_loader*) qp_sllist_begin(loaders);
+          ld;
+          ld=(struct qp_loader*) qp_sllist_next(loaders))
+        if(strcmp(ld->source->name, buf) == 0)
+        {
+          s = ld->source;
+          break;
+        }
+    }
+    if(s)
+    {
+      ++num;
+      if(buf == name)
+        buf = (char*) qp_malloc(len= strlen(buf)+16);
+      snprintf(buf, len, "%s(%zu)", name, num);
+    }
+    else
+    {
+      if(buf != name)
+        free((char*)name);
+      return buf;
+    }
+  }
+}
+
+
+/* Sets source->value_type to the value type of all the
+ * channels or QP_TYPE_MULTIPLE if they are not all the same. */
+static inline
+void set_value_type(struct qp_source *source)
+{
+  struct qp_channel **c;
+  ASSERT(source->channels[0]);
+
+  source->value_type = source->channels[0]->value_type;
+  for(c = source->channels + 1; *c; ++c)
+    if((*c)->value_type != source->value_type)
+    {
+      source->value_type = QP_TYPE_MULTIPLE;
+      return;
+    }
+}
+
+/* name is allocated and is freed with the source */
+static inline
+struct qp_source *
+source_new(char *name, int value_type)
+{
+  struct qp_source *source;
+  source = (struct qp_source *)
+    qp_malloc(sizeof(struct qp_source));
+  source->name = name;
+  source->num_values = 0;
+  source->value_type = value_type;
+  source->num_channels = 0;
+  source->labels = NULL;
+  source->num_labels = 0;
+  /* NULL terminated array on channels */
+  source->channels = qp_malloc(sizeof(struct qp_channel *));
+  *(source->channels) = NULL;
+  source->arena = qp_arena_create();
+  source->batch = NULL;
+  source->batch_len = 0;
+  source->select = NULL;
+  source->filter = NULL;
+  source->reader = NULL;
+
+  return source;
+}
+
+static inline
+struct qp_source *
+make_source(const char *filename, int value_type)
+{
+  qp_app_check();
+  ASSERT(filename && filename[0]);
+  /* QP_TYPE_UNKNOWN lets the channels pick their value type */
+  return source_new(unique_name(filename),
+      (value_type)?value_type:app->op_value_type);
+}
+
+/* Frees a source that is not in app->sources. */
+static
+void source_free(struct qp_source *source)
+{
+  if(source->reader)
+    /* stop reading the pipe */
+    reader_destroy(source->reader);
+
+  if(loaders)
+  {
+    /* If this is the preview of a file that is still loading, the
+     * load stops and load_finish() drops what it read. */
+    struct qp_loader *ld;
+    for(ld = qp_sllist_begin(loaders); ld; ld = qp_sllist_next(loaders))
+      if(ld->preview == source)
+      {
+        ASSERT(ld->preview_shown);
+        ld->preview = NULL;
+        __atomic_store_n(&ld->cancel, 1, __ATOMIC_RELAXED);
+      }
+  }
+
+  {
+    struct qp_channel **c;
+    c = source->channels;
+    for(c=source->channels; *c; ++c)
+      qp_channel_destroy(*c);
+    free(source->channels);
+  }
+
+  /* read_ascii() flushes and frees the batch */
+  ASSERT(!source->batch);
+
+  if(source->select)
+    free(source->select);
+  if(source->filter)
+    qp_filter_destroy(source->filter);
+
+  /* This releases the arrays of values, unless a copy of
+   * a channel is still in use somewhere. */
+  qp_arena_unref(source->arena);
+
+  if(source->labels)
+  {
+    char **s;
+    for(s = source->labels; *s; ++s)
+    {
+      if(*s)
+        free(*s);
+    }
+    free(source->labels);
+  }
+
+  free(source->name);
+  free(source);
+}
+
+/* Adds the source that was read to app->sources and the menus. */
+static
+void source_publish(struct qp_source *source)
+{
+  qp_sllist_append(app->sources, source);
+
+  add_source_buffer_remove_menus(source);
+
+  qp_app_graph_detail_source_remake();
+  qp_app_set_window_titles();
+}
+
+/* Returns 0 if the file is read as a libsndfile
+ * Returns 1 is not.
+ * Returns -1 and spews if we have a system read error */
+/* number of frames we read from libsndfile at a time */
+#define SND_FRAMES  (4*1024)
+/* 8 and 16 bit samples are stored as shorts with this scale, so
+ * they read back as the same doubles that sf_readf_double() gives.
+ * The smallest short is our NAN, so a channel with a -32768 sample
+ * is changed to ints with the same scale when that is read. */
+#define SND_SHORT_SCALE  (32768.0)
+
+static
+int read_sndfile(struct qp_source *source, struct qp_reader *rd)
+{
+  double *x = NULL, *v, rate;
+  short *xs = NULL;
+  size_t count;
+  SNDFILE *file;
+  SF_INFO info;
+  size_t skip_lines;
+  int subformat, value_type;
+
+  skip_lines = app->op_skip_lines;
+
+  /* We keep what libsndfile reads, so that the text parser can
+   * read it again if this is not sound. */
+  rd->keep = 1;
+  memset(&info, 0, sizeof(info));
+  file = sf_open_virtual(&reader_vio, SFM_READ, &info, rd);
+  if(!file)
+  {
+    QP_INFO("file \"%s\" is not readable by libsndfile\n",
+        rd->filename);
+    return 1; /* not a libsndfile */
+  }
+  else if(info.frames < skip_lines)
+  {
+    QP_INFO("file \"%s\" is readable by libsndfile with %"PRId64
+        " samples which is less the lines to skip from --skip-lines=%zu\n",
+        rd->filename, info.frames, skip_lines);
+    return -1; /* error */
+  }
+
+  /* It is sound, so the buffer need not keep the top of the file. */
+  rd->keep = 0;
+
+  rate = info.samplerate;
+
+  /* Samples with 16 bits or less are read as shorts and kept as
+   * shorts, unless --value-type asks for another type.  That is a
+   * quarter of the memory of doubles. */
+  subformat = info.format & SF_FORMAT_SUBMASK;
+  value_type = source->value_type;
+  if((subformat == SF_FORMAT_PCM_16 || subformat == SF_FORMAT_PCM_S8 ||
+        subformat == SF_FORMAT_PCM_U8) &&
+      (value_type == QP_TYPE_UNKNOWN || value_type == QP_TYPE_SHORT))
+    value_type = QP_TYPE_SHORT;
+  else if(value_type == QP_TYPE_SHORT)
+    /* The values are from -1 to 1, so they need a float or double */
+    value_type = QP_TYPE_FLOAT;
+
+  /* the interleaved frames and the values for one channel */
+  if(value_type == QP_TYPE_SHORT)
+    xs = qp_malloc(sizeof(short)*info.channels*SND_FRAMES);
+  else
+    x = qp_malloc(sizeof(double)*info.channels*SND_FRAMES);
+  v = qp_malloc(sizeof(double)*SND_FRAMES);
+
+  source->num_channels = info.channels+1;
+  source->channels = qp_realloc(source->channels,
+        sizeof(struct qp_channel *)*(info.channels+2));
+  source->channels[source->num_channels] = NULL;
+
+  /* The time of each frame is computed from the sample rate when it
+   * is read, so it uses no memory for its values. */
+  source->channels[0] = qp_channel_linear_create(0, 1/rate);
+
+  /* use count as dummy index for now */
+  for(count=1; count<source->num_channels; ++count)
+  {
+    /* QP_TYPE_UNKNOWN starts as short and lets
+     * qp_channel_series_append_n() change the type if a value
+     * does not fit. */
+    source->channels[count] =
+      qp_channel_create(QP_CHANNEL_FORM_SERIES,
+          (value_type == QP_TYPE_SHORT)?QP_TYPE_UNKNOWN:value_type);
+    qp_channel_series_set_arena(source->channels[count], source->arena);
+    if(value_type == QP_TYPE_SHORT)
+      source->channels[count]->series.scale = SND_SHORT_SCALE;
+    if(app->op_compress_channels)
+      qp_channel_series_pack(source->channels[count]);
+  }
+
+  count = 0;
+  if(info.frames > 0 && info.frames != SF_COUNT_MAX)
+    load_total(info.frames);
+
+  while(1)
+  {
+    sf_count_t n, start = 0, j;
+    int i;
+
+    if(xs)
+      n = sf_readf_short(file, xs, SND_FRAMES);
+    else
+      n = sf_readf_double(file, x, SND_FRAMES);
+    if(n < 1)
+      break;
+
+    if(skip_lines)
+    {
+      if(skip_lines >= (size_t) n)
+      {
+        skip_lines -= n;
+        continue;
+      }
+      start = skip_lines;
+      skip_lines = 0;
+    }
+    n -= start;
+
+    for(i=0;i<info.channels;++i)
+    {
+      if(xs)
+        /* These are stored as the same shorts, or as ints if
+         * there is a -32768. */
+        for(j=0; j<n; ++j)
+          v[j] = xs[(start + j)*info.channels + i]/SND_SHORT_SCALE;
+      else
+        for(j=0; j<n; ++j)
+          v[j] = x[(start + j)*info.channels + i];
+      qp_channel_series_append_n(source->channels[i+1], v, n);
+    }
+
+    count += n;
+
+    if(load_progress(count + app->op_skip_lines))
+      break;
+  }
+
+  qp_channel_func_set_length(source->channels[0], count);
+
+  source->num_values = count;
+  if(x)
+    free(x);
+  if(xs)
+    free(xs);
+  free(v);
+  sf_close(file);
+
+  if(load_canceled())
+    return -1; /* canceled, caller cleans up */
+
+  if(count)
+  {
+    char label0[128];
+    snprintf(label0, 128, "time (1/%d sec)", info.samplerate);
+  
+    source->labels = qp_malloc(sizeof(char *)*2);
+    source->labels[0] = qp_strdup(label0);
+    source->labels[1] = NULL;
+    source->num_labels = 1;
+
+    DEBUG("read\nlibsndfile \"%s\" with %d sound channel(s), "
+        "at rate %d Hz with %zu values, %g seconds of sound\n",
+        rd->filename,
+        info.channels, info.samplerate,
+        count, count/rate);
+    return 0; /* success */
+  }
+
+  QP_WARN("No sound data found in file \"%s\"\n", rd->filename);
+  return -1; /* fail no data in file, caller cleans up */
+}
+
+/* returns non-zero if fd is a pipe */
+static int is_pipe(struct qp_reader *rd)
+{
+  struct stat st;
+  if(fstat(rd->fd, &st) == -1)
+  {
+    QP_ERROR("fstat() failed to stat file \"%s\"\n", rd->filename);
+    exit(1);
+  }
+  return (st.st_mode & S_IFIFO);
+}
+
+
+/* Checks the channels that were read into source and adds the
+ * linear channel.  The linear channel steps by stride rows for each
+ * row read.  Returns 0 on success or 1 if there are no good values. */
+static
+int source_finish(struct qp_source *source, const char *filename,
+    double stride)
+{
+  {
+    /* remove any channels that have very bad data */
+    struct qp_channel **c;
+    size_t i = 0, chan_num = 0;
+    ASSERT(source->channels);
+
+    if(source->select)
+    {
+      /* The lines may not have had all the columns we read. */
+      for(i=0; i<source->num_channels &&
+          source->select[i] != QP_SELECT_END; ++i);
+      source->select[i] = QP_SELECT_END;
+      i = 0;
+    }
+
+    c = source->channels;
+    while(c[i])
+    {
+      ASSERT(qp_channel_is_indexed(c[i]));
+      if(!is_good_double(c[i]->series.min) ||
+          !is_good_double(c[i]->series.max))
+      {
+        struct qp_channel **n;
+        
+        qp_channel_destroy(c[i]);
+
+        /* move of all pointers from c[i+1] back one */
+        for(n=&c[i]; *n;++n)
+          *n = *(n+1);
+
+        /* re-malloc copying and removing one */
+        source->channels = 
+          qp_realloc(source->channels, sizeof(struct qp_channel *)*
+              ((source->num_channels)--));
+
+        if(source->select)
+        {
+          size_t *sel;
+          for(sel=&source->select[i]; *sel != QP_SELECT_END; ++sel)
+            *sel = *(sel+1);
+        }
+        
+        /* reset c to the next one which is now at the
+         * same index */
+        c = source->channels;
+
+        QP_NOTICE("removed bad channel number %zu\n", chan_num);
+      }
+      else
+        ++i;
+      ++chan_num;
+    }
+    ASSERT(source->num_channels == i);
+  }
+  
+  
+  if(source->num_channels == 0)
+    return 1; /* error */
+
+
+  if(source->num_channels > 1)
+  {
+    /****** Check that there is at least one point in all the channels */
+    ssize_t i, num;
+    double *x;
+    num = source->num_values;
+    x = qp_malloc(sizeof(double)*source->num_channels);
+    for(i=0;i<source->num_channels;++i)
+      x[i] = qp_channel_series_begin(source->channels[i]);
+
+    while(num)
+    {
+      int found = 0;
+      for(i=0;i<source->num_channels;++i)
+        if(is_good_double(x[i]))
+          ++found;
+
+      if(found >= 2)
+        /* that means there is at least one x/y point
+         * in all the channels. */
+        break;
+
+      --num;
+      if(!num)
+        break;
+
+      for(i=0;i<source->num_channels;++i)
+        x[i] = qp_channel_series_next(source->channels[i]);
+    }
+
+    if(!num)
+    {
+      QP_WARN("Failed to find a good point in data from file \"%s\"\n",
+          filename);
+      return 1; /* error */
+    }
+  }
+
+  
+  if(source->num_channels == 0)
+    return 1; /* error */
+
+
+  if(app->op_linear_channel || source->num_channels == 1)
+  {
+    /* Prepend a linear channel */
+
+    struct qp_channel *c, **new_channels;
+    double start = 0, step = 1;
+    size_t len, i;
+
+    if(app->op_linear_channel)
+    {
+      /* app->op_linear_channel just holds the start
+       * and step for all the sources we read. */
+      ASSERT(app->op_linear_channel->form == QP_CHANNEL_FORM_FUNC);
+      start = app->op_linear_channel->func.param[0];
+      step = app->op_linear_channel->func.param[1];
+    }
+    step *= stride;
+
+    /* The values are computed when they are read, so this
+     * channel uses no memory for its values. */
+    c = qp_channel_linear_create(start, step);
+    qp_channel_func_set_length(c, source->num_values);
+   
+    /* Prepend the channel to source->channels */
+    /* reuse dummy len */
+    len = source->num_channels + 1;
+    new_channels = qp_malloc(sizeof(c)*len+1);
+    new_channels[0] = c;
+    for(i=1;i<len;++i)
+      new_channels[i] = source->channels[i-1];
+    new_channels[i] = NULL;
+    free(source->channels);
+    source->channels = new_channels;
+    ++(source->num_channels);
+
+    if(source->reader)
+    {
+      /* It grows as the pipe is read. */
+      qp_channel_series_set_growing(c);
+      source->reader->linear = c;
+    }
+
+    if(source->labels && source->num_labels !=  source->num_channels)
+    {
+      // shift the labels and add the linear channel label
+      source->labels = qp_realloc(source->labels,
+          sizeof(char *)*(source->num_labels+2));
+      source->labels[source->num_labels+1] = NULL;
+      for(i=source->num_labels;i>=1;--i)
+        source->labels[i] = source->labels[i-1];
+
+      char s[128];
+      snprintf(s,128, "%s[0]", source->name);
+      // The first channel is the linear channel.
+      source->labels[0] = qp_strdup(s);
+      ++source->num_labels;
+    }
+  }
+
+  set_value_type(source);
+
+  {
+    char skip[64];
+    skip[0] = '\0';
+    if(app->op_skip_lines)
+      snprintf(skip, 64, "(after skipping %zu) ", app->op_skip_lines);
+
+
+    INFO("created source with %zu sets of values %s"
+      "in %zu channels from file %s with value type %s\n",
+      source->num_values, skip, source->num_channels,
+      filename, qp_channel_value_type_name(source->value_type));
+
+    QP_INFO("created source with %zu sets of "
+      "values %sin %zu channels from file \"%s\"\n",
+      source->num_values, skip, source->num_channels,
+      filename);
+
+    if(app->op_compress_channels)
+    {
+      struct qp_channel **c;
+      size_t bytes = 0;
+      for(c = source->channels; *c; ++c)
+        bytes += qp_channel_series_bytes(*c);
+      INFO("the values in source %s use %zu bytes compressed\n",
+          source->name, bytes);
+    }
+#if QP_DEBUG
+    if(source->labels)
+    {
+      char **labels;
+      APPEND("Read labels:");
+      for(labels = source->labels; *labels; ++labels)
+        APPEND(" \"%s\"", *labels);
+      APPEND("\n");
+    }
+#endif
+  }
+
+  return 0;
+}
+
+/* Reads the file into source.  This does not touch the widgets or
+ * app->sources, so the threads in qp_source_load() call it too.
+ * Returns 0 on success, or 1 if no data was loaded and the caller
+ * frees the source with source_free(). */
+static
+int source_read(struct qp_source *source, const char *filename, int follow)
+{
+  struct qp_reader rd;
+  struct qp_cache *cache = NULL;
+  int r, compressed;
+
+  reader_init(&rd, -1, filename, follow);
+
+  if(strcmp(filename,"-") == 0)
+    rd.fd = STDIN_FILENO;
+  else
+    rd.fd = open(filename, O_RDONLY);
+
+  if(rd.fd == -1)
+  {
+    EWARN("open(\"%s\",O_RDONLY) failed\n", filename);
+    QP_EWARN("%sFailed to open file%s %s%s%s\n",
+        bred, trm, btur, filename, trm);
+    goto fail;
+  }
+
+  if(!(rd.is_pipe = is_pipe(&rd)))
+  {
+    struct stat st;
+    if(qp_ld && !fstat(rd.fd, &st))
+      load_total(st.st_size);
+  }
+  else
+    DEBUG("Reading a pipe%s%s\n",
+        (filename[0] == '-' && filename[1] == '\0')?
+        "":" with name ",
+        (filename[0] == '-' && filename[1] == '\0')?
+        "":filename);
+
+  compressed = (rd.is_pipe)?QP_COMPRESS_NONE:qp_decompress_check(rd.fd);
+  if(compressed && follow)
+  {
+    QP_NOTICE("not following compressed file %s\n", filename);
+    follow = rd.follow = 0;
+  }
+
+  r = -1;
+  if(!compressed && (!rd.is_pipe || app->op_binary))
+    /* NumPy and --binary files are mapped, not read */
+    r = qp_source_read_binary(source, rd.fd, app->op_binary);
+  if(r == 1)
+    goto fail;
+
+  if(r && !rd.is_pipe && !follow && app->op_cache &&
+      (cache = qp_cache_create(source, filename, rd.fd)))
+    /* a snapshot of the text file that we parsed before */
+    r = qp_source_cache_read(source, cache);
+
+  if(r && compressed)
+  {
+    /* We read the decompressed file from a pipe, like it was
+     * piped from zcat. */
+    int fd;
+    if((fd = qp_decompress_start(rd.fd, compressed, filename)) == -1)
+      goto fail;
+    /* The thread closes the file. */
+    rd.fd = fd;
+    rd.is_pipe = 1;
+    rd.compressed = 1;
+    /* We do not know how many bytes it decompresses to. */
+    load_total(0);
+  }
+
+  if(r && (r = read_sndfile(source, &rd)))
+  {
+    if(r == -1)
+      goto fail;
+
+    /* It is not sound, so we parse it as text from the top, which
+     * is still in the buffer if the file is a pipe. */
+    if(reader_seek(&rd, 0))
+    {
+      EWARN("seek to the top of file \"%s\" failed\n", filename);
+      QP_EWARN("%sFailed to read file%s %s%s%s\n",
+          bred, trm, btur, filename, trm);
+      goto fail;
+    }
+    rd.keep = 0;
+
+    if(read_ascii(source, &rd))
+      goto fail;
+
+    if(cache)
+      qp_source_cache_write(source, cache);
   }
+
+  if(cache)
+  {
+    qp_cache_destroy(cache);
+    cache = NULL;
+  }
+
+  if(rd.buf)
+  {
+    free(rd.buf);
+    rd.buf = NULL;
+  }
+
+  if(source_finish(source, filename, 1.0))
+    goto fail;
+
+  if(strcmp(filename,"-") == 0)
+    /* We do not close stdin */
+    return 0;
+
+  if(source->reader)
+    /* The reader has the file now. */
+    return 0;
+
+  if(rd.fd != -1)
+    close(rd.fd);
+
+  return 0; /* success */
+
+fail:
+
+  if(load_canceled())
+    QP_NOTICE("Stopped loading file \"%s\"\n", filename);
   else
+    QP_WARN("No data loaded from file \"%s\"\n",
+        filename);
+
+  if(rd.buf)
+    free(rd.buf);
+
+  if(cache)
+    qp_cache_destroy(cache);
+
+  /* If there is a reader source_free() closes the file */
+  if(strcmp(filename,"-") != 0 && !source->reader && rd.fd != -1)
+    close(rd.fd);
+
+  return 1; /* error */
+}
+
+static
+qp_source_t source_create(const char *filename, int value_type, int follow)
+{
+  struct qp_source *source;
+
+  source = make_source(filename, value_type);
+
+  if(source_read(source, filename, follow))
+  {
+    source_free(source);
+    return NULL;
+  }
+
+  source_publish(source);
+
+  return source;
+}
+
+qp_source_t qp_source_create(const char *filename, int value_type)
+{
+  return source_create(filename, value_type, 0);
+}
+
+qp_source_t qp_source_create_follow(const char *filename, int value_type)
+{
+  return source_create(filename, value_type, 1);
+}
+
+/* milliseconds between status bar progress updates */
+#define LOAD_PROGRESS_PERIOD  (200)
+
+/* Text files with more than this many bytes get a preview */
+#define PREVIEW_MIN_SIZE  ((off_t) 64*1024*1024)
+/* The preview has these many blocks of lines from evenly spaced
+ * offsets in the file, with these many lines in each block. */
+#define PREVIEW_BLOCKS    (256)
+#define PREVIEW_LINES     (256)
+
+/* Reads a sample of the rows of a big text file into a new source,
+ * so that it can be graphed before the whole file is read.  We seek
+ * to evenly spaced offsets and read the lines after the first '\n'
+ * at each one.  Returns NULL if the file gets no preview. */
+static
+struct qp_source *read_preview(struct qp_loader *ld)
+{
+  struct qp_source *source;
+  struct qp_reader rd;
+  struct stat st;
+  SNDFILE *sf;
+  SF_INFO info;
+  uint8_t magic[6];
+  FILE *file, *mem;
+  char *buf = NULL, *line = NULL;
+  size_t buf_len = 0, line_len = 0, head_lines, head_len, num = 0;
+  off_t start, pos;
+  ssize_t n = 0;
+  int i, err;
+
+  /* NumPy, --binary and cached files are mapped, which is quick,
+   * and a sample may have no rows in the --x-range. */
+  if(app->op_binary || app->op_cache || app->op_x_range)
+    return NULL;
+
+  if(!(file = fopen(ld->filename, "r")))
+    return NULL;
+
+  if(fstat(fileno(file), &st) || !S_ISREG(st.st_mode) ||
+      st.st_size < PREVIEW_MIN_SIZE ||
+      qp_decompress_check(fileno(file)) ||
+      (pread(fileno(file), magic, 6, 0) == 6 &&
+       !memcmp(magic, "\x93NUMPY", 6)))
+  {
+    fclose(file);
+    return NULL;
+  }
+
+  memset(&info, 0, sizeof(info));
+  if((sf = sf_open(ld->filename, SFM_READ, &info)))
+  {
+    /* libsndfile reads it quickly enough */
+    sf_close(sf);
+    fclose(file);
+    return NULL;
+  }
+
+  mem = open_memstream(&buf, &buf_len);
+
+  /* the lines that are skipped, the labels and the first values */
+  head_lines = app->op_skip_lines + ((app->op_labels)?1:0) + 1;
+  while(head_lines-- && (n = getline(&line, &line_len, file)) > 0)
+    fwrite(line, 1, n, mem);
+  head_len = ftello(mem);
+
+  start = pos = ftello(file);
+
+  for(i=0; n > 0 && i<PREVIEW_BLOCKS; ++i)
+  {
+    off_t offset;
+    int j;
+
+    offset = start + (st.st_size - start)*i/PREVIEW_BLOCKS;
+    if(offset > pos)
+    {
+      /* skip to the start of the next line */
+      if(fseeko(file, offset, SEEK_SET) ||
+          getline(&line, &line_len, file) < 1)
+        break;
+    }
+
+    for(j=0; j<PREVIEW_LINES &&
+        (n = getline(&line, &line_len, file)) > 0; ++j)
+    {
+      fwrite(line, 1, n, mem);
+      if(line[n-1] != '\n')
+        fputc('\n', mem);
+      ++num;
+    }
+    pos = ftello(file);
+  }
+
+  fclose(file);
+  if(line)
+    free(line);
+  fclose(mem);
+
+  source = source_new(qp_strdup(ld->source->name),
+      ld->source->value_type);
+
+  /* The reader reads the lines from buf, which open_memstream()
+   * ended with a '\0'. */
+  reader_init(&rd, -1, ld->filename, 0);
+  rd.buf = buf;
+  rd.alloc = buf_len + 1;
+  rd.end = buf_len;
+  rd.eof = 1;
+
+  /* This is quick, so we do not tell the progress */
+  qp_ld = NULL;
+  err = (read_ascii(source, &rd) ||
+      /* The linear channel counts the rows in the whole file,
+       * about. */
+      source_finish(source, ld->filename, (buf_len > head_len)?
+        ((double) (st.st_size - start))/(buf_len - head_len):1.0));
+  qp_ld = ld;
+
+  free(buf);
+
+  if(err)
+  {
+    source_free(source);
+    return NULL;
+  }
+
+  DEBUG("made a preview of %s from %zu of its rows\n",
+      ld->filename, num);
+
+  return source;
+}
+
+static
+gboolean load_idle_callback(gpointer data);
+
+static
+void *load_thread(void *data)
+{
+  struct qp_loader *ld;
+  struct qp_source *preview;
+  ld = data;
+  qp_ld = ld;
+
+  if((preview = read_preview(ld)))
+  {
+    /* The main loop graphs it while we read the whole file. */
+    __atomic_store_n(&ld->preview, preview, __ATOMIC_RELEASE);
+    g_idle_add(load_idle_callback, NULL);
+  }
+
+  ld->err = source_read(ld->source, ld->filename, 0);
+
+  qp_ld = NULL;
+  __atomic_store_n(&ld->done, 1, __ATOMIC_RELEASE);
+  /* The main loop adds it to app->sources. */
+  g_idle_add(load_idle_callback, NULL);
+  return NULL;
+}
+
+/* Returns the channel in full that is in the place of the channel
+ * in source that c is a copy of, or NULL. */
+static inline
+struct qp_channel *refined_channel(struct qp_source *source,
+    struct qp_source *full, struct qp_channel *c)
+{
+  size_t i;
+  if(!c)
+    return NULL;
+  for(i=0; i<source->num_channels; ++i)
+    if(qp_channel_equals(c, source->channels[i]))
+      return (i < full->num_channels)?full->channels[i]:NULL;
+  return NULL;
+}
+
+/* Returns 1 if full has the same channels in the same places as
+ * the preview source.  They may not, like when a column has no good
+ * values in the rows of the preview, or the preview had just one
+ * column and got a linear channel. */
+static
+int same_layout(struct qp_source *source, struct qp_source *full)
+{
+  size_t i;
+
+  if(source->num_channels != full->num_channels ||
+      source->num_labels != full->num_labels)
+    return 0;
+  for(i=0; i<source->num_channels; ++i)
+    if(source->channels[i]->form != full->channels[i]->form)
+      return 0;
+  for(i=0; i<source->num_labels; ++i)
+    if(strcmp(source->labels[i], full->labels[i]))
+      return 0;
+  return 1;
+}
+
+/* Puts the channels of full in the preview source that is graphed,
+ * and frees full.  The graphs keep their zoom.  The channels must be
+ * in the same places, see same_layout(). */
+static
+void source_refine(struct qp_source *source, struct qp_source *full)
+{
+  struct qp_source old;
+  struct qp_win *qp;
+
+  for(qp=qp_sllist_begin(app->qps); qp; qp=qp_sllist_next(app->qps))
   {
-    /* this is a pipe */
-    DEBUG("Virturalizing a pipe%s%s\n",
-        (filename[0] == '-' && filename[1] == '\0')?
-        "":" with name ",
-        (filename[0] == '-' && filename[1] == '\0')?
-        "":filename);
-    rd.buf = qp_malloc(BUF_LEN);
+    struct qp_graph *gr;
+    for(gr=qp_sllist_begin(qp->graphs); gr; gr=qp_sllist_next(qp->graphs))
+    {
+      struct qp_plot *p;
+      int changed = 0;
+      for(p=qp_sllist_begin(gr->plots); p; p=qp_sllist_next(gr->plots))
+      {
+        struct qp_channel *x, *y;
+        x = refined_channel(source, full, p->x);
+        y = refined_channel(source, full, p->y);
+        if(!x && !y)
+          continue;
+        qp_plot_set_channels(p, (x)?x:p->x, (y)?y:p->y);
+        changed = 1;
+      }
+      if(changed)
+      {
+        gr->pixbuf_needs_draw = 1;
+        /* This rescales if it is not zoomed in. */
+        qp_graph_update(gr);
+      }
+    }
   }
 
-  if((r = read_sndfile(source, &rd)))
-  {
-    if(r == -1)
-      goto fail;
+  /* The plots have copies of the channels they use, so we can
+   * free the preview, which is all but the name. */
+  old = *source;
+  *source = *full;
+  source->name = old.name;
+  old.name = full->name;
+  *full = old;
+  source_free(full);
 
+  INFO("replaced the preview of %s with all %zu sets of values\n",
+      source->name, source->num_values);
 
-    if(rd.past && qp_rd)
-    {
-      VASSERT(0, "libsndfile read to much data "
-          "to see that the file was not a sndfile\n");
-      QP_WARN("%sFailed to read file%s %s%s%s:"
-          " read wrapper failed\n",
-          bred, trm, btur, filename, trm);
-      goto fail;
-    }
+  qp_app_graph_detail_source_remake();
+  qp_app_set_window_titles();
+}
 
-    if(qp_rd)
-    {
-      /* Start reading the data from the qp_rd read() buffer */
-      rd.rd = 0;
-      /* no need to add more to the qp_rd read() buffer */
-      rd.fd = -1;
-    }
-    /* The above lseek() should work fine. */
-    else if(lseek(rd.fd, 0, SEEK_SET))
+/* Called in the main thread to finish a load after the thread is
+ * done, or to wait for it to be done. */
+static
+void load_finish(struct qp_loader *ld)
+{
+  struct qp_source *source = NULL;
+
+  pthread_join(ld->thread, NULL);
+  qp_sllist_remove(loaders, ld, 0);
+
+  if(ld->preview_shown)
+  {
+    /* loaded() was called with the preview */
+    if(!ld->preview)
     {
-      EWARN("lseek(fd=%d, 0, SEEK_SET) failed\n", rd.fd);
-      QP_EWARN("%sFailed to read file%s %s%s%s: lseek() failed\n",
-          bred, trm, btur, filename, trm);
+      /* The preview was removed by the user while the file
+       * loaded, see qp_source_destroy(). */
+      DEBUG("dropping the load of file \"%s\" with the removed "
+          "preview\n", ld->filename);
+      source_free(ld->source);
     }
-
-    if(!rd.file)
+    else if(ld->err)
     {
-      errno = 0;
-      rd.file = fdopen(rd.fd, "r");
-      ASSERT(fileno(rd.file) == rd.fd);
+      QP_NOTICE("keeping the preview of file \"%s\"\n", ld->filename);
+      source_free(ld->source);
     }
-    if(!rd.file)
+    else if(same_layout(ld->preview, ld->source))
+      source_refine(ld->preview, ld->source);
+    else
     {
-      EWARN("fopen(\"%s\",\"r\") failed\n", filename);
-      QP_EWARN("%sFailed to open file%s %s%s%s\n",
-          bred, trm, btur, filename, trm);
-      goto fail;
+      /* We can't tell which plot channels go with which, so we
+       * remove the preview and its plots and graph the file
+       * again. */
+      QP_NOTICE("the channels in all of file \"%s\" are not like "
+          "those in the preview, so we graph it again\n",
+          ld->filename);
+      qp_source_destroy(ld->preview);
+      source_publish(source = ld->source);
+      if(ld->loaded)
+        ld->loaded(source, ld->data);
     }
+  }
+  else
+  {
+    if(ld->preview)
+      source_free(ld->preview);
 
-    errno = 0;
+    if(ld->err)
+      source_free(ld->source);
+    else
+      source_publish(source = ld->source);
 
-    if(read_ascii(source, &rd))
-      goto fail;
+    if(ld->loaded)
+      ld->loaded(source, ld->data);
   }
 
-  if(rd.buf)
-  {
-    free(rd.buf);
-    rd.buf = NULL;
-  }
+  free(ld->filename);
+  free(ld);
+}
+
+static
+void load_show_preview(struct qp_loader *ld)
+{
+  ld->preview_shown = 1;
+  source_publish(ld->preview);
+  if(ld->loaded)
+    ld->loaded(ld->preview, ld->data);
+}
 
+static
+gboolean load_idle_callback(gpointer data)
+{
+  struct qp_loader *ld;
+
+  do
   {
-    /* remove any channels that have very bad data */
-    struct qp_channel **c;
-    size_t i = 0, chan_num = 0;
-    ASSERT(source->channels);
-    c = source->channels;
-    while(c[i])
+    for(ld = qp_sllist_begin(loaders); ld; ld = qp_sllist_next(loaders))
+      if(__atomic_load_n(&ld->done, __ATOMIC_ACQUIRE) ||
+          (!ld->preview_shown &&
+           __atomic_load_n(&ld->preview, __ATOMIC_ACQUIRE)))
+        break;
+    /* loaded() may change the list, so we look again after */
+    if(ld)
     {
-      ASSERT(c[i]->form == QP_CHANNEL_FORM_SERIES);
-      if(!is_good_double(c[i]->series.min) ||
-          !is_good_double(c[i]->series.max))
-      {
-        struct qp_channel **n;
-        
-        qp_channel_destroy(c[i]);
+      if(ld->done)
+        load_finish(ld);
+      else
+        load_show_preview(ld);
+    }
+  } while(ld);
 
-        /* move of all pointers from c[i+1] back one */
-        for(n=&c[i]; *n;++n)
-          *n = *(n+1);
+  return FALSE; /* remove this idle callback */
+}
 
-        /* re-malloc copying and removing one */
-        source->channels = 
-          qp_realloc(source->channels, sizeof(struct qp_channel *)*
-              ((source->num_channels)--));
-        
-        /* reset c to the next one which is now at the
-         * same index */
-        c = source->channels;
+/* A load that was started from a window that is gone now is
+ * shown in all the windows. */
+static inline
+void load_forget_gone_windows(void)
+{
+  struct qp_loader *ld;
+  for(ld = qp_sllist_begin(loaders); ld; ld = qp_sllist_next(loaders))
+    if(ld->qp && !qp_sllist_find(app->qps, ld->qp))
+      ld->qp = NULL;
+}
 
-        QP_NOTICE("removed bad channel number %zu\n", chan_num);
-      }
-      else
-        ++i;
-      ++chan_num;
-    }
-    ASSERT(source->num_channels == i);
-  }
-  
-  
-  if(source->num_channels == 0)
-    goto fail;
+static
+gboolean load_progress_callback(gpointer data)
+{
+  struct qp_win *qp;
 
+  load_forget_gone_windows();
 
-  if(source->num_channels > 1)
+  for(qp = qp_sllist_begin(app->qps); qp; qp = qp_sllist_next(app->qps))
   {
-    /****** Check that there is at least one point in all the channels */
-    ssize_t i, num;
-    double *x;
-    num = source->num_values;
-    x = qp_malloc(sizeof(double)*source->num_channels);
-    for(i=0;i<source->num_channels;++i)
-      x[i] = qp_channel_series_double_begin(source->channels[i]);
-
-    while(num)
-    {
-      int found = 0;
-      for(i=0;i<source->num_channels;++i)
-        if(is_good_double(x[i]))
-          ++found;
+    struct qp_loader *ld;
+    size_t num = 0, count = 0, total = 0;
+    int known = 1;
+    char text[128];
 
-      if(found >= 2)
-        /* that means there is at least one x/y point
-         * in all the channels. */
-        break;
+    if(!qp->window || !qp->load_progress)
+      continue;
 
-      --num;
+    /* the loads of this window, see qp_source_load_cancel() */
+    text[0] = '\0';
+    for(ld = qp_sllist_begin(loaders); ld; ld = qp_sllist_next(loaders))
+    {
+      size_t t;
+      if(ld->qp && ld->qp != qp)
+        continue;
       if(!num)
-        break;
-
-      for(i=0;i<source->num_channels;++i)
-        x[i] = qp_channel_series_double_next(source->channels[i]);
+        snprintf(text, sizeof(text), "loading %s", ld->source->name);
+      ++num;
+      if((t = __atomic_load_n(&ld->total, __ATOMIC_RELAXED)))
+      {
+        count += __atomic_load_n(&ld->count, __ATOMIC_RELAXED);
+        total += t;
+      }
+      else
+        known = 0;
     }
+    if(num > 1)
+      snprintf(text, sizeof(text), "loading %zu files", num);
 
     if(!num)
     {
-      QP_WARN("Failed to find a good point in data from file \"%s\"\n",
-          filename);
-      goto fail;
+      gtk_widget_hide(qp->load_progress);
+      gtk_widget_hide(qp->load_cancel);
+      continue;
     }
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(qp->load_progress), text);
+    if(known && total)
+      gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(qp->load_progress),
+          (count < total)?((double) count/total):1.0);
+    else
+      gtk_progress_bar_pulse(GTK_PROGRESS_BAR(qp->load_progress));
+    gtk_widget_show(qp->load_progress);
+    gtk_widget_show(qp->load_cancel);
   }
 
-  
-  if(source->num_channels == 0)
-    goto fail;
-
-
-  if(app->op_linear_channel || source->num_channels == 1)
+  if(!qp_sllist_length(loaders))
   {
-    /* Prepend a linear channel */
-
-    /* TODO: Make this use less memory */
-    
-    struct qp_channel *c, **new_channels;
-    double start = 0, step = 1;
-    size_t len, i;
-
-    if(app->op_linear_channel)
-    {
-      c = app->op_linear_channel;
-      ASSERT(c->data);
-      start = ((double*)c->data)[0];
-      step = ((double*)c->data)[1];
-    }
-    else
-    {
-      c = qp_channel_linear_create(start, step);
-    }
-
-
-    len = source->num_values;
-    for(i=0;i<len;++i)
-      qp_channel_series_double_append(c, start + i*step);
-   
-    /* Prepend the channel to source->channels */
-    /* reuse dummy len */
-    len = source->num_channels + 1;
-    new_channels = qp_malloc(sizeof(c)*len+1);
-    new_channels[0] = c;
-    for(i=1;i<len;++i)
-      new_channels[i] = source->channels[i-1];
-    new_channels[i] = NULL;
-    free(source->channels);
-    source->channels = new_channels;
-    ++(source->num_channels);
+    load_progress_timeout = 0;
+    return FALSE; /* remove this timeout callback */
+  }
+  return TRUE;
+}
 
-    if(source->labels && source->num_labels !=  source->num_channels)
-    {
-      // shift the labels and add the linear channel label
-      source->labels = qp_realloc(source->labels,
-          sizeof(char *)*(source->num_labels+2));
-      source->labels[source->num_labels+1] = NULL;
-      for(i=source->num_labels;i>=1;--i)
-        source->labels[i] = source->labels[i-1];
+struct qp_loader *qp_source_load(const char *filename, int value_type,
+    struct qp_win *qp,
+    void (*loaded)(qp_source_t source, void *data), void *data)
+{
+  struct qp_loader *ld;
+  struct stat st;
 
-      char s[128];
-      snprintf(s,128, "%s[0]", source->name);
-      // The first channel is the linear channel.
-      source->labels[0] = qp_strdup(s);
-      ++source->num_labels;
-    }
+  ASSERT(filename && filename[0]);
 
-    /* Another source may have more values so
-     * we must make a new one in case it is used again. */
-    if(app->op_linear_channel)
-      app->op_linear_channel = qp_channel_linear_create(start, step);
-  }
-  
-  add_source_buffer_remove_menus(source);
-  
+  if(strcmp(filename, "-") == 0 || stat(filename, &st) ||
+      !S_ISREG(st.st_mode))
   {
-    char skip[64];
-    skip[0] = '\0';
-    if(app->op_skip_lines)
-      snprintf(skip, 64, "(after skipping %zu) ", app->op_skip_lines);
+    /* Pipes are read as the data comes in from the main loop,
+     * and source_create() tells about files we cannot open. */
+    qp_source_t source;
+    source = source_create(filename, value_type, 0);
+    if(loaded)
+      loaded(source, data);
+    return NULL;
+  }
 
+  if(!loaders)
+    loaders = qp_sllist_create(NULL);
 
-    INFO("created source with %zu sets of values %s"
-      "in %zu channels from file %s\n",
-      source->num_values, skip, source->num_channels,
-      filename);
+  ld = (struct qp_loader *) qp_malloc(sizeof(*ld));
+  memset(ld, 0, sizeof(*ld));
+  ld->source = make_source(filename, value_type);
+  ld->filename = qp_strdup(filename);
+  ld->loaded = loaded;
+  ld->data = data;
+  ld->qp = qp;
 
-    QP_INFO("created source with %zu sets of "
-      "values %sin %zu channels from file \"%s\"\n",
-      source->num_values, skip, source->num_channels,
-      filename);
-#if QP_DEBUG
-    if(source->labels)
-    {
-      char **labels;
-      APPEND("Read labels:");
-      for(labels = source->labels; *labels; ++labels)
-        APPEND(" \"%s\"", *labels);
-      APPEND("\n");
-    }
-#endif
+  if(pthread_create(&ld->thread, NULL, load_thread, ld))
+  {
+    qp_source_t source;
+    QP_EWARN("failed to make a thread to load %s\n", filename);
+    source_free(ld->source);
+    free(ld->filename);
+    free(ld);
+    source = source_create(filename, value_type, 0);
+    if(loaded)
+      loaded(source, data);
+    return NULL;
   }
 
-  qp_rd = NULL;
-
-  if(strcmp(filename,"-") == 0)
-    /* We do not close stdin */
-    return source;
-
-  if(rd.file)
-    fclose(rd.file);
-  else if(rd.fd != -1)
-    close(rd.fd);
+  qp_sllist_append(loaders, ld);
 
-  qp_app_graph_detail_source_remake();
-  qp_app_set_window_titles();
+  DEBUG("loading %s in a thread\n", filename);
 
-  return source;
+  if(!load_progress_timeout)
+    load_progress_timeout = g_timeout_add(LOAD_PROGRESS_PERIOD,
+        load_progress_callback, NULL);
 
-fail:
+  return ld;
+}
 
-  QP_WARN("No data loaded from file \"%s\"\n",
-      filename);
+void qp_source_load_wait(struct qp_loader *ld)
+{
+  struct qp_loader *l;
 
-  if(rd.buf)
-    free(rd.buf);
+  if(!loaders)
+    return;
 
-  if(strcmp(filename,"-") != 0)
+  while((l = qp_sllist_first(loaders)))
   {
-    if(rd.file)
-      fclose(rd.file);
-    else if(rd.fd != -1)
-      close(rd.fd);
+    int last;
+    last = (l == ld);
+    load_finish(l);
+    if(last)
+      break;
   }
+}
+
+void qp_source_load_cancel(struct qp_win *qp)
+{
+  struct qp_loader *ld;
 
-  if(source)
-    qp_source_destroy(source);
+  if(!loaders)
+    return;
 
-  qp_rd = NULL;
+  load_forget_gone_windows();
 
-  return NULL;
+  /* the loads that the status bar of qp shows */
+  for(ld = qp_sllist_begin(loaders); ld; ld = qp_sllist_next(loaders))
+    if(!ld->qp || ld->qp == qp)
+      __atomic_store_n(&ld->cancel, 1, __ATOMIC_RELAXED);
 }
 
 
@@ -1025,10 +2518,7 @@ qp_source_t qp_source_create_from_func(
 
   /* TODO: add code here */
 
-  add_source_buffer_remove_menus(source);
-
-  qp_app_graph_detail_source_remake();
-  qp_app_set_window_titles();
+  source_publish(source);
 
   return source;
 }
@@ -1136,6 +2626,9 @@ void qp_source_destroy(qp_source_t source)
 
   if(!source) return;
 
+  if(source->reader)
+    /* stop reading the pipe */
+    reader_destroy(source->reader);
 
   { /* remove this source from buffers list from file menu
      * in all main windows (qp) */
@@ -1170,30 +2663,9 @@ void qp_source_destroy(qp_source_t source)
     }
   }
 
-  {
-    struct qp_channel **c;
-    c = source->channels;
-    for(c=source->channels; *c; ++c)
-      qp_channel_destroy(*c);
-    free(source->channels);
-  }
-
   qp_sllist_remove(app->sources, source, 0);
 
-  if(source->labels)
-  {
-    char **s;
-    for(s = source->labels; *s; ++s)
-    {
-      if(*s)
-        free(*s);
-    }
-    free(source->labels);
-  }
-    
-  
-  free(source->name);
-  free(source);
+  source_free(source);
 
   qp_app_graph_detail_source_remake();
   qp_app_set_window_titles();
@@ -0,0 +1,846 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Reading binary files, raw with a --binary LAYOUT or NumPy .npy
+ * files, by mapping them.  The values of a channel that are in the
+ * file one after the other as a type that we store, in the byte
+ * order of this computer, are read in place with no copy.  Other
+ * values are converted into arrays from the source arena.  The
+ * summaries of the arrays, that give the min and max and so on,
+ * are made with a thread for each processor. */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "qp.h"
+#include "debug.h"
+#include "spew.h"
+#include "list.h"
+#include "channel.h"
+#include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "arena.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+#define MAX_THREADS  (32)
+
+/* the value types of fields in a binary file */
+#define FIELD_I8    0
+#define FIELD_U8    1
+#define FIELD_I16   2
+#define FIELD_U16   3
+#define FIELD_I32   4
+#define FIELD_U32   5
+#define FIELD_I64   6
+#define FIELD_U64   7
+#define FIELD_F32   8
+#define FIELD_F64   9
+
+static const struct
+{
+  const char *name;
+  size_t size;
+  /* the value_type of the channel that holds them */
+  int value_type;
+  /* set if the channel value_type is this type, so we
+   * can use the values in the file as they are */
+  int in_place;
+} field_types[] =
+{
+  [FIELD_I8]  = { "i8",  1, QP_TYPE_SHORT,  0 },
+  [FIELD_U8]  = { "u8",  1, QP_TYPE_SHORT,  0 },
+  [FIELD_I16] = { "i16", 2, QP_TYPE_SHORT,  1 },
+  [FIELD_U16] = { "u16", 2, QP_TYPE_INT,    0 },
+  [FIELD_I32] = { "i32", 4, QP_TYPE_INT,    1 },
+  [FIELD_U32] = { "u32", 4, QP_TYPE_DOUBLE, 0 },
+  [FIELD_I64] = { "i64", 8, QP_TYPE_DOUBLE, 0 },
+  [FIELD_U64] = { "u64", 8, QP_TYPE_DOUBLE, 0 },
+  [FIELD_F32] = { "f32", 4, QP_TYPE_FLOAT,  1 },
+  [FIELD_F64] = { "f64", 8, QP_TYPE_DOUBLE, 1 }
+};
+
+#define NUM_FIELD_TYPES  (sizeof(field_types)/sizeof(field_types[0]))
+
+
+struct binary_field
+{
+  int type; /* FIELD_* */
+  int swap; /* the bytes are not in the order of this computer */
+  size_t offset; /* bytes from the start of a row */
+  char *label;
+};
+
+struct binary_layout
+{
+  struct binary_field *field;
+  size_t num_fields;
+  size_t row_size; /* bytes in a row, with padding */
+  /* If set all the values of a field are together, one field
+   * after the other, else the fields are in each row. */
+  int planar;
+  size_t data_offset; /* bytes in the file before the values */
+  size_t num_rows;
+};
+
+
+static inline
+int is_big_endian(void)
+{
+  const uint16_t x = 1;
+  return (*((const uint8_t *) &x) == 0)?1:0;
+}
+
+static
+void layout_free(struct binary_layout *l)
+{
+  size_t j;
+  for(j=0; j<l->num_fields; ++j)
+    if(l->field[j].label)
+      free(l->field[j].label);
+  if(l->field)
+    free(l->field);
+  memset(l, 0, sizeof(*l));
+}
+
+static
+void layout_add_field(struct binary_layout *l, int type, int swap,
+    const char *label, size_t label_len)
+{
+  struct binary_field *f;
+
+  l->field = (struct binary_field *) qp_realloc(l->field,
+      sizeof(*l->field)*(l->num_fields+1));
+  f = &l->field[l->num_fields++];
+  f->type = type;
+  f->swap = swap;
+  f->offset = l->row_size;
+  f->label = (label)?qp_strndup(label, label_len):NULL;
+  l->row_size += field_types[type].size;
+}
+
+/* returns the FIELD_* with name of length len, or -1 */
+static inline
+int get_field_type(const char *name, size_t len)
+{
+  int t;
+  for(t=0; t<(int) NUM_FIELD_TYPES; ++t)
+    if(strlen(field_types[t].name) == len &&
+        !strncasecmp(field_types[t].name, name, len))
+      return t;
+  return -1;
+}
+
+/* Parses a --binary LAYOUT into l.  Returns 0 on success, or 1
+ * and spews why not. */
+static
+int parse_layout(const char *layout, struct binary_layout *l)
+{
+  const char *s;
+  int big_endian;
+
+  memset(l, 0, sizeof(*l));
+  big_endian = is_big_endian();
+  s = layout;
+
+  while(*s)
+  {
+    const char *word;
+    size_t len;
+    int endian, type;
+
+    while(*s == ',' || isspace(*s))
+      ++s;
+    if(!*s)
+      break;
+    word = s;
+    while(*s && *s != ',' && !isspace(*s))
+      ++s;
+    len = s - word;
+
+    if(len == 6 && !strncasecmp(word, "planar", 6))
+    {
+      l->planar = 1;
+      continue;
+    }
+    if(len == 3 && !strncasecmp(word, "big", 3))
+    {
+      big_endian = 1;
+      continue;
+    }
+    if(len == 6 && !strncasecmp(word, "little", 6))
+    {
+      big_endian = 0;
+      continue;
+    }
+    if(word[0] == 'x' && len > 1)
+    {
+      /* padding bytes that we skip */
+      char *end;
+      unsigned long n;
+      n = strtoul(word + 1, &end, 10);
+      if(end != s || n == 0)
+        goto bad;
+      l->row_size += n;
+      continue;
+    }
+
+    endian = big_endian;
+    if(word[0] == '<' || word[0] == '>')
+    {
+      endian = (word[0] == '>')?1:0;
+      ++word;
+      --len;
+    }
+    if((type = get_field_type(word, len)) == -1)
+      goto bad;
+    layout_add_field(l, type, (endian != is_big_endian()), NULL, 0);
+    continue;
+
+bad:
+    QP_WARN("bad binary layout \"%s\" at \"%.*s\"\n",
+        layout, (int) (s - word), word);
+    layout_free(l);
+    return 1;
+  }
+
+  if(!l->num_fields)
+  {
+    QP_WARN("binary layout \"%s\" has no fields\n", layout);
+    layout_free(l);
+    return 1;
+  }
+  if(l->planar)
+  {
+    /* There is no padding between the columns of values. */
+    size_t j, size = 0;
+    for(j=0; j<l->num_fields; ++j)
+      size += field_types[l->field[j].type].size;
+    if(size != l->row_size)
+    {
+      QP_WARN("binary layout \"%s\" is planar with padding\n", layout);
+      layout_free(l);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int qp_binary_layout_check(const char *layout)
+{
+  struct binary_layout l;
+  ASSERT(layout);
+  if(parse_layout(layout, &l))
+    return 1;
+  layout_free(&l);
+  return 0;
+}
+
+/* Parses a NumPy dtype string, like '<f8', into *type and *swap,
+ * and sets *size.  *type is -1 for padding, like '|V4'.  Returns 0
+ * on success. */
+static
+int parse_npy_type(const char *s, size_t len, int *type, int *swap,
+    size_t *size)
+{
+  char name[8];
+  int endian;
+  char *end;
+
+  if(len < 3)
+    return 1;
+
+  switch(s[0])
+  {
+    case '<':
+      endian = 0;
+      break;
+    case '>':
+      endian = 1;
+      break;
+    case '|':
+    case '=':
+      endian = is_big_endian();
+      break;
+    default:
+      return 1;
+  }
+  *swap = (endian != is_big_endian());
+
+  *size = strtoul(s + 2, &end, 10);
+  if(end != s + len || *size == 0)
+    return 1;
+
+  switch(s[1])
+  {
+    case 'V':
+      *type = -1;
+      return 0;
+    case 'b':
+      if(*size != 1)
+        return 1;
+      *type = FIELD_U8;
+      return 0;
+    case 'i':
+    case 'u':
+    case 'f':
+      snprintf(name, sizeof(name), "%c%zu", s[1], (*size)*8);
+      *type = get_field_type(name, strlen(name));
+      return (*type == -1)?1:0;
+    default:
+      break;
+  }
+  return 1;
+}
+
+/* returns a pointer to the value of key in the .npy header, or NULL */
+static inline
+const char *npy_value(const char *header, const char *key)
+{
+  const char *s;
+  if(!(s = strstr(header, key)))
+    return NULL;
+  s += strlen(key);
+  while(isspace(*s)) ++s;
+  if(*s != ':')
+    return NULL;
+  ++s;
+  while(isspace(*s)) ++s;
+  return s;
+}
+
+/* returns a pointer past the quoted string at s, that has the
+ * string at *str with length *len, or NULL */
+static inline
+const char *npy_string(const char *s, const char **str, size_t *len)
+{
+  char q;
+  const char *end;
+  q = *s;
+  if(q != '\'' && q != '"')
+    return NULL;
+  if(!(end = strchr(s + 1, q)))
+    return NULL;
+  *str = s + 1;
+  *len = end - s - 1;
+  return end + 1;
+}
+
+/* Parses the header of the .npy file map into l.  Returns 0 on
+ * success, or 1 and spews why not.  See
+ * numpy.lib.format in the NumPy documentation. */
+static
+int parse_npy(const char *name, const uint8_t *map, size_t map_len,
+    struct binary_layout *l)
+{
+  char *header = NULL;
+  const char *s, *str;
+  size_t hlen, len, size, shape[3];
+  int type, swap, ndims = 0;
+
+  memset(l, 0, sizeof(*l));
+
+  if(map_len < 10)
+    goto bad;
+  if(map[6] == 1)
+  {
+    hlen = map[8] | (map[9] << 8);
+    l->data_offset = 10 + hlen;
+  }
+  else if(map[6] == 2 || map[6] == 3)
+  {
+    if(map_len < 12)
+      goto bad;
+    hlen = map[8] | (map[9] << 8) | (map[10] << 16) |
+      (((size_t) map[11]) << 24);
+    l->data_offset = 12 + hlen;
+  }
+  else
+    goto bad;
+
+  if(l->data_offset > map_len)
+    goto bad;
+  header = qp_strndup((const char *) map + l->data_offset - hlen, hlen);
+
+  if(!(s = npy_value(header, "'descr'")))
+    goto bad;
+
+  if(*s == '[')
+  {
+    /* a structured type with named fields that are in each row,
+     * like [('t', '<f8'), ('v', '<i2')] */
+    for(++s; *s;)
+    {
+      const char *label;
+      size_t label_len;
+
+      while(isspace(*s) || *s == ',') ++s;
+      if(*s == ']')
+        break;
+      if(*s != '(')
+        goto bad;
+      ++s;
+      while(isspace(*s)) ++s;
+      if(!(s = npy_string(s, &label, &label_len)))
+        goto bad;
+      while(isspace(*s) || *s == ',') ++s;
+      if(!(s = npy_string(s, &str, &len)))
+        goto bad;
+      while(isspace(*s)) ++s;
+      if(*s != ')')
+        /* a field that is an array */
+        goto not_supported;
+      ++s;
+
+      if(parse_npy_type(str, len, &type, &swap, &size))
+        goto not_supported;
+      if(type == -1)
+        l->row_size += size;
+      else
+        layout_add_field(l, type, swap, label, label_len);
+    }
+    if(*s != ']')
+      goto bad;
+  }
+  else
+  {
+    if(!npy_string(s, &str, &len))
+      goto bad;
+    if(parse_npy_type(str, len, &type, &swap, &size) || type == -1)
+      goto not_supported;
+  }
+
+  if(!(s = npy_value(header, "'shape'")) || *s != '(')
+    goto bad;
+  for(++s; *s && *s != ')';)
+  {
+    char *end;
+    while(isspace(*s) || *s == ',') ++s;
+    if(*s == ')')
+      break;
+    if(ndims == 3)
+      goto not_supported;
+    shape[ndims++] = strtoul(s, &end, 10);
+    if(end == s)
+      goto bad;
+    s = end;
+  }
+
+  if(l->num_fields)
+  {
+    if(ndims != 1)
+      goto not_supported;
+    l->num_rows = shape[0];
+  }
+  else
+  {
+    size_t j;
+    if(ndims < 1 || ndims > 2)
+      goto not_supported;
+    l->num_rows = shape[0];
+    for(j=0; j<((ndims == 2)?shape[1]:1); ++j)
+      layout_add_field(l, type, swap, NULL, 0);
+    if((s = npy_value(header, "'fortran_order'")) &&
+        !strncmp(s, "True", 4))
+      l->planar = 1;
+  }
+
+  if(!l->num_fields || !l->row_size)
+    goto not_supported;
+
+  if(l->num_rows > (map_len - l->data_offset)/l->row_size)
+  {
+    QP_WARN("NumPy file %s is shorter than its header says\n", name);
+    goto fail;
+  }
+
+  free(header);
+  return 0;
+
+not_supported:
+
+  QP_WARN("NumPy file %s has a type or shape that we do not "
+      "read: %s\n", name, header);
+  goto fail;
+
+bad:
+
+  QP_WARN("NumPy file %s has a bad header\n", name);
+
+fail:
+
+  if(header)
+    free(header);
+  layout_free(l);
+  return 1;
+}
+
+
+/* What the threads that read a binary file share */
+struct binary_read
+{
+  const struct binary_layout *l;
+  struct qp_channel **channels;
+  /* the values of field j start at base[j] and are stride[j]
+   * bytes apart */
+  const char **base;
+  size_t *stride;
+  int *in_place;
+  size_t num_arrays; /* per channel */
+};
+
+struct binary_job
+{
+  pthread_t thread;
+  int joinable;
+  struct binary_read *b;
+  /* items are field j array k, with item = j*num_arrays + k */
+  size_t first, last;
+};
+
+/* Writes n values of the field f from src, that are stride bytes
+ * apart, to array as the value_type of the channel */
+static
+void convert_array(const struct binary_field *f, const char *src,
+    size_t stride, void *array, size_t n)
+{
+  size_t j, size;
+  size = field_types[f->type].size;
+
+  for(j=0; j<n; ++j, src += stride)
+  {
+    union
+    {
+      uint8_t b[8];
+      int8_t i8;
+      uint8_t u8;
+      int16_t i16;
+      uint16_t u16;
+      int32_t i32;
+      uint32_t u32;
+      int64_t i64;
+      uint64_t u64;
+      float f32;
+      double f64;
+    } v;
+
+    if(f->swap)
+    {
+      size_t i;
+      for(i=0; i<size; ++i)
+        v.b[i] = src[size-1-i];
+    }
+    else
+      memcpy(v.b, src, size);
+
+    switch(f->type)
+    {
+      case FIELD_I8:
+        ((short *) array)[j] = v.i8;
+        break;
+      case FIELD_U8:
+        ((short *) array)[j] = v.u8;
+        break;
+      case FIELD_I16:
+        ((short *) array)[j] = v.i16;
+        break;
+      case FIELD_U16:
+        ((int *) array)[j] = v.u16;
+        break;
+      case FIELD_I32:
+        ((int *) array)[j] = v.i32;
+        break;
+      case FIELD_U32:
+        ((double *) array)[j] = v.u32;
+        break;
+      case FIELD_I64:
+        ((double *) array)[j] = v.i64;
+        break;
+      case FIELD_U64:
+        ((double *) array)[j] = v.u64;
+        break;
+      case FIELD_F32:
+        ((float *) array)[j] = v.f32;
+        break;
+      case FIELD_F64:
+        ((double *) array)[j] = v.f64;
+        break;
+      default:
+        ASSERT(0);
+        break;
+    }
+  }
+}
+
+static
+void *binary_job_thread(void *data)
+{
+  struct binary_job *job;
+  struct binary_read *b;
+  size_t i;
+
+  job = (struct binary_job *) data;
+  b = job->b;
+
+  for(i=job->first; i<job->last; ++i)
+  {
+    size_t j, k, n;
+    j = i / b->num_arrays;
+    k = i % b->num_arrays;
+
+    if(!b->in_place[j])
+    {
+      n = b->l->num_rows - (k << ARRAY_SHIFT);
+      if(n > ARRAY_LENGTH)
+        n = ARRAY_LENGTH;
+      convert_array(&b->l->field[j],
+          b->base[j] + (k << ARRAY_SHIFT)*b->stride[j], b->stride[j],
+          b->channels[j]->series.arrays->arrays[k], n);
+    }
+    qp_channel_series_summarize(b->channels[j], k);
+  }
+  return NULL;
+}
+
+/* Converts and summarizes the arrays of all the channels with a
+ * thread for each processor, each doing a range of arrays */
+static
+void read_arrays(struct binary_read *b)
+{
+  struct binary_job job[MAX_THREADS];
+  size_t num_items;
+  long num_threads, t;
+
+  num_items = b->l->num_fields*b->num_arrays;
+  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if(num_threads < 1)
+    num_threads = 1;
+  if(num_threads > MAX_THREADS)
+    num_threads = MAX_THREADS;
+  if((size_t) num_threads > num_items)
+    num_threads = (long) num_items;
+
+  DEBUG("reading %zu arrays with %ld threads\n", num_items, num_threads);
+
+  for(t=0; t<num_threads; ++t)
+  {
+    job[t].b = b;
+    job[t].first = num_items*t/num_threads;
+    job[t].last = num_items*(t+1)/num_threads;
+    job[t].joinable = (t > 0 && !pthread_create(&job[t].thread, NULL,
+          binary_job_thread, &job[t]));
+  }
+
+  /* this thread does the first range, and any that did not
+   * get a thread */
+  for(t=0; t<num_threads; ++t)
+    if(!job[t].joinable)
+      binary_job_thread(&job[t]);
+
+  for(t=1; t<num_threads; ++t)
+    if(job[t].joinable)
+      pthread_join(job[t].thread, NULL);
+}
+
+int qp_source_read_binary(struct qp_source *source, int fd,
+    const char *layout)
+{
+  struct binary_layout l;
+  struct binary_read b;
+  struct stat st;
+  uint8_t magic[6];
+  char *map;
+  size_t j, column;
+  int is_npy, num_in_place = 0, read_only;
+
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode))
+  {
+    if(!layout)
+      return -1;
+    QP_WARN("%s is not a regular file that we can read with "
+        "a binary layout\n", source->name);
+    return 1;
+  }
+
+  is_npy = (pread(fd, magic, 6, 0) == 6 &&
+      !memcmp(magic, "\x93NUMPY", 6));
+  if(!is_npy && !layout)
+    return -1;
+
+  if(st.st_size == 0)
+  {
+    QP_WARN("read no data in file %s\n", source->name);
+    return 1;
+  }
+
+  /* Channels that read the values in place would get SIGBUS if
+   * the file was cut shorter while it is mapped, so we do that only
+   * with files that no one has permission to write to. */
+  read_only = !(st.st_mode & (S_IWUSR|S_IWGRP|S_IWOTH));
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED)
+  {
+    EWARN("mmap() file %s failed\n", source->name);
+    QP_EWARN("failed to read file %s\n", source->name);
+    return 1;
+  }
+
+  if(is_npy)
+  {
+    if(parse_npy(source->name, (uint8_t *) map, st.st_size, &l))
+      goto fail;
+  }
+  else
+  {
+    if(parse_layout(layout, &l))
+      goto fail;
+    l.num_rows = st.st_size/l.row_size;
+    if(st.st_size % l.row_size)
+      QP_NOTICE("the last %zu bytes of file %s are not a whole row "
+          "of the binary layout \"%s\"\n",
+          (size_t) (st.st_size % l.row_size), source->name, layout);
+  }
+
+  if(!l.num_rows)
+  {
+    QP_WARN("read no data in file %s\n", source->name);
+    layout_free(&l);
+    goto fail;
+  }
+
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+  b.l = &l;
+  b.num_arrays = (l.num_rows + ARRAY_MASK) >> ARRAY_SHIFT;
+  b.channels = (struct qp_channel **)
+    qp_malloc(sizeof(*b.channels)*l.num_fields);
+  b.base = (const char **) qp_malloc(sizeof(*b.base)*l.num_fields);
+  b.stride = (size_t *) qp_malloc(sizeof(*b.stride)*l.num_fields);
+  b.in_place = (int *) qp_malloc(sizeof(*b.in_place)*l.num_fields);
+
+  for(column=0, j=0; j<l.num_fields; ++j)
+  {
+    struct qp_channel *c;
+    int type;
+    size_t size;
+
+    type = l.field[j].type;
+    size = field_types[type].size;
+    if(l.planar)
+    {
+      b.base[j] = map + l.data_offset + column;
+      b.stride[j] = size;
+      column += l.num_rows*size;
+    }
+    else
+    {
+      b.base[j] = map + l.data_offset + l.field[j].offset;
+      b.stride[j] = l.row_size;
+    }
+
+    /* We can use the values where they are if they are the
+     * channel value type, one after the other, and aligned, and the
+     * file is read only. */
+    b.in_place[j] = (read_only &&
+        field_types[type].in_place && !l.field[j].swap &&
+        b.stride[j] == size && ((size_t) b.base[j]) % size == 0);
+
+    c = qp_channel_create(QP_CHANNEL_FORM_SERIES,
+        field_types[type].value_type);
+    qp_channel_series_set_arena(c, source->arena);
+    qp_channel_series_map(c, (b.in_place[j])?b.base[j]:NULL, l.num_rows);
+    b.channels[j] = c;
+    if(b.in_place[j])
+      ++num_in_place;
+  }
+
+  read_arrays(&b);
+
+  source->channels = (struct qp_channel **)
+    qp_realloc(source->channels,
+        sizeof(struct qp_channel *)*(source->num_channels+l.num_fields+1));
+  for(j=0; j<l.num_fields; ++j)
+  {
+    qp_channel_series_merge_chunks(b.channels[j]);
+    source->channels[source->num_channels++] = b.channels[j];
+  }
+  source->channels[source->num_channels] = NULL;
+  source->num_values = l.num_rows;
+
+  if(l.field[0].label && !source->labels)
+  {
+    /* the NumPy field names */
+    source->labels = (char **) qp_malloc(sizeof(char *)*(l.num_fields+1));
+    for(j=0; j<l.num_fields; ++j)
+      source->labels[j] = qp_strdup((l.field[j].label)?
+          l.field[j].label:"");
+    source->labels[j] = NULL;
+    source->num_labels = l.num_fields;
+  }
+
+  INFO("read %zu rows of %zu fields from %s file %s with %d "
+      "channels in place\n", l.num_rows, l.num_fields,
+      (is_npy)?"NumPy":"binary", source->name, num_in_place);
+
+  free(b.channels);
+  free(b.base);
+  free(b.stride);
+  free(b.in_place);
+  layout_free(&l);
+
+  if(num_in_place)
+    /* The channels read the file so it is mapped until
+     * the source is destroyed. */
+    qp_arena_add_map(source->arena, map, st.st_size);
+  else if(munmap(map, st.st_size))
+    EWARN("munmap() file %s failed\n", source->name);
+
+  return 0;
+
+fail:
+
+  if(munmap(map, st.st_size))
+    EWARN("munmap() file %s failed\n", source->name);
+  return 1;
+}
@@ -0,0 +1,566 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* The --cache snapshots of text files.  After a text file is parsed
+ * we write the channel arrays, the array summaries and the labels to
+ * a file in the cache directory, and the next time the same file is
+ * opened with the same options we map the snapshot and read the
+ * arrays in place, like source_binary.c does, with no parsing.
+ *
+ * The snapshot is named by a hash of the real path of the file and
+ * the options that change how it is parsed, so there is one snapshot
+ * for each, and it holds the whole key, with the size and
+ * modification time of the file, which must match to be used.  The
+ * snapshot is in the byte order and struct layout of this computer,
+ * like a core file; it is not for sharing. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "qp.h"
+#include "debug.h"
+#include "spew.h"
+#include "list.h"
+#include "channel.h"
+#include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "arena.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* Smaller files parse faster than we can look for a snapshot. */
+#define CACHE_MIN_SIZE   ((off_t) 1024*1024)
+
+#define CACHE_MAGIC      "QPCACHE2"
+#define CACHE_BYTE_ORDER ((uint32_t) 0x01020304)
+/* the channel arrays in the snapshot start on this */
+#define CACHE_ALIGN      ((uint64_t) 64)
+
+
+struct qp_cache
+{
+  char *path; /* the snapshot file */
+  char *key;
+  size_t key_len;
+};
+
+/* The snapshot is this, then the key, then the labels, each with
+ * its '\0', then, aligned, the source select without the end, then,
+ * aligned, a struct cache_channel for each channel, and then the
+ * values and the array summaries of each channel at the offsets in
+ * its struct cache_channel. */
+struct cache_header
+{
+  char magic[8]; /* CACHE_MAGIC */
+  uint32_t byte_order; /* CACHE_BYTE_ORDER as this computer writes it */
+  uint32_t chunk_size; /* sizeof(struct qp_channel_chunk) */
+  uint64_t array_length; /* ARRAY_LENGTH */
+  uint64_t key_len;
+  uint64_t labels_len; /* bytes of all the labels */
+  uint64_t num_labels;
+  uint64_t num_select; /* 0 if all the columns were read */
+  uint64_t num_channels;
+  uint64_t num_values;
+};
+
+struct cache_channel
+{
+  int32_t value_type;
+  int32_t pad;
+  double scale;
+  uint64_t values; /* offset in the snapshot of the values */
+  uint64_t chunks; /* offset in the snapshot of the array summaries */
+};
+
+
+static inline
+uint64_t align(uint64_t offset)
+{
+  return (offset + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
+}
+
+/* FNV-1a */
+static inline
+uint64_t hash(const char *s, size_t len)
+{
+  uint64_t h = 14695981039346656037ULL;
+  for(; len; --len, ++s)
+  {
+    h ^= (uint8_t) *s;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/* returns the cache directory, that is malloc()ed, or NULL */
+static
+char *get_cache_dir(void)
+{
+  const char *env;
+  char *dir;
+
+  env = getenv("XDG_CACHE_HOME");
+  if(env && env[0] == '/')
+  {
+    dir = qp_malloc(strlen(env) + strlen("/quickplot") + 1);
+    sprintf(dir, "%s/quickplot", env);
+    return dir;
+  }
+
+  env = getenv("HOME");
+  if(!env || !env[0])
+    return NULL;
+  dir = qp_malloc(strlen(env) + strlen("/.cache/quickplot") + 1);
+  sprintf(dir, "%s/.cache/quickplot", env);
+  return dir;
+}
+
+struct qp_cache *qp_cache_create(struct qp_source *source,
+    const char *filename, int fd)
+{
+  struct qp_cache *cache;
+  struct stat st;
+  char *real, *dir, *key;
+  size_t name_len;
+  int len;
+
+  ASSERT(source);
+  ASSERT(filename);
+
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+      st.st_size < CACHE_MIN_SIZE)
+    return NULL;
+
+  if(!(real = realpath(filename, NULL)))
+    return NULL;
+
+  if(!(dir = get_cache_dir()))
+  {
+    free(real);
+    return NULL;
+  }
+
+  /* The first line is what the snapshot is named by.  The snapshot
+   * is good if the whole key matches. */
+  len = asprintf(&key, "%s skip=%zu labels=%d separator=\"%s\" "
+      "columns=\"%s\" where=\"%s\" x_range=\"%s\" value_type=%d\n"
+      "%" PRIuMAX " %" PRIuMAX " %jd %jd.%09ld\n",
+      real, app->op_skip_lines, app->op_labels, app->op_label_separator,
+      (app->op_columns)?app->op_columns:"",
+      (app->op_where)?app->op_where:"",
+      (app->op_x_range)?app->op_x_range:"", source->value_type,
+      (uintmax_t) st.st_dev, (uintmax_t) st.st_ino,
+      (intmax_t) st.st_size, (intmax_t) st.st_mtim.tv_sec,
+      st.st_mtim.tv_nsec);
+  free(real);
+  VASSERT(len > 0, "asprintf() failed\n");
+  if(len <= 0)
+  {
+    free(dir);
+    return NULL;
+  }
+
+  name_len = strchr(key, '\n') - key;
+
+  cache = (struct qp_cache *) qp_malloc(sizeof(*cache));
+  cache->key = key;
+  cache->key_len = len;
+  cache->path = qp_malloc(strlen(dir) + 22);
+  sprintf(cache->path, "%s/%016" PRIx64 ".qpc", dir,
+      hash(key, name_len));
+  free(dir);
+
+  return cache;
+}
+
+void qp_cache_destroy(struct qp_cache *cache)
+{
+  ASSERT(cache);
+  free(cache->path);
+  free(cache->key);
+  free(cache);
+}
+
+/* returns 1 if the size bytes at offset are in the snapshot */
+static inline
+int in_map(uint64_t offset, uint64_t size, uint64_t map_size)
+{
+  return (offset <= map_size && size <= map_size - offset);
+}
+
+int qp_source_cache_read(struct qp_source *source, struct qp_cache *cache)
+{
+  const struct cache_header *h;
+  const struct cache_channel *cc;
+  struct stat st;
+  const char *map, *labels;
+  const uint64_t *select;
+  uint64_t offset, num_arrays, j;
+  int fd;
+
+  ASSERT(source);
+  ASSERT(cache);
+  ASSERT(!source->num_channels);
+
+  fd = open(cache->path, O_RDONLY);
+  if(fd == -1)
+    return -1;
+
+  if(fstat(fd, &st) || (size_t) st.st_size < sizeof(*h))
+  {
+    close(fd);
+    return -1;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    EWARN("mmap() cache file %s failed\n", cache->path);
+    return -1;
+  }
+
+  h = (const struct cache_header *) map;
+  if(memcmp(h->magic, CACHE_MAGIC, 8) ||
+      h->byte_order != CACHE_BYTE_ORDER ||
+      h->chunk_size != sizeof(struct qp_channel_chunk) ||
+      h->array_length != ARRAY_LENGTH ||
+      h->key_len != cache->key_len ||
+      !in_map(sizeof(*h), h->key_len, st.st_size) ||
+      memcmp(map + sizeof(*h), cache->key, cache->key_len))
+  {
+    DEBUG("cache file %s is not for %s as it is now\n",
+        cache->path, source->name);
+    goto fail;
+  }
+
+  /* The key matches, so this is our snapshot and it may only be
+   * bad if it was damaged. */
+  offset = sizeof(*h) + h->key_len;
+  labels = map + offset;
+  if(!h->num_channels || !h->num_values ||
+      !in_map(offset, h->labels_len, st.st_size) ||
+      (h->labels_len && labels[h->labels_len - 1] != '\0'))
+    goto bad;
+  offset = align(offset + h->labels_len);
+  select = (const uint64_t *) (map + offset);
+  if(h->num_select > st.st_size/sizeof(*select) ||
+      !in_map(offset, h->num_select*sizeof(*select), st.st_size))
+    goto bad;
+  offset = align(offset + h->num_select*sizeof(*select));
+  if(offset > (uint64_t) st.st_size ||
+      h->num_channels > (st.st_size - offset)/sizeof(*cc))
+    goto bad;
+  cc = (const struct cache_channel *) (map + offset);
+  num_arrays = (h->num_values + ARRAY_MASK) >> ARRAY_SHIFT;
+
+  for(j=0; j<h->num_channels; ++j)
+  {
+    size_t elem_size;
+
+    if(cc[j].value_type != QP_TYPE_SHORT &&
+        cc[j].value_type != QP_TYPE_INT &&
+        cc[j].value_type != QP_TYPE_FLOAT &&
+        cc[j].value_type != QP_TYPE_DOUBLE)
+      goto bad;
+    elem_size = qp_channel_series_value_size(cc[j].value_type);
+    if(cc[j].values % CACHE_ALIGN || cc[j].chunks % CACHE_ALIGN ||
+        h->num_values > (st.st_size - cc[j].values)/elem_size ||
+        !in_map(cc[j].values, h->num_values*elem_size, st.st_size) ||
+        num_arrays > (st.st_size - cc[j].chunks)/h->chunk_size ||
+        !in_map(cc[j].chunks, num_arrays*h->chunk_size, st.st_size))
+      goto bad;
+  }
+
+  for(j=0; j<h->num_channels; ++j)
+  {
+    struct qp_channel *c;
+
+    c = qp_channel_create(QP_CHANNEL_FORM_SERIES, cc[j].value_type);
+    qp_channel_series_set_arena(c, source->arena);
+    qp_channel_series_map(c, map + cc[j].values, h->num_values);
+    ASSERT(c->series.arrays->num_arrays == num_arrays);
+    memcpy(c->series.arrays->chunks, map + cc[j].chunks,
+        num_arrays*h->chunk_size);
+    c->series.scale = cc[j].scale;
+    qp_channel_series_merge_chunks(c);
+
+    ++source->num_channels;
+    source->channels = (struct qp_channel **)
+      qp_realloc(source->channels,
+          sizeof(struct qp_channel *)*(source->num_channels+1));
+    source->channels[source->num_channels-1] = c;
+    source->channels[source->num_channels] = NULL;
+  }
+  source->num_values = h->num_values;
+
+  if(h->num_select)
+  {
+    source->select = (size_t *)
+      qp_malloc(sizeof(size_t)*(h->num_select+1));
+    for(j=0; j<h->num_select; ++j)
+      source->select[j] = select[j];
+    source->select[j] = QP_SELECT_END;
+  }
+
+  if(h->num_labels)
+  {
+    source->labels = (char **)
+      qp_malloc(sizeof(char *)*(h->num_labels+1));
+    for(j=0; j<h->num_labels; ++j)
+    {
+      if(labels >= map + sizeof(*h) + h->key_len + h->labels_len)
+        /* A label is missing so we make it blank. */
+        source->labels[j] = qp_strdup("");
+      else
+      {
+        source->labels[j] = qp_strdup(labels);
+        labels += strlen(labels) + 1;
+      }
+    }
+    source->labels[j] = NULL;
+    source->num_labels = h->num_labels;
+  }
+
+  INFO("read %zu sets of values in %zu channels of %s from "
+      "cache file %s\n", source->num_values, source->num_channels,
+      source->name, cache->path);
+
+  /* The channels read the snapshot so it is mapped until
+   * the source is destroyed. */
+  qp_arena_add_map(source->arena, (void *) map, st.st_size);
+  return 0;
+
+bad:
+
+  QP_NOTICE("cache file %s is damaged; reading %s\n",
+      cache->path, source->name);
+
+fail:
+
+  if(munmap((void *) map, st.st_size))
+    EWARN("munmap() cache file %s failed\n", cache->path);
+  return -1;
+}
+
+/* writes len zeros */
+static inline
+int write_zeros(FILE *file, size_t len)
+{
+  static const char zeros[CACHE_ALIGN];
+  ASSERT(len < CACHE_ALIGN);
+  return (fwrite(zeros, 1, len, file) != len);
+}
+
+/* Makes the cache directory of path and the directory it is in,
+ * if they are not there. */
+static
+void make_dirs(const char *path)
+{
+  char *dir, *s;
+
+  dir = qp_strdup(path);
+  if((s = strrchr(dir, '/')))
+  {
+    *s = '\0';
+    if((s = strrchr(dir, '/')))
+    {
+      *s = '\0';
+      if(dir[0] && mkdir(dir, 0700) && errno != EEXIST)
+        EWARN("mkdir(\"%s\") failed\n", dir);
+      *s = '/';
+    }
+    if(mkdir(dir, 0700) && errno != EEXIST)
+      EWARN("mkdir(\"%s\") failed\n", dir);
+  }
+  free(dir);
+}
+
+void qp_source_cache_write(struct qp_source *source,
+    struct qp_cache *cache)
+{
+  struct cache_header h;
+  struct cache_channel *cc;
+  char *tmp;
+  FILE *file;
+  uint64_t offset;
+  size_t j;
+  int fd, err = 0;
+
+  ASSERT(source);
+  ASSERT(cache);
+
+  if(!source->num_channels || !source->num_values)
+    return;
+
+  for(j=0; j<source->num_channels; ++j)
+    if(source->channels[j]->form != QP_CHANNEL_FORM_SERIES ||
+        qp_channel_series_length(source->channels[j]) !=
+        source->num_values)
+      return;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CACHE_MAGIC, 8);
+  h.byte_order = CACHE_BYTE_ORDER;
+  h.chunk_size = sizeof(struct qp_channel_chunk);
+  h.array_length = ARRAY_LENGTH;
+  h.key_len = cache->key_len;
+  h.num_channels = source->num_channels;
+  h.num_values = source->num_values;
+  if(source->labels)
+    for(; source->labels[h.num_labels]; ++h.num_labels)
+      h.labels_len += strlen(source->labels[h.num_labels]) + 1;
+  if(source->select)
+    for(; source->select[h.num_select] != QP_SELECT_END; ++h.num_select);
+
+  cc = (struct cache_channel *)
+    qp_malloc(sizeof(*cc)*source->num_channels);
+  memset(cc, 0, sizeof(*cc)*source->num_channels);
+  offset = align(align(sizeof(h) + h.key_len + h.labels_len) +
+      sizeof(uint64_t)*h.num_select) + sizeof(*cc)*source->num_channels;
+  for(j=0; j<source->num_channels; ++j)
+  {
+    struct qp_channel *c;
+    c = source->channels[j];
+    cc[j].value_type = c->value_type;
+    cc[j].scale = c->series.scale;
+    cc[j].values = offset = align(offset);
+    offset += source->num_values*
+      qp_channel_series_value_size(c->value_type);
+    cc[j].chunks = offset = align(offset);
+    offset += c->series.arrays->num_arrays*h.chunk_size;
+  }
+
+  make_dirs(cache->path);
+
+  /* We write a new file and rename it, so that anyone mapping the
+   * old snapshot keeps reading it. */
+  tmp = qp_malloc(strlen(cache->path) + 8);
+  sprintf(tmp, "%s.XXXXXX", cache->path);
+  fd = mkstemp(tmp);
+  if(fd == -1)
+  {
+    EWARN("mkstemp(\"%s\") failed\n", tmp);
+    QP_EWARN("failed to make cache file for %s\n", source->name);
+    free(tmp);
+    free(cc);
+    return;
+  }
+  file = fdopen(fd, "w");
+  ASSERT(file);
+
+  offset = sizeof(h) + h.key_len;
+  err |= (fwrite(&h, sizeof(h), 1, file) != 1);
+  err |= (fwrite(cache->key, 1, h.key_len, file) != h.key_len);
+  for(j=0; j<h.num_labels; ++j)
+  {
+    size_t len;
+    len = strlen(source->labels[j]) + 1;
+    err |= (fwrite(source->labels[j], 1, len, file) != len);
+  }
+  offset += h.labels_len;
+  err |= write_zeros(file, align(offset) - offset);
+  offset = align(offset);
+  for(j=0; j<h.num_select; ++j)
+  {
+    uint64_t column;
+    column = source->select[j];
+    err |= (fwrite(&column, sizeof(column), 1, file) != 1);
+  }
+  offset += sizeof(uint64_t)*h.num_select;
+  err |= write_zeros(file, align(offset) - offset);
+  offset = align(offset);
+  err |= (fwrite(cc, sizeof(*cc), source->num_channels, file) !=
+      source->num_channels);
+  offset += sizeof(*cc)*source->num_channels;
+
+  for(j=0; !err && j<source->num_channels; ++j)
+  {
+    struct qp_channel_series *cs;
+    size_t k, elem_size, num_arrays;
+
+    cs = &source->channels[j]->series;
+    elem_size = qp_channel_series_value_size(cc[j].value_type);
+    num_arrays = cs->arrays->num_arrays;
+
+    err |= write_zeros(file, cc[j].values - offset);
+    offset = cc[j].values;
+    for(k=0; !err && k<num_arrays; ++k)
+    {
+      size_t n;
+      n = source->num_values - (k << ARRAY_SHIFT);
+      if(n > ARRAY_LENGTH)
+        n = ARRAY_LENGTH;
+      err |= (fwrite(qp_channel_series_array(cs, k, QP_CACHE_PEEK),
+            elem_size, n, file) != n);
+      offset += n*elem_size;
+    }
+
+    err |= write_zeros(file, cc[j].chunks - offset);
+    offset = cc[j].chunks;
+    err |= (fwrite(cs->arrays->chunks, h.chunk_size, num_arrays, file)
+        != num_arrays);
+    offset += num_arrays*h.chunk_size;
+  }
+
+  free(cc);
+
+  if(fclose(file))
+    err = 1;
+
+  if(!err && rename(tmp, cache->path))
+  {
+    EWARN("rename(\"%s\", \"%s\") failed\n", tmp, cache->path);
+    err = 1;
+  }
+
+  if(err)
+  {
+    QP_EWARN("failed to write cache file %s for %s\n",
+        cache->path, source->name);
+    unlink(tmp);
+  }
+  else
+    INFO("wrote %s to cache file %s\n", source->name, cache->path);
+
+  free(tmp);
+}
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "quickplot.h"
@@ -38,57 +39,142 @@
 #include "list.h"
 #include "channel.h"
 #include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+#include "channel_pack.h"
+#include "scan_double.h"
 
 #ifdef DMALLOC
 #  include "dmalloc.h"
 #endif
 
 
-/* Gets doubles ignoring any chars that cannot
- * be part of a decimal number.
- * +/-NAN +/-INF are valid doubles to get.
- * returns 1 if gets a double
- * returns 0 if there is no more doubles to get
- */
+/* The number of lines of values we hold before appending them
+ * to the channels */
+#define BATCH_LENGTH  (1024)
+
+
 static inline
-int get_next_double(double *val, char **line)
+void append_batch(struct qp_source *source)
 {
-  char *s, *ptr;
-  ASSERT(line);
-  ASSERT(val);
+  size_t k;
 
-  if(**line == '\0') return 0;
+  for(k=0; k<source->num_channels; ++k)
+    qp_channel_series_append_n(source->channels[k],
+        source->batch[k], source->batch_len);
 
-  s = ptr = *line;
+  source->batch_len = 0;
+}
 
-  while(*s)
-  {
-    *val = strtod(s, &ptr);
-    if(s != ptr)
-    {
-      *line = ptr;
-      return 1;
-    }
-    ++s;
-  }
+void qp_source_parse_doubles_flush(struct qp_source *source)
+{
+  size_t k;
+  ASSERT(source);
 
-  return 0;
+  if(!source->batch)
+    return;
+
+  append_batch(source);
+
+  for(k=0; k<source->num_channels; ++k)
+    free(source->batch[k]);
+  free(source->batch);
+  source->batch = NULL;
+}
+
+/* returns where the values start in line, or NULL if line is a
+ * comment or blank */
+static inline
+char *values_start(char *line)
+{
+  for(; *line && isspace(*line); ++line);
+
+  if(line[0] == '\0' ||
+     (line[0] >= '!' && line[0] <= ')') ||
+      line[0] == '/' ||
+      (line[0] >= '<' && line[0] <= '@') ||
+      line[0] == 'C' ||
+      line[0] == 'c')
+    return NULL;
+
+  return line;
+}
+
+/* Adds a channel to the source.  We pad the top of it with blank
+ * values to make it have the same number of values as the other
+ * channels that are appended to. */
+static
+void add_channel(struct qp_source *source)
+{
+  struct qp_channel *new_chan;
+  size_t len = 0;
+
+  new_chan = qp_channel_create(QP_CHANNEL_FORM_SERIES,
+      source->value_type);
+  ASSERT(new_chan);
+  ASSERT(new_chan->form == QP_CHANNEL_FORM_SERIES);
+  ASSERT(new_chan->series.arrays);
+  qp_channel_series_set_arena(new_chan, source->arena);
+  if(app->op_compress_channels)
+    qp_channel_series_pack(new_chan);
+
+  if(source->num_channels)
+    len = qp_channel_series_length(source->channels[0]);
+
+  ++source->num_channels;
+  source->channels = (struct qp_channel **)
+    qp_realloc(source->channels,
+        (source->num_channels+1)*sizeof(struct qp_channel*));
+  source->channels[source->num_channels-1] = new_chan;
+  source->channels[source->num_channels] = NULL;
+
+  qp_channel_series_append_nan(new_chan, len);
 }
 
+/* Gets the value of the column select[k] from *line, where *col is
+ * the column of the next number in *line, skipping the numbers of
+ * the columns before it with no conversion.  If select is NULL we
+ * read all the columns.  Returns 1 if we got the value, or 0 if
+ * there are no more values that we read in the line. */
+static inline
+int next_value(double *value, char **line, const size_t *select,
+    size_t k, size_t *col)
+{
+  if(!select)
+    return qp_scan_next_double(value, line);
+
+  if(select[k] == QP_SELECT_END)
+    /* We do not look at the rest of the line. */
+    return 0;
+
+  for(; *col < select[k]; ++(*col))
+    if(!qp_scan_skip_double(line))
+      return 0;
+
+  if(!qp_scan_next_double(value, line))
+    return 0;
+  ++(*col);
+  return 1;
+}
 
 /* returns:   0  line was skipped or empty
  *            1  got data                  */
 int qp_source_parse_doubles(struct qp_source *source, char *line_in)
 {
   char *s, *line;
-  struct qp_channel **c;
+  size_t k, col = 0;
   double value;
+  int got;
 
   line = line_in;
 
   if(!line_in || !line_in[0])
     return 0;
 
+  if(source->filter && source->filter_state.end_rows != QP_FILTER_NO_END)
+    /* We are past the --x-range. */
+    return 0;
+
   /* take off any ending '\n' or '\r' */
   for(s = &line[strlen(line)-1];
       s >= line && (*s == '\n' || *s == '\r');
@@ -96,78 +182,338 @@ int qp_source_parse_doubles(struct qp_source *source, char *line_in)
 
   //DEBUG("parsing line: %s\n", line);
 
-  for(; *line && isspace(*line); ++line);
-
-  if(line[0] == '\0' ||
-     (line[0] >= '!' && line[0] <= ')') ||
-      line[0] == '/' ||
-      (line[0] >= '<' && line[0] <= '@') ||
-      line[0] == 'C' ||
-      line[0] == 'c')
+  if(!(line = values_start(line)))
     return 0;
 
-
-  if(!get_next_double(&value, &line))
+  got = next_value(&value, &line, source->select, 0, &col);
+  /* If there are numbers but none in the columns that we read
+   * this is a line of blank values. */
+  if(!got && (!col || !source->num_channels))
     return 0;
 
-  c = source->channels;
+  if(!source->batch && source->num_channels)
+  {
+    /* we flushed and are parsing more lines */
+    source->batch = (double **)
+      qp_malloc(source->num_channels*sizeof(double *));
+    for(k=0; k<source->num_channels; ++k)
+      source->batch[k] = (double *)
+        qp_malloc(BATCH_LENGTH*sizeof(double));
+  }
+
+  k = 0;
 
-  do
+  if(got) do
   {
-    if(!(*c))
+    if(k == source->num_channels)
     {
-      struct qp_channel *new_chan;
-
-      new_chan = qp_channel_create(QP_CHANNEL_FORM_SERIES, QP_TYPE_DOUBLE);
-      ASSERT(new_chan);
-      ASSERT(new_chan->form == QP_CHANNEL_FORM_SERIES);
-      ASSERT(new_chan->value_type == QP_TYPE_DOUBLE);
-      ASSERT(new_chan->series.arrays);
-
-      ++source->num_channels;
-      source->channels = (struct qp_channel **)
-        qp_realloc(source->channels,
-            (source->num_channels+1)*sizeof(struct qp_channel*));
-      source->channels[source->num_channels-1] = new_chan;
-      source->channels[source->num_channels] = NULL;
-      c = source->channels + source->num_channels-1;
-
-      if(source->num_values) /* we have other 
-                                channels with data */
-      {
-        ASSERT(source->num_channels > 1);
-
-        /* We pad the top of this channel with blank
-         * values to make it have the same number
-         * of values as the other channels. */
-        struct qp_channel *first_chan;
-        size_t len;
-        /* get the first channel without moving
-         * the list pointer. */
-        first_chan = *(source->channels);
-        ASSERT(first_chan);
-        len = qp_channel_series_length(first_chan) - 1;
-        while(len--)
-          /* put len blank values in the begining */
-          qp_channel_series_double_append(new_chan, NAN);
-      }
+      size_t i;
+
+      /* This is padded to the values that are appended and
+       * the batch is padded for the ones that are waiting. */
+      add_channel(source);
+      source->batch = (double **) qp_realloc(source->batch,
+          source->num_channels*sizeof(double *));
+      source->batch[k] = (double *)
+        qp_malloc(BATCH_LENGTH*sizeof(double));
+      for(i=0; i<BATCH_LENGTH; ++i)
+        source->batch[k][i] = NAN;
     }
 
-    qp_channel_series_double_append(*c, value);
-    ++c;
+    source->batch[k][source->batch_len] = value;
+    ++k;
 
-  } while(get_next_double(&value, &line));
+  } while(next_value(&value, &line, source->select, k, &col));
 
 
  
   /* If there are any more channels with no values from
    * this line than put the value DOUBLE_NAN in those
    * channels. */
-  while(*c)
-    qp_channel_series_double_append(*(c++), NAN);
+  for(; k<source->num_channels; ++k)
+    source->batch[k][source->batch_len] = NAN;
+
+  if(source->filter && !qp_filter_row(source->filter,
+        &source->filter_state, source->batch, source->num_channels,
+        source->batch_len, source->num_values))
+    /* The next line writes over this one. */
+    return 0;
 
   ++(source->num_values);
 
+  if(++(source->batch_len) == BATCH_LENGTH)
+    append_batch(source);
+
   return 1; /* got data */
 }
 
+/* Like qp_source_parse_doubles() but the values go in cols */
+static inline
+void parse_columns(struct qp_columns *cols, char *line)
+{
+  double value;
+  size_t k, col = 0;
+  int got;
+
+  if(!(line = values_start(line)))
+    return;
+
+  got = next_value(&value, &line, cols->select, 0, &col);
+  if(!got && !col)
+    return;
+
+  if(cols->num_rows == cols->alloc_rows)
+  {
+    cols->alloc_rows = (cols->alloc_rows)?(2*cols->alloc_rows):BATCH_LENGTH;
+    for(k=0; k<cols->num_columns; ++k)
+      cols->column[k] = (double *) qp_realloc(cols->column[k],
+          cols->alloc_rows*sizeof(double));
+  }
+
+  k = 0;
+
+  if(got) do
+  {
+    if(k == cols->num_columns)
+    {
+      size_t i;
+      ++cols->num_columns;
+      cols->column = (double **) qp_realloc(cols->column,
+          cols->num_columns*sizeof(double *));
+      cols->column[k] = (double *)
+        qp_malloc(cols->alloc_rows*sizeof(double));
+      /* pad the top of the new column */
+      for(i=0; i<cols->num_rows; ++i)
+        cols->column[k][i] = NAN;
+    }
+
+    cols->column[k][cols->num_rows] = value;
+    ++k;
+
+  } while(next_value(&value, &line, cols->select, k, &col));
+
+  for(; k<cols->num_columns; ++k)
+    cols->column[k][cols->num_rows] = NAN;
+
+  if(cols->filter && !qp_filter_row(cols->filter, &cols->filter_state,
+        cols->column, cols->num_columns, cols->num_rows, cols->num_rows))
+    return;
+
+  ++(cols->num_rows);
+}
+
+const char *qp_source_parse_doubles_rows(struct qp_columns *cols,
+    const char *begin, const char *end, size_t num_rows)
+{
+  char *line = NULL;
+  size_t line_len = 0;
+
+  ASSERT(cols);
+  ASSERT(begin <= end);
+
+  while(begin < end && cols->num_rows < num_rows)
+  {
+    const char *nl;
+    size_t len;
+
+    /* the line with the '\n' like getline() gives us */
+    nl = memchr(begin, '\n', end - begin);
+    len = (nl)?(nl - begin + 1):(end - begin);
+
+    if(line_len < len + 1)
+    {
+      line_len = len + 1 + 128;
+      line = (char *) qp_realloc(line, line_len);
+    }
+    memcpy(line, begin, len);
+    line[len] = '\0';
+    begin += len;
+
+    parse_columns(cols, line);
+  }
+
+  if(line)
+    free(line);
+
+  return begin;
+}
+
+void qp_source_parse_doubles_range(struct qp_columns *cols,
+    const char *begin, const char *end)
+{
+  qp_source_parse_doubles_rows(cols, begin, end, (size_t) -1);
+}
+
+void qp_source_append_columns(struct qp_source *source,
+    struct qp_columns *cols)
+{
+  size_t k;
+
+  ASSERT(source);
+  ASSERT(cols);
+  /* the values held by qp_source_parse_doubles() go before these */
+  ASSERT(!source->batch);
+
+  if(!cols->num_rows)
+    return;
+
+  while(source->num_channels < cols->num_columns)
+    add_channel(source);
+
+  for(k=0; k<source->num_channels; ++k)
+    if(k < cols->num_columns)
+      qp_channel_series_append_n(source->channels[k],
+          cols->column[k], cols->num_rows);
+    else
+      qp_channel_series_append_nan(source->channels[k], cols->num_rows);
+
+  source->num_values += cols->num_rows;
+}
+
+void qp_columns_free(struct qp_columns *cols)
+{
+  const size_t *select;
+  const struct qp_filter *filter;
+  size_t k;
+  ASSERT(cols);
+
+  for(k=0; k<cols->num_columns; ++k)
+    free(cols->column[k]);
+  if(cols->column)
+    free(cols->column);
+  select = cols->select;
+  filter = cols->filter;
+  memset(cols, 0, sizeof(*cols));
+  cols->select = select;
+  cols->filter = filter;
+  qp_filter_state_init(&cols->filter_state);
+}
+
+static
+int compare_columns(const void *a, const void *b)
+{
+  size_t x, y;
+  x = *((const size_t *) a);
+  y = *((const size_t *) b);
+  return (x < y)?-1:((x > y)?1:0);
+}
+
+static inline
+int is_digits(const char *s, const char *end)
+{
+  if(s == end)
+    return 0;
+  for(; s < end; ++s)
+    if(!isdigit(*s))
+      return 0;
+  return 1;
+}
+
+int qp_source_select_columns(struct qp_source *source, const char *list)
+{
+  size_t *select = NULL, num = 0, alloc = 0, j, n;
+  const char *s;
+
+  ASSERT(source);
+  ASSERT(list);
+  ASSERT(!source->select);
+
+  s = list;
+  while(*s)
+  {
+    const char *word, *end, *dash;
+    size_t first, last;
+
+    while(*s == ',' || isspace(*s))
+      ++s;
+    if(!*s)
+      break;
+    word = s;
+    while(*s && *s != ',')
+      ++s;
+    for(end = s; end > word && isspace(end[-1]); --end);
+
+    dash = memchr(word, '-', end - word);
+
+    if(is_digits(word, end))
+      first = last = strtoul(word, NULL, 10);
+    else if(dash && is_digits(word, dash) && is_digits(dash + 1, end))
+    {
+      /* a range like 4-9 */
+      first = strtoul(word, NULL, 10);
+      last = strtoul(dash + 1, NULL, 10);
+      if(first > last)
+      {
+        size_t t;
+        t = first;
+        first = last;
+        last = t;
+      }
+    }
+    else
+    {
+      /* a label */
+      for(j=0; j<source->num_labels; ++j)
+        if(strlen(source->labels[j]) == (size_t)(end - word) &&
+            !strncmp(source->labels[j], word, end - word))
+          break;
+      if(j == source->num_labels)
+      {
+        QP_WARN("file %s has no column labeled \"%.*s\" for "
+            "--columns \"%s\"\n", source->name, (int)(end - word),
+            word, list);
+        if(select)
+          free(select);
+        return 1;
+      }
+      first = last = j;
+    }
+
+    if(num + (last - first) + 2 > alloc)
+    {
+      alloc = 2*alloc + (last - first) + 2;
+      select = (size_t *) qp_realloc(select, sizeof(size_t)*alloc);
+    }
+    for(j=first; j<=last; ++j)
+      select[num++] = j;
+  }
+
+  if(!num)
+  {
+    QP_WARN("got no columns in --columns \"%s\"\n", list);
+    if(select)
+      free(select);
+    return 1;
+  }
+
+  /* The channels are in the order of the columns in the file. */
+  qsort(select, num, sizeof(size_t), compare_columns);
+  for(n=1, j=1; j<num; ++j)
+    if(select[j] != select[n-1])
+      select[n++] = select[j];
+  select[n] = QP_SELECT_END;
+  source->select = select;
+
+  if(source->labels)
+  {
+    char **labels;
+    size_t k = 0;
+
+    labels = (char **) qp_malloc(sizeof(char *)*(n+1));
+    for(n=0, j=0; j<source->num_labels; ++j)
+    {
+      while(select[k] < j)
+        ++k;
+      if(select[k] == j)
+        labels[n++] = source->labels[j];
+      else
+        free(source->labels[j]);
+    }
+    labels[n] = NULL;
+    free(source->labels);
+    source->labels = labels;
+    source->num_labels = n;
+  }
+
+  return 0;
+}
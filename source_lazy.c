@@ -0,0 +1,457 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Reading text files with --lazy.  The file is mapped and parsed
+ * once to find where the lines of each array of ARRAY_LENGTH rows
+ * start, and the summaries of the arrays, and the values are not
+ * kept.  When the plots read an array, see qp_channel_series_array(),
+ * its lines are parsed again into a cache of the arrays that were
+ * read last, so a file much larger than memory takes a few bytes per
+ * array, and zooming in parses just the arrays in view.  Zoomed out
+ * plots are drawn from the summaries and read no arrays, see
+ * channel_pyramid.h. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "qp.h"
+#include "debug.h"
+#include "spew.h"
+#include "list.h"
+#include "channel.h"
+#include "channel_double.h"
+
+#ifdef DMALLOC
+#  include "dmalloc.h"
+#endif
+
+
+/* About the most memory that the parsed arrays of one file take.
+ * The arrays that were read the longest time ago are dropped to
+ * keep under this, or under --max-memory if that is less. */
+#define CACHE_BYTES  ((size_t) 256*1024*1024)
+/* We keep at least this many, so the x and y channels of a few
+ * plots are not parsing over each other. */
+#define MIN_BLOCKS   (16)
+
+#define NO_BLOCK     ((size_t) -1)
+
+
+/* the parsed rows of one array of the file */
+struct lazy_block
+{
+  size_t k; /* the array */
+  struct qp_columns cols;
+  uint64_t last_used;
+};
+
+struct lazy_file
+{
+  /* This is first so that the channels point to it. */
+  struct qp_channel_lazy lazy;
+
+  char *name;
+  const char *map;
+  size_t map_size;
+  /* We fstat() the file before we parse it again, since reading
+   * the map past the end of a file that was cut shorter would get
+   * SIGBUS. */
+  int fd;
+  int truncated;
+
+  /* a copy of the source select, that source_finish() may change */
+  size_t *select;
+
+  size_t num_rows;
+  size_t num_arrays;
+  /* The lines of array k are from map + start[k] to
+   * map + start[k+1]. */
+  size_t *start;
+
+  /* block[k] is the index in blocks of array k, or NO_BLOCK if
+   * it is not parsed. */
+  size_t *block;
+  struct lazy_block *blocks;
+  size_t num_blocks, max_blocks;
+  uint64_t clock;
+};
+
+
+static
+void lazy_destroy(struct qp_channel_lazy *lazy)
+{
+  struct lazy_file *lf;
+  size_t i;
+  lf = (struct lazy_file *) lazy;
+  ASSERT(lazy->ref_count == 0);
+
+  for(i=0; i<lf->num_blocks; ++i)
+    qp_columns_free(&lf->blocks[i].cols);
+  if(lf->blocks)
+    free(lf->blocks);
+  if(lf->block)
+    free(lf->block);
+  if(lf->start)
+    free(lf->start);
+  if(lf->select)
+    free(lf->select);
+  if(munmap((void *) lf->map, lf->map_size))
+    EWARN("munmap() file %s failed\n", lf->name);
+  if(lf->fd != -1)
+    close(lf->fd);
+  DEBUG("done reading file %s\n", lf->name);
+  free(lf->name);
+  free(lf);
+}
+
+static inline
+size_t array_rows(const struct lazy_file *lf, size_t k)
+{
+  size_t n;
+  n = lf->num_rows - (k << ARRAY_SHIFT);
+  return (n > ARRAY_LENGTH)?ARRAY_LENGTH:n;
+}
+
+/* returns 1 if the file is now shorter than the lines we read */
+static inline
+int is_truncated(struct lazy_file *lf)
+{
+  struct stat st;
+
+  if(lf->truncated)
+    return 1;
+  if(fstat(lf->fd, &st) ||
+      (size_t) st.st_size >= lf->start[lf->num_arrays])
+    return 0;
+
+  QP_WARN("file %s was cut shorter after it was read, so the values "
+      "that were not read again yet are now NAN\n", lf->name);
+  lf->truncated = 1;
+  return 1;
+}
+
+/* returns the parsed rows of array k, parsing them into the block
+ * that was used the longest time ago if they are not parsed.  The
+ * block has no rows if the file was cut shorter. */
+static
+struct lazy_block *get_block(struct lazy_file *lf, size_t k)
+{
+  struct lazy_block *b;
+  size_t i;
+
+  if(lf->block[k] != NO_BLOCK)
+  {
+    b = &lf->blocks[lf->block[k]];
+    b->last_used = ++lf->clock;
+    return b;
+  }
+
+  if(lf->num_blocks < lf->max_blocks)
+  {
+    i = lf->num_blocks++;
+    b = &lf->blocks[i];
+    b->cols.select = lf->select;
+  }
+  else
+  {
+    size_t j;
+    for(i=0, j=1; j<lf->num_blocks; ++j)
+      if(lf->blocks[j].last_used < lf->blocks[i].last_used)
+        i = j;
+    b = &lf->blocks[i];
+    lf->block[b->k] = NO_BLOCK;
+    /* We keep the memory of the columns for the next rows. */
+    b->cols.num_rows = 0;
+  }
+
+  b->k = k;
+  b->last_used = ++lf->clock;
+  lf->block[k] = i;
+
+  if(is_truncated(lf))
+  {
+    b->cols.num_rows = 0;
+    return b;
+  }
+
+  qp_source_parse_doubles_rows(&b->cols, lf->map + lf->start[k],
+      lf->map + lf->start[k+1], ARRAY_LENGTH);
+
+  if(b->cols.num_rows != array_rows(lf, k))
+    QP_WARN("file %s changed after it was read\n", lf->name);
+
+  return b;
+}
+
+static
+void lazy_read(struct qp_channel_lazy *lazy, size_t column, size_t k,
+    double *values)
+{
+  struct lazy_file *lf;
+  struct lazy_block *b;
+  size_t n, i = 0;
+
+  lf = (struct lazy_file *) lazy;
+  ASSERT(k < lf->num_arrays);
+
+  b = get_block(lf, k);
+  n = array_rows(lf, k);
+
+  if(column < b->cols.num_columns)
+  {
+    i = (b->cols.num_rows < n)?b->cols.num_rows:n;
+    memcpy(values, b->cols.column[column], i*sizeof(double));
+  }
+  /* The rows of this array have no value in this column. */
+  for(; i<n; ++i)
+    values[i] = NAN;
+}
+
+/* adds a column to the summaries, with no values in the
+ * arrays before this */
+static inline
+void add_column(struct qp_channel_chunk ***chunks, double ***ends,
+    size_t *num_columns, size_t num_arrays, size_t alloc_arrays)
+{
+  size_t j, k;
+
+  j = (*num_columns)++;
+  *chunks = (struct qp_channel_chunk **)
+    qp_realloc(*chunks, sizeof(**chunks)*(*num_columns));
+  *ends = (double **) qp_realloc(*ends, sizeof(**ends)*(*num_columns));
+  (*chunks)[j] = (struct qp_channel_chunk *)
+    qp_malloc(sizeof(struct qp_channel_chunk)*alloc_arrays);
+  (*ends)[j] = (double *) qp_malloc(sizeof(double)*2*alloc_arrays);
+
+  for(k=0; k<num_arrays; ++k)
+  {
+    qp_channel_chunk_init(&(*chunks)[j][k]);
+    (*chunks)[j][k].num_nan = ARRAY_LENGTH;
+    (*ends)[j][2*k] = (*ends)[j][2*k+1] = NAN;
+  }
+}
+
+int qp_source_read_lazy(struct qp_source *source, int fd, off_t offset)
+{
+  struct lazy_file *lf;
+  struct qp_channel_chunk **chunks = NULL;
+  double **ends = NULL;
+  struct qp_columns cols;
+  struct stat st;
+  const char *map, *p, *end;
+  size_t num_columns = 0, alloc_arrays = 0, j, n;
+  int lazy_fd;
+
+  ASSERT(source);
+  /* The rows are found by counting the lines, so we can't
+   * skip rows. */
+  ASSERT(!source->filter);
+
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= offset)
+    return -1;
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED)
+  {
+    EWARN("mmap() file %s failed\n", source->name);
+    return -1;
+  }
+  /* the reader closes fd */
+  if((lazy_fd = dup(fd)) == -1)
+  {
+    EWARN("dup() file %s failed\n", source->name);
+    munmap((void *) map, st.st_size);
+    return -1;
+  }
+  madvise((void *) map, st.st_size, MADV_SEQUENTIAL);
+
+  lf = (struct lazy_file *) qp_malloc(sizeof(*lf));
+  memset(lf, 0, sizeof(*lf));
+  lf->lazy.read = lazy_read;
+  lf->lazy.destroy = lazy_destroy;
+  lf->lazy.ref_count = 1;
+  lf->name = qp_strdup(source->name);
+  lf->map = map;
+  lf->map_size = st.st_size;
+  lf->fd = lazy_fd;
+
+  if(source->select)
+  {
+    for(n=0; source->select[n] != QP_SELECT_END; ++n);
+    lf->select = (size_t *) qp_malloc(sizeof(size_t)*(n+1));
+    memcpy(lf->select, source->select, sizeof(size_t)*(n+1));
+  }
+
+  memset(&cols, 0, sizeof(cols));
+  cols.select = lf->select;
+  qp_filter_state_init(&cols.filter_state);
+
+  p = map + offset;
+  end = map + st.st_size;
+
+  while(p < end)
+  {
+    const char *next;
+    size_t k;
+
+    cols.num_rows = 0;
+    next = qp_source_parse_doubles_rows(&cols, p, end, ARRAY_LENGTH);
+    if(!cols.num_rows)
+      /* There are just comments or blank lines at the end. */
+      break;
+
+    k = lf->num_arrays;
+    if(k + 1 >= alloc_arrays)
+    {
+      alloc_arrays = (alloc_arrays)?(2*alloc_arrays):1024;
+      lf->start = (size_t *) qp_realloc(lf->start,
+          sizeof(size_t)*alloc_arrays);
+      for(j=0; j<num_columns; ++j)
+      {
+        chunks[j] = (struct qp_channel_chunk *) qp_realloc(chunks[j],
+            sizeof(struct qp_channel_chunk)*alloc_arrays);
+        ends[j] = (double *) qp_realloc(ends[j],
+            sizeof(double)*2*alloc_arrays);
+      }
+    }
+
+    while(num_columns < cols.num_columns)
+      add_column(&chunks, &ends, &num_columns, k, alloc_arrays);
+
+    for(j=0; j<num_columns; ++j)
+    {
+      qp_channel_chunk_summary(&chunks[j][k], cols.column[j],
+          cols.num_rows);
+      ends[j][2*k] = cols.column[j][0];
+      ends[j][2*k+1] = cols.column[j][cols.num_rows-1];
+    }
+
+    lf->start[k] = p - map;
+    lf->num_rows += cols.num_rows;
+    ++lf->num_arrays;
+    p = next;
+
+    if(qp_source_load_progress(p - map))
+      break;
+  }
+
+  qp_columns_free(&cols);
+
+  if(!lf->num_arrays || qp_source_load_progress(p - map))
+  {
+    for(j=0; j<num_columns; ++j)
+    {
+      free(chunks[j]);
+      free(ends[j]);
+    }
+    if(chunks)
+      free(chunks);
+    if(ends)
+      free(ends);
+    lf->lazy.ref_count = 0;
+    lazy_destroy(&lf->lazy);
+    return 1; /* canceled or no values */
+  }
+
+  /* the end of the last array */
+  lf->start[lf->num_arrays] = p - map;
+
+  lf->block = (size_t *) qp_malloc(sizeof(size_t)*lf->num_arrays);
+  for(n=0; n<lf->num_arrays; ++n)
+    lf->block[n] = NO_BLOCK;
+
+  n = CACHE_BYTES;
+  if(app->op_max_memory && app->op_max_memory < n)
+    n = app->op_max_memory;
+  lf->max_blocks = n/(sizeof(double)*ARRAY_LENGTH*num_columns);
+  if(lf->max_blocks < MIN_BLOCKS)
+    lf->max_blocks = MIN_BLOCKS;
+  if(lf->max_blocks > lf->num_arrays)
+    lf->max_blocks = lf->num_arrays;
+  lf->blocks = (struct lazy_block *)
+    qp_malloc(sizeof(struct lazy_block)*lf->max_blocks);
+  memset(lf->blocks, 0, sizeof(struct lazy_block)*lf->max_blocks);
+
+  /* From now on we read the file where the plots are looking. */
+  madvise((void *) map, st.st_size, MADV_RANDOM);
+
+  /* The rows that qp_source_parse_doubles() got before we were
+   * called are in the arrays, so we let them go. */
+  if(source->batch)
+  {
+    for(j=0; j<source->num_channels; ++j)
+      free(source->batch[j]);
+    free(source->batch);
+    source->batch = NULL;
+    source->batch_len = 0;
+  }
+  if(source->channels)
+  {
+    struct qp_channel **c;
+    for(c = source->channels; *c; ++c)
+      qp_channel_destroy(*c);
+  }
+
+  source->channels = (struct qp_channel **)
+    qp_realloc(source->channels, sizeof(struct qp_channel *)*
+        (num_columns+1));
+  for(j=0; j<num_columns; ++j)
+  {
+    struct qp_channel *c;
+    c = qp_channel_create(QP_CHANNEL_FORM_SERIES, QP_TYPE_DOUBLE);
+    qp_channel_series_lazy(c, &lf->lazy, j, lf->num_rows,
+        (struct qp_channel_chunk *) qp_realloc(chunks[j],
+          sizeof(struct qp_channel_chunk)*lf->num_arrays),
+        (double *) qp_realloc(ends[j], sizeof(double)*2*lf->num_arrays));
+    source->channels[j] = c;
+  }
+  source->channels[j] = NULL;
+  source->num_channels = num_columns;
+  source->num_values = lf->num_rows;
+  source->value_type = QP_TYPE_DOUBLE;
+
+  free(chunks);
+  free(ends);
+
+  /* The channels have it now. */
+  --lf->lazy.ref_count;
+  ASSERT(lf->lazy.ref_count > 0);
+
+  INFO("indexed %zu rows in %zu arrays of file %s, that are parsed "
+      "as they are read keeping at most %zu\n", lf->num_rows,
+      lf->num_arrays, source->name, lf->max_blocks);
+
+  return 0;
+}
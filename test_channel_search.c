@@ -0,0 +1,363 @@
+/*
+  Quickplot - an interactive 2D plotter
+
+  Copyright (C) 1998-2011  Lance Arsenault
+
+
+  This file is part of Quickplot.
+
+  Quickplot is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation, either version 3 of the License,
+  or (at your option) any later version.
+
+  Quickplot is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Quickplot.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* This is run by 'make check'.  It checks qp_channel_gallop(),
+ * qp_channel_series_search(), qp_channel_series_find_lt() and
+ * qp_channel_series_find_gt() against a plain scan of the values,
+ * for all the series value types and for values that are bursty,
+ * exponential, constant, all NAN, and that have long runs of NAN. */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "quickplot.h"
+
+#include "config.h"
+#include "debug.h"
+#include "list.h"
+#include "channel.h"
+#include "spew.h"
+#include "channel_double.h"
+#include "channel_func.h"
+#include "channel_types.h"
+
+
+/* A bit more than 3 arrays of values, and the largest value
+ * we make must fit in a short. */
+#define LEN  (3*ARRAY_LENGTH + 100)
+
+enum
+{
+  DIST_BURSTY,
+  DIST_EXPONENTIAL,
+  DIST_NAN_RUNS,
+  DIST_ALL_NAN,
+  DIST_NUM
+};
+
+static const char *dist_name[] =
+{
+  "bursty", "exponential", "NAN runs", "all NAN"
+};
+
+static const char *type_name[] =
+{
+  [QP_TYPE_SHORT] = "short",
+  [QP_TYPE_INT] = "int",
+  [QP_TYPE_FLOAT] = "float",
+  [QP_TYPE_DOUBLE] = "double"
+};
+
+static int fail_count = 0;
+
+
+#define FAIL(fmt, ...) \
+  do { \
+    fprintf(stderr, "FAIL %s:%d: " fmt, __FILE__, __LINE__, \
+        ##__VA_ARGS__); \
+    ++fail_count; \
+  } while(0)
+
+
+/* Makes increasing values, with NAN in them for some
+ * distributions.  The values are integers so that they keep in
+ * short and int channels. */
+static void make_values(double *v, size_t n, int dist)
+{
+  size_t i;
+  double x = 0;
+
+  for(i = 0; i < n; ++i)
+    switch(dist)
+    {
+      case DIST_BURSTY:
+        /* bursts of 400 close values with big gaps between */
+        x += (i % 400)?1:500;
+        v[i] = x;
+        break;
+      case DIST_EXPONENTIAL:
+        {
+          double e;
+          e = floor(exp(i*log(30000.0)/n));
+          x = (e > x + 1)?e:(x + 1);
+          v[i] = x;
+        }
+        break;
+      case DIST_NAN_RUNS:
+        /* NAN at the start, the end, and a run of NAN longer
+         * than two arrays in the middle */
+        if(i < 50 || (i >= 1000 && i < 1000 + 2*ARRAY_LENGTH + 500) ||
+            i >= n - 30)
+          v[i] = NAN;
+        else
+          v[i] = i;
+        break;
+      case DIST_ALL_NAN:
+        v[i] = NAN;
+        break;
+    }
+}
+
+static qp_channel_t make_channel(const double *v, size_t n,
+    int value_type, double mul)
+{
+  qp_channel_t c;
+  size_t i = 0;
+
+  c = qp_channel_create(QP_CHANNEL_FORM_SERIES, value_type);
+
+  while(i < n)
+  {
+    if(isnan(v[i]))
+    {
+      /* runs of NAN go in with qp_channel_series_append_nan() so
+       * we get the shared array of NAN too */
+      size_t j;
+      for(j = i; j < n && isnan(v[j]); ++j);
+      qp_channel_series_append_nan(c, j - i);
+      i = j;
+      continue;
+    }
+    qp_channel_series_append(c, v[i]*mul);
+    ++i;
+  }
+  return c;
+}
+
+/* The answers we should get, the slow way */
+
+static size_t scan_search(const double *v, size_t n, double val,
+    int or_equal)
+{
+  size_t i;
+  for(i = 0; i < n; ++i)
+    if(is_good_double(v[i]) &&
+        qp_channel_search_is_past(v[i], val, or_equal))
+      return i;
+  return n;
+}
+
+static size_t scan_find_lt(const double *v, size_t n, double val)
+{
+  size_t i, s;
+  s = scan_search(v, n, val, 1);
+  for(i = s; i > 0; --i)
+    if(is_good_double(v[i-1]))
+      return i - 1;
+  return scan_search(v, n, -INFINITY, 0);
+}
+
+static size_t scan_find_gt(const double *v, size_t n, double val)
+{
+  size_t i, s;
+  s = scan_search(v, n, val, 0);
+  if(s < n)
+    return s;
+  for(i = n; i > 0; --i)
+    if(is_good_double(v[i-1]))
+      return i - 1;
+  return n;
+}
+
+static void check_val(qp_channel_t c, const double *v, size_t n,
+    double val, const char *what)
+{
+  size_t i, j;
+  double x;
+
+  for(j = 0; j < 2; ++j)
+  {
+    i = qp_channel_series_search(c, val, j);
+    if(i != scan_search(v, n, val, j))
+      FAIL("%s: search(%.17g, %zu) = %zu not %zu\n", what, val, j,
+          i, scan_search(v, n, val, j));
+  }
+
+  if(!(c->series.min < c->series.max))
+    /* find_lt() and find_gt() need at least two good values */
+    return;
+
+  x = val;
+  i = qp_channel_series_find_lt(c, &x);
+  j = scan_find_lt(v, n, val);
+  if(i != j || x != v[j])
+    FAIL("%s: find_lt(%.17g) = %zu not %zu\n", what, val, i, j);
+
+  x = val;
+  i = qp_channel_series_find_gt(c, &x);
+  j = scan_find_gt(v, n, val);
+  if(i != j || x != v[j])
+    FAIL("%s: find_gt(%.17g) = %zu not %zu\n", what, val, i, j);
+}
+
+static void check_channel(int value_type, int dist)
+{
+  double *v, mul, lo, hi;
+  char what[64];
+  qp_channel_t c;
+  size_t i;
+
+  v = (double *) qp_malloc(sizeof(*v)*LEN);
+  make_values(v, LEN, dist);
+  /* fractions that float and double keep exactly */
+  mul = (value_type == QP_TYPE_FLOAT ||
+      value_type == QP_TYPE_DOUBLE)?0.25:1;
+
+  c = make_channel(v, LEN, value_type, mul);
+  if(qp_channel_series_length(c) != LEN)
+    FAIL("%s %s: length %zu not %d\n", type_name[value_type],
+        dist_name[dist], qp_channel_series_length(c), LEN);
+
+  /* the values as the channel keeps them */
+  for(i = 0; i < LEN; ++i)
+    v[i] = qp_channel_series_index(c, i);
+
+  snprintf(what, sizeof(what), "%s %s", type_name[value_type],
+      dist_name[dist]);
+
+  lo = scan_search(v, LEN, -INFINITY, 0);
+  hi = (lo < LEN)?v[scan_find_gt(v, LEN, INFINITY)]:0;
+  lo = (lo < LEN)?v[(size_t) lo]:0;
+
+  check_val(c, v, LEN, -INFINITY, what);
+  check_val(c, v, LEN, INFINITY, what);
+  check_val(c, v, LEN, lo - 1, what);
+  check_val(c, v, LEN, hi + 1, what);
+
+  /* at, and just to each side of, many of the values */
+  for(i = 0; i < LEN; i += 31)
+  {
+    if(!is_good_double(v[i]))
+      continue;
+    check_val(c, v, LEN, v[i], what);
+    check_val(c, v, LEN, v[i] - mul*0.5, what);
+    check_val(c, v, LEN, v[i] + mul*0.5, what);
+  }
+
+  /* and at the edges of the arrays */
+  for(i = ARRAY_LENGTH - 2; i < LEN; i += ARRAY_LENGTH)
+  {
+    size_t j;
+    for(j = i; j < i + 4 && j < LEN; ++j)
+      if(is_good_double(v[j]))
+        check_val(c, v, LEN, v[j], what);
+  }
+
+  qp_channel_destroy(c);
+  free(v);
+}
+
+
+struct gallop_data
+{
+  const double *v;
+  double val;
+};
+
+static int gallop_past(void *data, size_t i)
+{
+  struct gallop_data *d;
+  d = (struct gallop_data *) data;
+  return (d->v[i] >= d->val)?1:0;
+}
+
+/* qp_channel_gallop() with every guess, for sorted values that may
+ * be constant or have long runs of the same value */
+static void check_gallop(void)
+{
+  static const size_t lens[] = { 0, 1, 2, 3, 5, 64, 1000 };
+  double v[1000];
+  size_t l;
+
+  for(l = 0; l < sizeof(lens)/sizeof(lens[0]); ++l)
+  {
+    size_t n, dist;
+    n = lens[l];
+    for(dist = 0; dist < 3; ++dist)
+    {
+      size_t i;
+
+      for(i = 0; i < n; ++i)
+        switch(dist)
+        {
+          case 0: /* constant */
+            v[i] = 5;
+            break;
+          case 1: /* bursty, with long runs of the same value */
+            v[i] = (double) ((i/100)*100);
+            break;
+          default: /* exponential */
+            v[i] = pow(1.01, i);
+            break;
+        }
+
+      for(i = 0; i <= n; ++i)
+      {
+        struct gallop_data d;
+        size_t answer, guess;
+
+        d.v = v;
+        /* every value and one past the end */
+        d.val = (i < n)?v[i]:((n)?(v[n-1] + 1):0);
+        for(answer = 0; answer < n && !gallop_past(&d, answer);
+            ++answer);
+
+        for(guess = 0; guess <= n + 1; ++guess)
+        {
+          size_t j;
+          j = qp_channel_gallop(n, guess, gallop_past, &d);
+          if(j != answer)
+            FAIL("gallop n=%zu dist=%zu val=%g guess=%zu: %zu"
+                " not %zu\n", n, dist, d.val, guess, j, answer);
+        }
+      }
+    }
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  static const int types[] =
+  {
+    QP_TYPE_SHORT, QP_TYPE_INT, QP_TYPE_FLOAT, QP_TYPE_DOUBLE
+  };
+  int t, dist;
+
+  check_gallop();
+
+  for(t = 0; t < (int) (sizeof(types)/sizeof(types[0])); ++t)
+    for(dist = 0; dist < DIST_NUM; ++dist)
+      check_channel(types[t], dist);
+
+  if(fail_count)
+  {
+    fprintf(stderr, "%s: %d checks failed\n", argv[0], fail_count);
+    return 1;
+  }
+  printf("%s: all checks passed\n", argv[0]);
+  return 0;
+}
@@ -612,6 +612,20 @@ qp_win_t _qp_win_create(const struct qp_win_config *c)
     //g_object_set_property(G_OBJECT(qp->status_entry), "editable", FALSE);
     gtk_widget_show(qp->status_entry);
 
+    /* These are shown while files load, see qp_source_load(). */
+    qp->load_progress = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(qp->load_progress),
+        TRUE);
+    gtk_box_pack_start(GTK_BOX(qp->statusbar), qp->load_progress,
+        FALSE, FALSE, 0);
+    qp->load_cancel = gtk_button_new_with_label("Cancel");
+    gtk_widget_set_tooltip_text(qp->load_cancel, "Stop loading the "
+        "files that this window shows the progress of");
+    gtk_box_pack_start(GTK_BOX(qp->statusbar), qp->load_cancel,
+        FALSE, FALSE, 0);
+    g_signal_connect(G_OBJECT(qp->load_cancel), "clicked",
+        G_CALLBACK(cb_cancel_loading), qp);
+
     if((c)?(c->statusbar):(app->op_statusbar))
 	gtk_widget_show(qp->statusbar);
     